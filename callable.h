@@ -17,4 +17,6 @@ public:
 
     virtual int Arity() const = 0;
     virtual std::string ToString() const = 0;
+    // natives without side effects whose results depend only on the arguments, see Memoization
+    virtual bool IsPure() const { return false; }
 };
\ No newline at end of file
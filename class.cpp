@@ -1,20 +1,44 @@
 #include "class.h"
 #include "function.h"
+#include <atomic>
+
+namespace
+{
+    std::atomic<uint64_t> NextClassId = 1;
+}
 
 ClassInstance::ClassInstance(const Class& definition)
-    : m_definition(definition) {}
+    : m_definition(definition)
+    , m_fields(definition.GetFields().size()) {}
 
-Class::Class(std::string_view name,
+Class::Class(const Token& name,
     std::shared_ptr<const Class> superClass,
-    std::map<std::string_view, const Function *> &&methods,
-    std::map<std::string_view, const Function*>&& staticMethods,
-    std::map<std::string_view, const Function*>&& getters)
-    : m_name(name)
+    Methods&& methods,
+    Methods&& staticMethods,
+    Methods&& getters,
+    const Fields& fields,
+    bool isFinal)
+    : m_name(name.m_lexeme)
+    , m_nameSymbol(name.Symbol())
     , m_methods(std::move(methods))
     , m_staticMethods(std::move(staticMethods))
     , m_getters(std::move(getters))
     , m_superClass(superClass)
+    , m_id(NextClassId++)
+    , m_isRecord(!fields.empty() || (superClass && superClass->IsRecord()))
+    , m_isFinal(isFinal)
 {
+    if (superClass)
+    {
+        m_fields = superClass->m_fields;
+        m_fieldIndices = superClass->m_fieldIndices;
+    }
+
+    for (uint32_t field : fields)
+    {
+        m_fieldIndices.emplace(field, static_cast<uint32_t>(m_fields.size()));
+        m_fields.push_back(field);
+    }
 }
 
 std::shared_ptr<ClassInstance> Class::CreateInstance() const
@@ -22,7 +46,7 @@ std::shared_ptr<ClassInstance> Class::CreateInstance() const
     return std::make_shared<ClassInstance>(*this);
 }
 
-static const Function* GetMethodByName(const std::map<std::string_view, const Function*>& methods, std::string_view name)
+static const Function* GetMethodByName(const Class::Methods& methods, uint32_t name)
 {
     auto it = methods.find(name);
     if (it != methods.end())
@@ -34,7 +58,7 @@ static const Function* GetMethodByName(const std::map<std::string_view, const Fu
 
 }
 
-const Function* Class::GetMethod(std::string_view name) const
+const Function* Class::GetMethod(uint32_t name) const
 {
     if (const Function* method = GetMethodByName(m_methods, name))
     {
@@ -49,12 +73,18 @@ const Function* Class::GetMethod(std::string_view name) const
     return nullptr;
 }
 
-const Function* Class::GetStaticMethod(std::string_view name) const
+const Function* Class::GetStaticMethod(uint32_t name) const
 {
     return GetMethodByName(m_staticMethods, name);
 }
 
-const Function* Class::GetGetter(std::string_view name) const
+uint32_t Class::FindField(uint32_t name) const
+{
+    auto it = m_fieldIndices.find(name);
+    return it != m_fieldIndices.end() ? it->second : NoField;
+}
+
+const Function* Class::GetGetter(uint32_t name) const
 {
     return GetMethodByName(m_getters, name);
 }
\ No newline at end of file
@@ -2,7 +2,8 @@
 
 #include "Token.h"
 #include <string_view>
-#include <map>
+#include <unordered_map>
+#include <vector>
 
 class Class;
 class Function;
@@ -14,29 +15,56 @@ struct ClassInstance
     const Class& ClassDefinition() const { return m_definition; }
 
     const Class& m_definition;
-    std::map<std::string_view, Value> m_properties;
+    std::unordered_map<uint32_t, Value> m_properties; // keyed by SymbolTable ids, empty for records
+    std::vector<Value> m_fields; // fixed layout of a record class
 };
 
 class Class
 {
 public:
-    Class(std::string_view name,
+    using Methods = std::unordered_map<uint32_t, const Function*>; // keyed by SymbolTable ids
+    using Fields = std::vector<uint32_t>; // SymbolTable ids
+
+    static constexpr uint32_t NoField = ~0u;
+
+    // the layout of a record class starts with the fields of its superclass
+    Class(const Token& name,
         std::shared_ptr<const Class> superClass,
-        std::map<std::string_view, const Function*>&& methods,
-        std::map<std::string_view, const Function*>&& staticMethods,
-        std::map<std::string_view, const Function*>&& getters);
+        Methods&& methods,
+        Methods&& staticMethods,
+        Methods&& getters,
+        const Fields& fields,
+        bool isFinal);
 
     std::shared_ptr<ClassInstance> CreateInstance() const;
 
     std::string_view ToString() const { return m_name; }
 
-    const Function* GetMethod(std::string_view name) const;
-    const Function* GetStaticMethod(std::string_view name) const;
-    const Function* GetGetter(std::string_view name) const;
+    const Function* GetMethod(uint32_t name) const;
+    const Function* GetStaticMethod(uint32_t name) const;
+    const Function* GetGetter(uint32_t name) const;
+    // the method named after the class
+    const Function* GetConstructor() const { return GetMethod(m_nameSymbol); }
+
+    // instances of a record class have only the declared fields, stored at fixed indices
+    bool IsRecord() const { return m_isRecord; }
+    const Fields& GetFields() const { return m_fields; }
+    // index in the layout or NoField
+    uint32_t FindField(uint32_t name) const;
+    // unique among all classes created by the process, identifies the layout in get and set site caches
+    uint64_t GetId() const { return m_id; }
+    // a final class has no subclasses
+    bool IsFinal() const { return m_isFinal; }
 private:
     std::string_view m_name;
-    std::map<std::string_view, const Function*> m_methods;
-    std::map<std::string_view, const Function*> m_staticMethods;
-    std::map<std::string_view, const Function*> m_getters;
+    uint32_t m_nameSymbol;
+    Methods m_methods;
+    Methods m_staticMethods;
+    Methods m_getters;
     std::shared_ptr<const Class> m_superClass;
+    Fields m_fields;
+    std::unordered_map<uint32_t, uint32_t> m_fieldIndices;
+    uint64_t m_id;
+    bool m_isRecord;
+    bool m_isFinal;
 };
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "compilationqueue.h"
+
+CompilationQueue::CompilationQueue()
+    : m_worker(&CompilationQueue::Run, this)
+{}
+
+CompilationQueue::~CompilationQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_jobs.clear();
+    }
+    m_jobAdded.notify_one();
+    m_worker.join();
+}
+
+void CompilationQueue::Enqueue(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_jobAdded.notify_one();
+}
+
+void CompilationQueue::Drain()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobDone.wait(lock, [this]() { return m_jobs.empty() && !m_running; });
+}
+
+void CompilationQueue::Run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_jobAdded.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+        if (m_stopping)
+        {
+            return;
+        }
+
+        Job job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        m_running = true;
+
+        lock.unlock();
+        job();
+        lock.lock();
+
+        m_running = false;
+        m_jobDone.notify_all();
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// jobs run one by one on a worker thread, so the interpreter keeps executing while they compile.
+// a job publishes its result itself, pending jobs are dropped when the queue is destroyed.
+class CompilationQueue
+{
+public:
+    using Job = std::function<void()>;
+
+    CompilationQueue();
+    ~CompilationQueue();
+
+    CompilationQueue(const CompilationQueue&) = delete;
+    CompilationQueue& operator=(const CompilationQueue&) = delete;
+
+    void Enqueue(Job job);
+    // waits until all enqueued jobs are done
+    void Drain();
+
+private:
+    void Run();
+
+    std::mutex m_mutex;
+    std::condition_variable m_jobAdded;
+    std::condition_variable m_jobDone;
+    std::deque<Job> m_jobs;
+    bool m_running = false; // a job is taken by the worker
+    bool m_stopping = false;
+    std::thread m_worker; // started last, after the state it uses
+};
@@ -0,0 +1,418 @@
+#include "escapeanalyzer.h"
+#include "statementvisitor.h"
+#include "expressionvisitor.h"
+#include "statements.h"
+#include "expressions.h"
+#include "symboltable.h"
+#include "interpreter.h"
+#include "function.h"
+#include "class.h"
+#include "token.h"
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+    struct Candidate
+    {
+        const VariableDeclarationStatement* m_declaration;
+        std::vector<const GetExpression*> m_gets;
+        std::vector<const SetExpression*> m_sets;
+        bool m_escapes = false;
+    };
+
+    struct EscapeAnalyzerContext : IStatementVisitorContext, IExpressionVisitorContext
+    {
+        explicit EscapeAnalyzerContext(bool functionBody)
+            : m_functionBody(functionBody)
+        {}
+
+        // the variable of a candidate named by the expression
+        Candidate* FindCandidate(const IExpression& expression)
+        {
+            const VariableExpression* variable = dynamic_cast<const VariableExpression*>(&expression);
+            return variable ? FindCandidate(variable->m_resolved) : nullptr;
+        }
+
+        Candidate* FindCandidate(const ResolvedName& resolved)
+        {
+            auto it = resolved.m_declaration ? m_candidates.find(resolved.m_declaration) : m_candidates.end();
+            return it != m_candidates.end() ? &it->second : nullptr;
+        }
+
+        const bool m_functionBody; // top-level variables are globals
+        uint32_t m_depth = 0; // of the closures within the analyzed body, they capture the variables they use
+        std::unordered_map<const Token*, Candidate> m_candidates;
+        std::vector<const std::vector<IStatementPtr>*> m_nestedBodies; // analyzed next
+    };
+
+    EscapeAnalyzerContext& GetEscapeAnalyzerContext(IStatementVisitorContext* context)
+    {
+        return *static_cast<EscapeAnalyzerContext*>(context);
+    }
+
+    EscapeAnalyzerContext& GetEscapeAnalyzerContext(IExpressionVisitorContext* context)
+    {
+        return *static_cast<EscapeAnalyzerContext*>(context);
+    }
+
+    struct UsesCollector : IStatementVisitor, IExpressionVisitor
+    {
+        void Walk(const std::vector<IStatementPtr>& statements, EscapeAnalyzerContext& context) const
+        {
+            for (const IStatementPtr& statement : statements)
+            {
+                statement->Accept(*this, &context);
+            }
+        }
+
+        void Walk(const IStatement* statement, EscapeAnalyzerContext& context) const
+        {
+            if (statement)
+            {
+                statement->Accept(*this, &context);
+            }
+        }
+
+        void Walk(const IExpression* expression, EscapeAnalyzerContext& context) const
+        {
+            if (expression)
+            {
+                expression->Accept(*this, &context);
+            }
+        }
+
+        void WalkClosure(const std::vector<IStatementPtr>& body, EscapeAnalyzerContext& context) const
+        {
+            if (context.m_depth == 0)
+            {
+                context.m_nestedBodies.push_back(&body);
+            }
+
+            ++context.m_depth;
+            Walk(body, context);
+            --context.m_depth;
+        }
+
+        virtual void VisitExpressionStatement(const ExpressionStatement& statement, IStatementVisitorContext* context) const override
+        {
+            Walk(statement.m_expression.get(), GetEscapeAnalyzerContext(context));
+        }
+
+        virtual void VisitPrintStatement(const PrintStatement& statement, IStatementVisitorContext* context) const override
+        {
+            Walk(statement.m_expression.get(), GetEscapeAnalyzerContext(context));
+        }
+
+        virtual void VisitVariableDeclarationStatement(const VariableDeclarationStatement& statement, IStatementVisitorContext* context) const override
+        {
+            EscapeAnalyzerContext& analyzerContext = GetEscapeAnalyzerContext(context);
+            Walk(statement.m_initializer.get(), analyzerContext);
+
+            statement.m_scalarReplacement.reset();
+            const CallExpression* call = dynamic_cast<const CallExpression*>(statement.m_initializer.get());
+            if (analyzerContext.m_functionBody && analyzerContext.m_depth == 0 && call && dynamic_cast<const VariableExpression*>(call->m_calle.get()))
+            {
+                analyzerContext.m_candidates.emplace(&statement.m_name, Candidate{&statement});
+            }
+        }
+
+        virtual void VisitFunctionDeclarationStatement(const FunctionDeclarationStatement& statement, IStatementVisitorContext* context) const override
+        {
+            WalkClosure(statement.m_body, GetEscapeAnalyzerContext(context));
+        }
+
+        virtual void VisitClassDeclarationStatement(const ClassDeclarationStatement& statement, IStatementVisitorContext* context) const override
+        {
+            EscapeAnalyzerContext& analyzerContext = GetEscapeAnalyzerContext(context);
+            Walk(statement.m_superClass.get(), analyzerContext);
+            for (const std::unique_ptr<FunctionDeclarationStatement>& method : statement.m_methods)
+            {
+                WalkClosure(method->m_body, analyzerContext);
+            }
+        }
+
+        virtual void VisitBlockStatement(const BlockStatement& statement, IStatementVisitorContext* context) const override
+        {
+            Walk(statement.m_block, GetEscapeAnalyzerContext(context));
+        }
+
+        virtual void VisitIfStatement(const IfStatement& statement, IStatementVisitorContext* context) const override
+        {
+            EscapeAnalyzerContext& analyzerContext = GetEscapeAnalyzerContext(context);
+            Walk(statement.m_condition.get(), analyzerContext);
+            Walk(statement.m_trueBranch.get(), analyzerContext);
+            Walk(statement.m_falseBranch.get(), analyzerContext);
+        }
+
+        virtual void VisitWhileStatement(const WhileStatement& statement, IStatementVisitorContext* context) const override
+        {
+            EscapeAnalyzerContext& analyzerContext = GetEscapeAnalyzerContext(context);
+            Walk(statement.m_condition.get(), analyzerContext);
+            Walk(statement.m_body.get(), analyzerContext);
+        }
+
+        virtual void VisitForStatement(const ForStatement& statement, IStatementVisitorContext* context) const override
+        {
+            EscapeAnalyzerContext& analyzerContext = GetEscapeAnalyzerContext(context);
+            Walk(statement.m_initializer.get(), analyzerContext);
+            Walk(statement.m_condition.get(), analyzerContext);
+            Walk(statement.m_increment.get(), analyzerContext);
+            Walk(statement.m_rangeEnd.get(), analyzerContext);
+            Walk(statement.m_body.get(), analyzerContext);
+        }
+
+        virtual void VisitReturnStatement(const ReturnStatement& statement, IStatementVisitorContext* context) const override
+        {
+            Walk(statement.m_returnValue.get(), GetEscapeAnalyzerContext(context));
+        }
+
+        virtual void VisitUnaryExpression(const UnaryExpression& unaryExpression, IExpressionVisitorContext* context) const override
+        {
+            Walk(unaryExpression.m_expression.get(), GetEscapeAnalyzerContext(context));
+        }
+
+        virtual void VisitBinaryExpression(const BinaryExpression& binaryExpression, IExpressionVisitorContext* context) const override
+        {
+            EscapeAnalyzerContext& analyzerContext = GetEscapeAnalyzerContext(context);
+            Walk(binaryExpression.m_left.get(), analyzerContext);
+            Walk(binaryExpression.m_right.get(), analyzerContext);
+        }
+
+        virtual void VisitTernaryConditionalExpression(const TernaryConditionalExpression& ternaryConditionalExpression, IExpressionVisitorContext* context) const override
+        {
+            EscapeAnalyzerContext& analyzerContext = GetEscapeAnalyzerContext(context);
+            Walk(ternaryConditionalExpression.m_condition.get(), analyzerContext);
+            Walk(ternaryConditionalExpression.m_trueBranch.get(), analyzerContext);
+            Walk(ternaryConditionalExpression.m_falseBranch.get(), analyzerContext);
+        }
+
+        virtual void VisitGroupingExpression(const GroupingExpression& groupingExpression, IExpressionVisitorContext* context) const override
+        {
+            Walk(groupingExpression.m_expression.get(), GetEscapeAnalyzerContext(context));
+        }
+
+        // any use but the owner of a property escapes
+        virtual void VisitVariableExpression(const VariableExpression& variableExpression, IExpressionVisitorContext* context) const override
+        {
+            if (Candidate* candidate = GetEscapeAnalyzerContext(context).FindCandidate(variableExpression.m_resolved))
+            {
+                candidate->m_escapes = true;
+            }
+        }
+
+        virtual void VisitAssignmentExpression(const AssignmentExpression& assignmentExpression, IExpressionVisitorContext* context) const override
+        {
+            EscapeAnalyzerContext& analyzerContext = GetEscapeAnalyzerContext(context);
+            if (Candidate* candidate = analyzerContext.FindCandidate(assignmentExpression.m_resolved))
+            {
+                candidate->m_escapes = true;
+            }
+            Walk(assignmentExpression.m_expression.get(), analyzerContext);
+        }
+
+        virtual void VisitLogicalExpression(const LogicalExpression& logicalExpression, IExpressionVisitorContext* context) const override
+        {
+            EscapeAnalyzerContext& analyzerContext = GetEscapeAnalyzerContext(context);
+            Walk(logicalExpression.m_left.get(), analyzerContext);
+            Walk(logicalExpression.m_right.get(), analyzerContext);
+        }
+
+        virtual void VisitCallExpression(const CallExpression& callExpression, IExpressionVisitorContext* context) const override
+        {
+            EscapeAnalyzerContext& analyzerContext = GetEscapeAnalyzerContext(context);
+            Walk(callExpression.m_calle.get(), analyzerContext);
+            for (const IExpressionPtr& argument : callExpression.m_arguments)
+            {
+                Walk(argument.get(), analyzerContext);
+            }
+        }
+
+        virtual void VisitGetExpression(const GetExpression& getExpression, IExpressionVisitorContext* context) const override
+        {
+            EscapeAnalyzerContext& analyzerContext = GetEscapeAnalyzerContext(context);
+            getExpression.m_scalarField = SymbolTable::None;
+            Candidate* candidate = analyzerContext.m_depth == 0 ? analyzerContext.FindCandidate(*getExpression.m_owner) : nullptr;
+            if (candidate)
+            {
+                candidate->m_gets.push_back(&getExpression);
+            }
+            else
+            {
+                Walk(getExpression.m_owner.get(), analyzerContext);
+            }
+        }
+
+        virtual void VisitSetExpression(const SetExpression& setExpression, IExpressionVisitorContext* context) const override
+        {
+            EscapeAnalyzerContext& analyzerContext = GetEscapeAnalyzerContext(context);
+            setExpression.m_scalarField = SymbolTable::None;
+            Candidate* candidate = analyzerContext.m_depth == 0 ? analyzerContext.FindCandidate(setExpression.m_owner) : nullptr;
+            if (candidate)
+            {
+                candidate->m_sets.push_back(&setExpression);
+            }
+            else
+            {
+                Walk(&setExpression.m_owner, analyzerContext);
+            }
+            Walk(setExpression.m_value.get(), analyzerContext);
+        }
+
+        virtual void VisitLambdaExpression(const LambdaExpression& lambdaExpression, IExpressionVisitorContext* context) const override
+        {
+            WalkClosure(lambdaExpression.m_body, GetEscapeAnalyzerContext(context));
+        }
+    };
+
+    void Replace(const Candidate& candidate)
+    {
+        std::unique_ptr<ScalarReplacement> replacement = std::make_unique<ScalarReplacement>();
+        const std::string prefix = std::string(candidate.m_declaration->m_name.m_lexeme) + '.';
+        auto getSlot = [&](const Token& field)
+        {
+            auto it = std::find(replacement->m_fields.begin(), replacement->m_fields.end(), field.Symbol());
+            if (it != replacement->m_fields.end())
+            {
+                return replacement->m_slots[it - replacement->m_fields.begin()];
+            }
+
+            replacement->m_fields.push_back(field.Symbol());
+            replacement->m_slots.push_back(SymbolTable::Intern(prefix + std::string(field.m_lexeme)));
+            return replacement->m_slots.back();
+        };
+
+        for (const GetExpression* getExpression : candidate.m_gets)
+        {
+            getExpression->m_scalarField = getSlot(getExpression->m_name);
+        }
+        for (const SetExpression* setExpression : candidate.m_sets)
+        {
+            setExpression->m_scalarField = getSlot(setExpression->m_name);
+        }
+
+        candidate.m_declaration->m_scalarReplacement = std::move(replacement);
+    }
+}
+
+void EscapeAnalyzer::Analyze(const std::vector<IStatementPtr>& statements) const
+{
+    Analyze(statements, false);
+}
+
+void EscapeAnalyzer::AnalyzeBody(const std::vector<IStatementPtr>& body) const
+{
+    Analyze(body, true);
+}
+
+void EscapeAnalyzer::Analyze(const std::vector<IStatementPtr>& statements, bool functionBody) const
+{
+    // closures are analyzed after the body declaring them, which has seen the uses within them
+    std::vector<std::pair<const std::vector<IStatementPtr>*, bool>> bodies = { { &statements, functionBody } };
+    while (!bodies.empty())
+    {
+        EscapeAnalyzerContext context(bodies.back().second);
+        const std::vector<IStatementPtr>& body = *bodies.back().first;
+        bodies.pop_back();
+
+        UsesCollector().Walk(body, context);
+        for (const auto& [declaration, candidate] : context.m_candidates)
+        {
+            if (!candidate.m_escapes)
+            {
+                Replace(candidate);
+            }
+        }
+
+        for (const std::vector<IStatementPtr>* nestedBody : context.m_nestedBodies)
+        {
+            bodies.emplace_back(nestedBody, true);
+        }
+    }
+}
+
+bool EscapeAnalyzer::CanReplace(const ScalarReplacement& replacement, const std::shared_ptr<const Class>& classDefinition, size_t argumentsCount)
+{
+    if (classDefinition == replacement.m_class)
+    {
+        return replacement.m_replaceable;
+    }
+
+    replacement.m_class = classDefinition;
+    replacement.m_initializers.clear();
+    replacement.m_replaceable = false;
+
+    // an undeclared field of a record is reported at runtime by the instance
+    auto isDeclared = [&classDefinition](uint32_t field) { return !classDefinition->IsRecord() || classDefinition->FindField(field) != Class::NoField; };
+    if (!std::all_of(replacement.m_fields.begin(), replacement.m_fields.end(), isDeclared))
+    {
+        return false;
+    }
+
+    // without a constructor the instance has no fields until they are set
+    const Function* constructor = classDefinition->GetConstructor();
+    if (!constructor)
+    {
+        replacement.m_replaceable = replacement.m_fields.empty();
+        return replacement.m_replaceable;
+    }
+
+    if (constructor->Arity() != static_cast<int>(argumentsCount))
+    {
+        return false; // reported by the call
+    }
+
+    const FunctionDeclarationStatement* declaration = nullptr;
+    try
+    {
+        declaration = &constructor->GetDeclaration();
+    }
+    catch (const Interpreter::InterpreterError&)
+    {
+        return false;
+    }
+
+    std::vector<bool> initialized(replacement.m_fields.size(), false);
+    for (const IStatementPtr& statement : declaration->m_body)
+    {
+        const ExpressionStatement* expressionStatement = dynamic_cast<const ExpressionStatement*>(statement.get());
+        const SetExpression* setExpression = expressionStatement ? dynamic_cast<const SetExpression*>(expressionStatement->m_expression.get()) : nullptr;
+        if (!setExpression || !dynamic_cast<const ThisExpression*>(&setExpression->m_owner) || !isDeclared(setExpression->m_name.Symbol()))
+        {
+            return false;
+        }
+
+        ScalarReplacement::FieldInitializer initializer{0, 0, nullptr};
+        if (const LiteralExpression* literal = dynamic_cast<const LiteralExpression*>(setExpression->m_value.get()))
+        {
+            initializer.m_literal = &literal->m_value;
+        }
+        else if (const VariableExpression* variable = dynamic_cast<const VariableExpression*>(setExpression->m_value.get()))
+        {
+            auto parameter = std::find_if(declaration->m_parameters.begin(), declaration->m_parameters.end(),
+                [variable](const Token& token) { return &token == variable->m_resolved.m_declaration; });
+            if (parameter == declaration->m_parameters.end())
+            {
+                return false;
+            }
+            initializer.m_argument = parameter - declaration->m_parameters.begin();
+        }
+        else
+        {
+            return false;
+        }
+
+        // fields the function doesn't use aren't stored
+        auto field = std::find(replacement.m_fields.begin(), replacement.m_fields.end(), setExpression->m_name.Symbol());
+        if (field != replacement.m_fields.end())
+        {
+            initializer.m_field = field - replacement.m_fields.begin();
+            initialized[initializer.m_field] = true;
+            replacement.m_initializers.push_back(initializer);
+        }
+    }
+
+    replacement.m_replaceable = std::all_of(initialized.begin(), initialized.end(), [](bool isInitialized) { return isInitialized; });
+    return replacement.m_replaceable;
+}
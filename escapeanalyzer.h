@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class Class;
+class Value;
+struct IStatement;
+using IStatementPtr = std::unique_ptr<const IStatement>;
+
+// instance created by 'var name = SomeClass(...)' in a function and used only through its fields, set by EscapeAnalyzer.
+// once the class is known, the declaration stores the fields in the environment of the variable under their own symbols
+// and the variable holds nil instead of an instance, so nothing is allocated
+struct ScalarReplacement
+{
+    // a field the constructor assigns from an argument or a literal
+    struct FieldInitializer
+    {
+        size_t m_field; // index in m_fields
+        size_t m_argument;
+        const Value* m_literal; // null when the argument is assigned
+    };
+
+    std::vector<uint32_t> m_fields; // names read or assigned through the variable
+    std::vector<uint32_t> m_slots; // symbols the fields are stored under, 'name.field' can't clash with variables
+
+    // the last class the declaration created, replaced only when its constructor initializes all the fields
+    mutable std::shared_ptr<const Class> m_class;
+    mutable std::vector<FieldInitializer> m_initializers;
+    mutable bool m_replaceable = false;
+};
+
+// finds local instances which don't escape the function creating them.
+// a variable initialized by a call of a named callee doesn't escape when it is never assigned, captured by a closure
+// or used other than as the owner of a property get or set, gets and sets of such variables are annotated with the slots.
+class EscapeAnalyzer
+{
+public:
+    // expects statements resolved by Resolver, analyzes the functions, methods and lambdas declared by them
+    void Analyze(const std::vector<IStatementPtr>& statements) const;
+    // analyzes a function body on its own, like a deferred body or a copy made by an optimizing tier
+    void AnalyzeBody(const std::vector<IStatementPtr>& body) const;
+
+    // whether an instance of the class can be replaced, the constructor must only assign arguments and literals to fields of 'this'
+    static bool CanReplace(const ScalarReplacement& replacement, const std::shared_ptr<const Class>& classDefinition, size_t argumentsCount);
+
+private:
+    void Analyze(const std::vector<IStatementPtr>& statements, bool functionBody) const;
+};
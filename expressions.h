@@ -1,11 +1,20 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <functional>
 #include "value.h"
+#include "tiering.h"
 
 struct Token;
+class ICallable;
+class Class;
+class Function;
+struct VariableExpression;
+struct GetExpression;
+struct SuperExpression;
+struct InlinedBody;
 struct IExpressionVisitor;
 struct IExpressionVisitorContext;
 
@@ -17,6 +26,39 @@ struct IExpression
 
 using IExpressionPtr = std::unique_ptr<const IExpression>;
 
+// static type of an expression value, proven by TypeInferrer
+enum class ExpressionType
+{
+    Unknown,
+    Number,
+    Boolean,
+    String
+};
+
+// operand types observed at runtime by self-specializing expressions
+enum class TypeFeedback
+{
+    Uninitialized,
+    Number,
+    String,
+    Generic // guard failed once, the node stays on the generic path
+};
+
+// binding of a name use, written by Resolver
+struct ResolvedName
+{
+    static constexpr uint32_t Unresolved = ~0u; // the name is looked up through all enclosing environments
+    static constexpr uint32_t Global = ~0u - 1;
+    static constexpr uint32_t Inlined = ~0u - 2; // parameter or local of an inlined body, stored in m_inlineSlot of the inline frame
+
+    uint32_t m_distance = Unresolved; // number of scopes between the use and the declaration
+    const Token* m_declaration = nullptr; // null for globals and implicit names like 'this' and 'super'
+    // the name is bound once and never assigned, for globals only within the resolved programm
+    bool m_final = false;
+    const Value* m_constant = nullptr; // literal initializer of a final local variable, the use evaluates to it
+    uint32_t m_inlineSlot = 0;
+};
+
 struct UnaryExpression : IExpression
 {
     UnaryExpression(const Token& op, IExpressionPtr expression);
@@ -25,6 +67,8 @@ struct UnaryExpression : IExpression
 
     IExpressionPtr m_expression;
     const Token& m_operator;
+
+    mutable ExpressionType m_operandType = ExpressionType::Unknown; // set by TypeInferrer, Unknown means the operand is checked at runtime
 };
 
 struct BinaryExpression : IExpression
@@ -36,6 +80,9 @@ struct BinaryExpression : IExpression
     IExpressionPtr m_left;
     const Token& m_operator;
     IExpressionPtr m_right;
+
+    mutable ExpressionType m_operandsType = ExpressionType::Unknown; // set by TypeInferrer when both operands are proven to be of the same type
+    mutable TypeFeedback m_feedback = TypeFeedback::Uninitialized;
 };
 
 struct TernaryConditionalExpression : IExpression
@@ -75,6 +122,8 @@ struct VariableExpression : IExpression
     virtual void Accept(const IExpressionVisitor& visitor, IExpressionVisitorContext* context) const override;
 
     const Token& m_name;
+
+    mutable ResolvedName m_resolved;
 };
 
 struct AssignmentExpression : IExpression
@@ -85,6 +134,8 @@ struct AssignmentExpression : IExpression
 
     const Token& m_name;
     IExpressionPtr m_expression;
+
+    mutable ResolvedName m_resolved;
 };
 
 struct LogicalExpression : IExpression
@@ -107,6 +158,37 @@ struct CallExpression : IExpression
     const Token& m_token;
     IExpressionPtr m_calle;
     std::vector<IExpressionPtr> m_arguments;
+
+    // monomorphic call site cache, arity of the cached callee is already checked against this call site
+    mutable const ICallable* m_cachedCallable = nullptr;
+    mutable std::shared_ptr<const Class> m_cachedClass;
+    mutable const Function* m_cachedConstructor = nullptr;
+    mutable bool m_megamorphic = false;
+
+    // callee named by a variable, set by Resolver
+    mutable const VariableExpression* m_calleeVariable = nullptr;
+    // callee naming a method, called without binding it to the instance, set by Resolver
+    mutable const GetExpression* m_calleeProperty = nullptr;
+    mutable const SuperExpression* m_calleeSuper = nullptr;
+    // storage of a final global callee in the global environment with the given id, read without lookups
+    mutable Value* m_calleeSlot = nullptr;
+    mutable uint64_t m_calleeSlotOwner = 0;
+
+    // body of the callee substituted by Inliner, used while the call site calls the same callee
+    mutable std::unique_ptr<const InlinedBody> m_inlined;
+    mutable const ICallable* m_notInlined = nullptr; // the last callee Inliner refused
+
+    mutable const ICallable* m_specializedCallee = nullptr; // the last callee Specializer was asked for
+    mutable const Function* m_specialization = nullptr;
+    uint32_t m_inlineDepth = 0; // number of inlined bodies this call site was cloned from
+};
+
+struct InlinedBody
+{
+    const ICallable* m_callee;
+    std::vector<IExpressionPtr> m_locals; // initializers of the callee locals, the values go to the slots after the arguments
+    IExpressionPtr m_result;
+    uint32_t m_slotsCount;
 };
 
 struct GetExpression : IExpression
@@ -117,6 +199,16 @@ struct GetExpression : IExpression
 
     const Token& m_name;
     IExpressionPtr m_owner;
+
+    mutable uint32_t m_scalarField = 0; // symbol the field is stored under when the owner is scalar replaced, see EscapeAnalyzer
+    mutable uint64_t m_cachedClassId = 0; // class whose field index or method is cached, see Class::GetId
+    mutable uint32_t m_cachedField = 0;
+    mutable const Function* m_cachedMethod = nullptr; // null when a field is cached
+
+    // 'this.name' names a final method of the enclosing class, set by Resolver.
+    // the method is cached for the closure of the enclosing class and called on any instance without lookups
+    mutable bool m_finalMethod = false;
+    mutable uint64_t m_cachedClosureId = 0;
 };
 
 struct SetExpression : IExpression
@@ -129,6 +221,10 @@ struct SetExpression : IExpression
     IExpressionPtr m_getter;
     IExpressionPtr m_value;
     const IExpression& m_owner;
+
+    mutable uint32_t m_scalarField = 0; // see GetExpression
+    mutable uint64_t m_cachedClassId = 0; // see GetExpression
+    mutable uint32_t m_cachedField = 0;
 };
 
 struct IStatement;
@@ -145,6 +241,7 @@ struct LambdaExpression : IExpression
 
     ParametersType m_parameters;
     BodyType m_body;
+    mutable Tiering m_tiering;
 };
 
 struct ThisExpression : IExpression
@@ -154,6 +251,8 @@ struct ThisExpression : IExpression
     virtual void Accept(const IExpressionVisitor& visitor, IExpressionVisitorContext* context) const override;
 
     const Token& m_keyword;
+
+    mutable ResolvedName m_resolved;
 };
 
 struct SuperExpression : IExpression
@@ -164,4 +263,10 @@ struct SuperExpression : IExpression
     
     const Token& m_keyword;
     const Token& m_method;
+
+    mutable ResolvedName m_resolved;
+
+    // the superclass doesn't change once the class is declared, so the method is looked up once per superclass
+    mutable uint64_t m_cachedClassId = 0;
+    mutable const Function* m_cachedMethod = nullptr;
 };
\ No newline at end of file
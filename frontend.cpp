@@ -0,0 +1,216 @@
+#include "frontend.h"
+#include "scanner.h"
+#include "parser.h"
+#include "statements.h"
+#include "gekko.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+    // results of a chunk, errors are kept per phase to be reported in the sequential order
+    struct ChunkResult
+    {
+        std::unique_ptr<Scanner> m_scanner;
+        std::vector<IStatementPtr> m_program;
+        Resolver::Result m_resolution;
+        bool m_parseFailed = false;
+        std::ostringstream m_scanErrors;
+        std::ostringstream m_parseErrors;
+        std::ostringstream m_resolveErrors;
+        std::ostringstream m_log;
+    };
+
+    template<typename TTask>
+    void RunOnAllCores(size_t tasksCount, const TTask& task)
+    {
+        std::atomic<size_t> nextTask = 0;
+        auto worker = [&]()
+        {
+            for (size_t i = nextTask++; i < tasksCount; i = nextTask++)
+            {
+                task(i);
+            }
+        };
+
+        const size_t threadsCount = std::min<size_t>(tasksCount, std::max(1u, std::thread::hardware_concurrency()));
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < threadsCount; ++i)
+        {
+            threads.emplace_back(worker);
+        }
+
+        worker();
+
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    bool StartsWithDeclaration(std::string_view text)
+    {
+        for (std::string_view keyword : { "fun", "class", "var" })
+        {
+            if (text.starts_with(keyword))
+            {
+                const char next = text.size() > keyword.size() ? text[keyword.size()] : '\0';
+                return next == ' ' || next == '\t' || next == '\r' || next == '\n';
+            }
+        }
+
+        return false;
+    }
+}
+
+Frontend::Frontend(bool deferFunctionBodies, size_t chunkSize)
+    : m_deferFunctionBodies(deferFunctionBodies)
+    , m_chunkSize(chunkSize)
+{}
+
+std::vector<Frontend::Chunk> Frontend::Split(std::string_view source) const
+{
+    // a chunk starts with 'fun', 'class' or 'var' at the beginning of a line, outside of any braces,
+    // parentheses, strings and comments, and right after a complete statement
+    std::vector<Chunk> chunks;
+    size_t chunkBegin = 0;
+    int chunkLine = 1;
+
+    int line = 1;
+    int depth = 0;
+    char last = ';';
+    size_t i = 0;
+    while (i < source.size())
+    {
+        const char c = source[i];
+        const char next = i + 1 < source.size() ? source[i + 1] : '\0';
+        if (c == '\n')
+        {
+            ++i;
+            ++line;
+            if (depth == 0 && (last == ';' || last == '}') && i - chunkBegin >= m_chunkSize && StartsWithDeclaration(source.substr(i)))
+            {
+                chunks.push_back({ source.substr(chunkBegin, i - chunkBegin), chunkLine });
+                chunkBegin = i;
+                chunkLine = line;
+            }
+        }
+        else if (c == '"' || (c == '/' && next == '*'))
+        {
+            const size_t end = c == '"' ? source.find('"', i + 1) : source.find("*/", i + 2);
+            if (end == std::string_view::npos)
+            {
+                break; // the rest can't be split
+            }
+
+            line += static_cast<int>(std::count(source.begin() + i, source.begin() + end, '\n'));
+            if (c == '"')
+            {
+                last = c;
+            }
+            i = end + (c == '"' ? 1 : 2);
+        }
+        else if (c == '/' && next == '/')
+        {
+            const size_t end = source.find('\n', i);
+            i = end == std::string_view::npos ? source.size() : end;
+        }
+        else
+        {
+            if (c == '{' || c == '(')
+            {
+                ++depth;
+            }
+            else if (c == '}' || c == ')')
+            {
+                --depth;
+            }
+
+            if (c != ' ' && c != '\t' && c != '\r')
+            {
+                last = c;
+            }
+            ++i;
+        }
+    }
+
+    chunks.push_back({ source.substr(chunkBegin), chunkLine });
+    return chunks;
+}
+
+std::vector<Frontend::Unit> Frontend::Process(const std::vector<std::string_view>& sources, std::ostream& logOutput) const
+{
+    std::vector<std::vector<Chunk>> sourceChunks(sources.size());
+    RunOnAllCores(sources.size(), [&](size_t i)
+    {
+        sourceChunks[i] = Split(sources[i]);
+    });
+
+    std::vector<Chunk> chunks;
+    for (const std::vector<Chunk>& split : sourceChunks)
+    {
+        chunks.insert(chunks.end(), split.begin(), split.end());
+    }
+
+    std::vector<ChunkResult> results(chunks.size());
+    RunOnAllCores(chunks.size(), [&](size_t i)
+    {
+        ChunkResult& result = results[i];
+
+        Gekko::SetErrorOutput(&result.m_scanErrors);
+        result.m_scanner = std::make_unique<Scanner>(chunks[i].m_source, chunks[i].m_line);
+
+        Gekko::SetErrorOutput(&result.m_parseErrors);
+        Parser parser(result.m_scanner->Tokens(), m_deferFunctionBodies);
+        result.m_program = parser.Parse(result.m_log);
+        result.m_parseFailed = parser.HasErrors();
+
+        Gekko::SetErrorOutput(&result.m_resolveErrors);
+        result.m_resolution = Resolver().Resolve(result.m_program);
+
+        Gekko::SetErrorOutput(nullptr);
+    });
+
+    // a sequential parser stops at the first error, so chunks after it are dropped
+    std::vector<Unit> units(sources.size());
+    size_t chunkIndex = 0;
+    for (size_t i = 0; i < sources.size(); ++i)
+    {
+        const size_t chunksBegin = chunkIndex;
+        const size_t chunksEnd = chunksBegin + sourceChunks[i].size();
+        chunkIndex = chunksEnd;
+
+        size_t parsedEnd = chunksBegin;
+        while (parsedEnd < chunksEnd && !results[parsedEnd++].m_parseFailed);
+
+        Unit& unit = units[i];
+        for (size_t chunk = chunksBegin; chunk < chunksEnd; ++chunk)
+        {
+            std::cerr << results[chunk].m_scanErrors.str();
+            unit.m_errorsReported |= !results[chunk].m_scanErrors.str().empty();
+        }
+
+        for (size_t chunk = chunksBegin; chunk < parsedEnd; ++chunk)
+        {
+            std::cerr << results[chunk].m_parseErrors.str();
+            logOutput << results[chunk].m_log.str();
+            unit.m_errorsReported |= !results[chunk].m_parseErrors.str().empty() || !results[chunk].m_resolveErrors.str().empty();
+        }
+
+        for (size_t chunk = chunksBegin; chunk < parsedEnd; ++chunk)
+        {
+            ChunkResult& result = results[chunk];
+            std::cerr << result.m_resolveErrors.str();
+
+            unit.m_scanners.push_back(std::move(result.m_scanner));
+            std::move(result.m_program.begin(), result.m_program.end(), std::back_inserter(unit.m_program));
+            unit.m_resolution.m_hasErrors |= result.m_resolution.m_hasErrors;
+        }
+    }
+
+    return units;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "resolver.h"
+#include <iosfwd>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+class Scanner;
+
+// scans, parses and resolves sources on all cores.
+// large sources are split into chunks at top-level declarations, chunks are processed independently
+// and merged in source order, so programms and reported errors don't depend on the threads timing.
+class Frontend
+{
+public:
+    static constexpr size_t DefaultChunkSize = 64 * 1024;
+
+    struct Unit
+    {
+        std::vector<std::unique_ptr<Scanner>> m_scanners; // own the tokens the programm refers to
+        std::vector<IStatementPtr> m_program;
+        Resolver::Result m_resolution;
+        bool m_errorsReported = false; // also set by errors the interpreter runs despite, like unused variables
+    };
+
+    explicit Frontend(bool deferFunctionBodies = false, size_t chunkSize = DefaultChunkSize);
+
+    // returns a unit per source, errors are reported to std::cerr once all sources are processed
+    std::vector<Unit> Process(const std::vector<std::string_view>& sources, std::ostream& logOutput) const;
+
+private:
+    struct Chunk
+    {
+        std::string_view m_source;
+        int m_line;
+    };
+
+    std::vector<Chunk> Split(std::string_view source) const;
+
+    bool m_deferFunctionBodies;
+    size_t m_chunkSize;
+};
@@ -2,6 +2,11 @@
 #include "statements.h"
 #include "token.h"
 #include "interpreter.h"
+#include "parser.h"
+#include "resolver.h"
+#include "typeinferrer.h"
+#include "escapeanalyzer.h"
+#include "memoization.h"
 #include <assert.h>
 #include <algorithm>
 
@@ -13,7 +18,7 @@ Function::Function(const FunctionDeclarationStatement& declaration, EnvironmentP
 const Function* Function::Bind(std::shared_ptr<ClassInstance> classInstance, FunctionsRegistry& functionsRegistry) const
 {
     EnvironmentPtr localEnvironment = Environment::CreateLocalEnvironment(m_closure);
-    localEnvironment->Define(TokenTypeToStringView(Token::Type::This), Value(classInstance));
+    localEnvironment->Define(SymbolTable::This, Value(classInstance));
     return functionsRegistry.Register<Function>(m_declaration, localEnvironment);
 }
 
@@ -21,15 +26,72 @@ Value Function::Call(const Interpreter& interpreter, EnvironmentPtr globalEnviro
 {
     assert(arguments.size() == m_declaration.m_parameters.size());
 
-    EnvironmentPtr localEnvironment = Environment::CreateLocalEnvironment(m_closure);
+    if (m_declaration.m_deferredBody)
+    {
+        ParseDeferredBody(m_declaration);
+    }
+
+    // only top-level functions are memoized, other closures and bound methods are created again and again
+    Memoization* memoization = interpreter.GetMemoization();
+    if (!memoization || m_declaration.m_type != FunctionDeclarationStatement::FunctionDeclarationType::FreeFunction || m_closure != globalEnvironment)
+    {
+        return Execute(interpreter, m_closure, functionsRegistry, arguments);
+    }
+
+    std::optional<std::string> key;
+    if (const Value* result = memoization->Find(*this, *globalEnvironment, arguments, key))
+    {
+        return *result;
+    }
+
+    Value result = Execute(interpreter, m_closure, functionsRegistry, arguments);
+    if (key)
+    {
+        memoization->Store(*this, std::move(*key), result);
+    }
+    return result;
+}
+
+const FunctionDeclarationStatement& Function::GetDeclaration() const
+{
+    if (m_declaration.m_deferredBody)
+    {
+        ParseDeferredBody(m_declaration);
+    }
+    return m_declaration;
+}
+
+Value Function::CallMethod(const Interpreter& interpreter, std::shared_ptr<ClassInstance> classInstance, FunctionsRegistry& functionsRegistry, const std::vector<Value>& arguments) const
+{
+    assert(arguments.size() == m_declaration.m_parameters.size());
+
+    if (m_declaration.m_deferredBody)
+    {
+        ParseDeferredBody(m_declaration);
+    }
+
+    // the same environments Bind and Call create, methods aren't memoized
+    EnvironmentPtr thisEnvironment = Environment::CreateLocalEnvironment(m_closure);
+    thisEnvironment->Define(SymbolTable::This, Value(classInstance));
+    return Execute(interpreter, thisEnvironment, functionsRegistry, arguments);
+}
+
+bool Function::IsFinal() const
+{
+    return m_declaration.m_final;
+}
+
+Value Function::Execute(const Interpreter& interpreter, EnvironmentPtr closure, FunctionsRegistry& functionsRegistry, const std::vector<Value>& arguments) const
+{
+    EnvironmentPtr localEnvironment = Environment::CreateLocalEnvironment(closure);
 
     for (size_t i = 0; i < arguments.size(); ++i)
     {
         const Token& token = m_declaration.m_parameters[i];
-        localEnvironment->Define(token.m_lexeme, arguments[i]);
+        localEnvironment->Define(token.Symbol(), arguments[i]);
     }
 
-    for (const IStatementPtr& statement : m_declaration.m_body)
+    for (const IStatementPtr& statement : interpreter.GetTieredBody(m_declaration.m_tiering, m_declaration.m_body))
     {
         interpreter.Execute(*statement, localEnvironment, functionsRegistry);
         if (localEnvironment->ReturnRequested())
@@ -40,7 +102,32 @@ Value Function::Call(const Interpreter& interpreter, EnvironmentPtr globalEnviro
 
     return Value();
 }
-    
+
+void Function::ParseDeferredBody(const FunctionDeclarationStatement& declaration)
+{
+    const FunctionDeclarationStatement::DeferredBody& deferredBody = *declaration.m_deferredBody;
+
+    Parser parser(deferredBody.m_tokens);
+    bool hasErrors = !parser.ParseFunctionBody(deferredBody.m_begin, declaration.m_body);
+    if (!hasErrors)
+    {
+        Resolver::Result resolution = Resolver().ResolveDeferredBody(declaration);
+        hasErrors = resolution.m_hasErrors;
+        if (!hasErrors)
+        {
+            TypeInferrer().Infer(declaration.m_body);
+            EscapeAnalyzer().AnalyzeBody(declaration.m_body);
+            declaration.m_deferredBody.reset();
+        }
+    }
+
+    if (hasErrors)
+    {
+        declaration.m_body.clear();
+        throw Interpreter::InterpreterError(declaration.m_name, "Invalid body of function '" + std::string(declaration.m_name.m_lexeme) + "'.");
+    }
+}
+
 int Function::Arity() const
 {
     return static_cast<int>(m_declaration.m_parameters.size());
@@ -10,10 +10,23 @@ public:
     Function(const FunctionDeclarationStatement& declaration, EnvironmentPtr closure);
     const Function* Bind(std::shared_ptr<ClassInstance> classInstance, FunctionsRegistry& functionsRegistry) const;
     virtual Value Call(const Interpreter& interpreter, EnvironmentPtr globals, FunctionsRegistry& functionsRegistry, const std::vector<Value>& arguments) const override;
+    // calls the method on the instance without registering a bound copy of it
+    Value CallMethod(const Interpreter& interpreter, std::shared_ptr<ClassInstance> classInstance, FunctionsRegistry& functionsRegistry, const std::vector<Value>& arguments) const;
     virtual int Arity() const override;
     virtual std::string ToString() const override;
+
+    // parses a deferred body first
+    const FunctionDeclarationStatement& GetDeclaration() const;
+    const EnvironmentPtr& GetClosure() const { return m_closure; }
+    // a final method can't be overridden by subclasses
+    bool IsFinal() const;
+
+    // parses and resolves a body skipped by the parser, throws Interpreter::InterpreterError when it is invalid
+    static void ParseDeferredBody(const FunctionDeclarationStatement& declaration);
   
 protected:
+    Value Execute(const Interpreter& interpreter, EnvironmentPtr closure, FunctionsRegistry& functionsRegistry, const std::vector<Value>& arguments) const;
+
     const FunctionDeclarationStatement& m_declaration;
     EnvironmentPtr m_closure;
 };
\ No newline at end of file
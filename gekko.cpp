@@ -2,6 +2,8 @@
 #include "token.h"
 #include <iostream>
 
+static thread_local std::ostream* errorOutput = nullptr;
+
 void Gekko::ReportError(const Token& token, std::string_view message)
 {
     if (token.m_type == Token::Type::EndOfFile) 
@@ -22,5 +24,11 @@ void Gekko::ReportError(int line, std::string_view message)
 
 void Gekko::ReportError(int line, std::string_view where, std::string_view message)
 {
-    std::cerr << "[line " << line << "] Error " << where << ": " << message << std::endl; 
+    std::ostream& output = errorOutput ? *errorOutput : std::cerr;
+    output << "[line " << line << "] Error " << where << ": " << message << std::endl; 
+}
+
+void Gekko::SetErrorOutput(std::ostream* output)
+{
+    errorOutput = output;
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <iosfwd>
 
 struct Token;
 
@@ -10,4 +11,7 @@ public:
     static void ReportError(const Token& token, std::string_view message);
     static void ReportError(int line, std::string_view message);
     static void ReportError(int line, std::string_view where, std::string_view message);
+
+    // errors reported by the calling thread go to output, nullptr restores std::cerr
+    static void SetErrorOutput(std::ostream* output);
 };
\ No newline at end of file
@@ -0,0 +1,237 @@
+#include "inliner.h"
+#include "expressionvisitor.h"
+#include "expressions.h"
+#include "statements.h"
+#include "function.h"
+#include "lambda.h"
+#include "token.h"
+#include <unordered_map>
+
+namespace
+{
+    struct ClonerContext : IExpressionVisitorContext
+    {
+        std::unordered_map<const Token*, uint32_t> m_slots; // declarations of parameters and locals
+        uint32_t m_calleeSymbol = SymbolTable::None; // calls to it are recursive
+        uint32_t m_depth = 0;
+        size_t m_nodesCount = 0;
+        bool m_failed = false;
+        IExpressionPtr m_result;
+    };
+
+    // copies an expression of an inlined body, renaming parameters and locals to inline frame slots
+    struct ExpressionCloner : IExpressionVisitor
+    {
+        IExpressionPtr Clone(const IExpression& expression, ClonerContext& context) const
+        {
+            if (context.m_failed || ++context.m_nodesCount > Inliner::MaxInlinedNodes)
+            {
+                context.m_failed = true;
+                return nullptr;
+            }
+
+            context.m_result = nullptr;
+            expression.Accept(*this, &context);
+            context.m_failed |= !context.m_result;
+            return std::move(context.m_result);
+        }
+
+        static ClonerContext& GetContext(IExpressionVisitorContext* context)
+        {
+            return *static_cast<ClonerContext*>(context);
+        }
+
+        virtual void VisitUnaryExpression(const UnaryExpression& unaryExpression, IExpressionVisitorContext* context) const override
+        {
+            IExpressionPtr operand = Clone(*unaryExpression.m_expression, GetContext(context));
+            if (operand)
+            {
+                auto clone = std::make_unique<UnaryExpression>(unaryExpression.m_operator, std::move(operand));
+                clone->m_operandType = unaryExpression.m_operandType;
+                GetContext(context).m_result = std::move(clone);
+            }
+        }
+
+        virtual void VisitBinaryExpression(const BinaryExpression& binaryExpression, IExpressionVisitorContext* context) const override
+        {
+            IExpressionPtr left = Clone(*binaryExpression.m_left, GetContext(context));
+            IExpressionPtr right = Clone(*binaryExpression.m_right, GetContext(context));
+            if (left && right)
+            {
+                auto clone = std::make_unique<BinaryExpression>(std::move(left), binaryExpression.m_operator, std::move(right));
+                clone->m_operandsType = binaryExpression.m_operandsType;
+                GetContext(context).m_result = std::move(clone);
+            }
+        }
+
+        virtual void VisitTernaryConditionalExpression(const TernaryConditionalExpression& ternaryConditionalExpression, IExpressionVisitorContext* context) const override
+        {
+            IExpressionPtr condition = Clone(*ternaryConditionalExpression.m_condition, GetContext(context));
+            IExpressionPtr trueBranch = Clone(*ternaryConditionalExpression.m_trueBranch, GetContext(context));
+            IExpressionPtr falseBranch = Clone(*ternaryConditionalExpression.m_falseBranch, GetContext(context));
+            if (condition && trueBranch && falseBranch)
+            {
+                GetContext(context).m_result = std::make_unique<TernaryConditionalExpression>(std::move(condition), std::move(trueBranch), std::move(falseBranch));
+            }
+        }
+
+        virtual void VisitGroupingExpression(const GroupingExpression& groupingExpression, IExpressionVisitorContext* context) const override
+        {
+            if (IExpressionPtr expression = Clone(*groupingExpression.m_expression, GetContext(context)))
+            {
+                GetContext(context).m_result = std::make_unique<GroupingExpression>(std::move(expression));
+            }
+        }
+
+        virtual void VisitLiteralExpression(const LiteralExpression& literalExpression, IExpressionVisitorContext* context) const override
+        {
+            GetContext(context).m_result = std::make_unique<LiteralExpression>(literalExpression.m_value);
+        }
+
+        virtual void VisitVariableExpression(const VariableExpression& variableExpression, IExpressionVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetContext(context);
+
+            // names captured from enclosing functions aren't reachable from the call site
+            ResolvedName resolved = variableExpression.m_resolved;
+            auto slot = resolved.m_declaration ? clonerContext.m_slots.find(resolved.m_declaration) : clonerContext.m_slots.end();
+            if (slot != clonerContext.m_slots.end())
+            {
+                resolved.m_distance = ResolvedName::Inlined;
+                resolved.m_inlineSlot = slot->second;
+            }
+            else if (!resolved.m_constant && resolved.m_distance != ResolvedName::Global)
+            {
+                return;
+            }
+
+            auto clone = std::make_unique<VariableExpression>(variableExpression.m_name);
+            clone->m_resolved = resolved;
+            clonerContext.m_result = std::move(clone);
+        }
+
+        virtual void VisitLogicalExpression(const LogicalExpression& logicalExpression, IExpressionVisitorContext* context) const override
+        {
+            IExpressionPtr left = Clone(*logicalExpression.m_left, GetContext(context));
+            IExpressionPtr right = Clone(*logicalExpression.m_right, GetContext(context));
+            if (left && right)
+            {
+                GetContext(context).m_result = std::make_unique<LogicalExpression>(std::move(left), logicalExpression.m_operator, std::move(right));
+            }
+        }
+
+        virtual void VisitCallExpression(const CallExpression& callExpression, IExpressionVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetContext(context);
+
+            const VariableExpression* callee = callExpression.m_calleeVariable;
+            if (callee && callee->m_resolved.m_distance == ResolvedName::Global && callee->m_name.Symbol() == clonerContext.m_calleeSymbol)
+            {
+                return; // recursive
+            }
+
+            IExpressionPtr clonedCallee = Clone(*callExpression.m_calle, clonerContext);
+            std::vector<IExpressionPtr> arguments;
+            for (const IExpressionPtr& argument : callExpression.m_arguments)
+            {
+                arguments.push_back(Clone(*argument, clonerContext));
+            }
+
+            if (!clonerContext.m_failed)
+            {
+                const VariableExpression* clonedCalleeVariable = dynamic_cast<const VariableExpression*>(clonedCallee.get());
+                auto clone = std::make_unique<CallExpression>(std::move(clonedCallee), callExpression.m_token, std::move(arguments));
+                clone->m_calleeVariable = clonedCalleeVariable;
+                clone->m_calleeProperty = dynamic_cast<const GetExpression*>(clone->m_calle.get());
+                clone->m_inlineDepth = clonerContext.m_depth + 1;
+                clonerContext.m_result = std::move(clone);
+            }
+        }
+
+        virtual void VisitGetExpression(const GetExpression& getExpression, IExpressionVisitorContext* context) const override
+        {
+            if (IExpressionPtr owner = Clone(*getExpression.m_owner, GetContext(context)))
+            {
+                GetContext(context).m_result = std::make_unique<GetExpression>(std::move(owner), getExpression.m_name);
+            }
+        }
+
+        // assignments, property sets, lambdas, 'this' and 'super' leave the result empty and fail the inlining
+    };
+}
+
+std::unique_ptr<const InlinedBody> Inliner::Inline(const CallExpression& callExpression, const ICallable& callee, const Environment& globals)
+{
+    if (callExpression.m_inlineDepth >= MaxInlineDepth)
+    {
+        return nullptr;
+    }
+
+    // only functions closed over the global environment see the same names from any call site
+    const FunctionDeclarationStatement::ParametersType* parameters = nullptr;
+    const FunctionDeclarationStatement::BodyType* body = nullptr;
+    ClonerContext context;
+    if (const Function* function = dynamic_cast<const Function*>(&callee))
+    {
+        const FunctionDeclarationStatement& declaration = function->GetDeclaration();
+        if (declaration.m_type != FunctionDeclarationStatement::FunctionDeclarationType::FreeFunction || function->GetClosure().get() != &globals)
+        {
+            return nullptr;
+        }
+
+        parameters = &declaration.m_parameters;
+        body = &declaration.m_body;
+        context.m_calleeSymbol = declaration.m_name.Symbol();
+    }
+    else if (const Lambda* lambda = dynamic_cast<const Lambda*>(&callee))
+    {
+        if (lambda->GetClosure().get() != &globals)
+        {
+            return nullptr;
+        }
+
+        parameters = &lambda->GetExpression().m_parameters;
+        body = &lambda->GetExpression().m_body;
+    }
+    else
+    {
+        return nullptr;
+    }
+
+    const ReturnStatement* returnStatement = body->empty() ? nullptr : dynamic_cast<const ReturnStatement*>(body->back().get());
+    if (!returnStatement || !returnStatement->m_returnValue)
+    {
+        return nullptr;
+    }
+
+    for (const Token& parameter : *parameters)
+    {
+        context.m_slots.emplace(&parameter, static_cast<uint32_t>(context.m_slots.size()));
+    }
+    context.m_depth = callExpression.m_inlineDepth;
+
+    ExpressionCloner cloner;
+    auto inlined = std::make_unique<InlinedBody>();
+    inlined->m_callee = &callee;
+    for (size_t i = 0; i + 1 < body->size(); ++i)
+    {
+        const VariableDeclarationStatement* local = dynamic_cast<const VariableDeclarationStatement*>((*body)[i].get());
+        if (!local)
+        {
+            return nullptr;
+        }
+
+        // a local is visible only after its initializer
+        inlined->m_locals.push_back(local->m_initializer ? cloner.Clone(*local->m_initializer, context) : std::make_unique<LiteralExpression>());
+        context.m_slots.insert_or_assign(&local->m_name, static_cast<uint32_t>(context.m_slots.size()));
+    }
+
+    inlined->m_result = cloner.Clone(*returnStatement->m_returnValue, context);
+    if (context.m_failed)
+    {
+        return nullptr;
+    }
+
+    inlined->m_slotsCount = static_cast<uint32_t>(context.m_slots.size());
+    return inlined;
+}
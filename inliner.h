@@ -0,0 +1,22 @@
+#pragma once
+
+#include <memory>
+
+class ICallable;
+struct Environment;
+struct CallExpression;
+struct InlinedBody;
+
+// substitutes bodies of small functions at call sites.
+// a body can be inlined when it consists of 'var' declarations followed by a return of an expression,
+// it reads only its parameters, its locals, constants and globals and doesn't assign, create closures or use 'this'.
+// parameters and locals are renamed to slots of an inline frame, so the body is evaluated without an environment.
+class Inliner
+{
+public:
+    static constexpr size_t MaxInlinedNodes = 32;
+    static constexpr uint32_t MaxInlineDepth = 2; // stops unrolling of mutually recursive functions
+
+    // expects a callee whose arity was checked against the call site, returns nullptr when it can't be inlined
+    static std::unique_ptr<const InlinedBody> Inline(const CallExpression& callExpression, const ICallable& callee, const Environment& globals);
+};
@@ -6,7 +6,14 @@
 #include "function.h"
 #include "lambda.h"
 #include "class.h"
+#include "memoization.h"
+#include "inliner.h"
+#include "specializer.h"
+#include "compilationqueue.h"
+#include "escapeanalyzer.h"
+#include "trace.h"
 #include <assert.h>
+#include <atomic>
 #include <sstream>
 
 FunctionsRegistry::~FunctionsRegistry()
@@ -62,12 +69,21 @@ EnvironmentPtr Environment::CreateLocalEnvironment(EnvironmentPtr outer)
     return std::shared_ptr<Environment>(new Environment(outer));
 }
 
+namespace
+{
+    std::atomic<uint64_t> NextEnvironmentId = 1;
+}
+
 Environment::Environment(std::ostream& output)
-    : m_outputStream(output)
+    : m_global(this)
+    , m_id(NextEnvironmentId++)
+    , m_outputStream(output)
 {}
 
 Environment::Environment(EnvironmentPtr outer)
     : m_outer(outer)
+    , m_global(outer->m_global)
+    , m_id(NextEnvironmentId++)
     , m_outputStream(outer->m_outputStream)
 {
     assert(!m_outer->m_break);
@@ -85,15 +101,20 @@ Environment::~Environment()
     }
 }
 
-void Environment::Define(std::string_view name, const Value& value)
+void Environment::Define(uint32_t symbol, const Value& value)
 {
-     m_values.insert_or_assign(std::string(name), value);
+     m_values.insert_or_assign(symbol, value);
+}
+
+Value* Environment::FindLocal(uint32_t symbol)
+{
+    auto it = m_values.find(symbol);
+    return it != m_values.end() ? &it->second : nullptr;
 }
 
 void Environment::Assign(const Token& token, const Value& value)
 {
-    std::string name(token.m_lexeme);
-    auto it = m_values.find(name);
+    auto it = m_values.find(token.Symbol());
     if (it != m_values.end())
     {
         it->second = value;
@@ -104,7 +125,7 @@ void Environment::Assign(const Token& token, const Value& value)
     }
     else
     {
-        throw Interpreter::InterpreterError(token, "Undefined variable '" + name + "'.");
+        throw Interpreter::InterpreterError(token, "Undefined variable '" + std::string(token.m_lexeme) + "'.");
     }
 }
 
@@ -115,8 +136,7 @@ void Environment::Assign(const Token& token, const Value& value, size_t distance
 
 Value Environment::GetValue(const Token& token) const
 {
-    std::string name(token.m_lexeme);
-    auto it = m_values.find(name);
+    auto it = m_values.find(token.Symbol());
     if (it != m_values.end())
     {
         return it->second;
@@ -126,7 +146,7 @@ Value Environment::GetValue(const Token& token) const
         return m_outer->GetValue(token);
     }
 
-    throw Interpreter::InterpreterError(token, "Undefined variable '" + name + "'.");
+    throw Interpreter::InterpreterError(token, "Undefined variable '" + std::string(token.m_lexeme) + "'.");
 }
 
 Value Environment::GetValue(const Token& token, size_t distance) const
@@ -181,12 +201,7 @@ const Value& Environment::GetReturnValue() const
 
 EnvironmentPtr Environment::GetGlobalEnvironment()
 {
-    if (m_outer)
-    {
-        return m_outer->GetGlobalEnvironment();
-    }
-
-    return shared_from_this();
+    return m_global->shared_from_this();
 }
 
 std::ostream& Environment::GetOutputStream()
@@ -194,12 +209,56 @@ std::ostream& Environment::GetOutputStream()
     return m_outputStream;
 }
 
-Interpreter::Interpreter(EnvironmentPtr environment, FunctionsRegistry& functionsRegistry, std::map<const IExpression*, size_t>&& locals)
-    : m_locals(locals)
+Interpreter::Interpreter(EnvironmentPtr environment, FunctionsRegistry& functionsRegistry)
+    : m_specializer(std::make_unique<Specializer>())
 {
     RegisterNativeFunctions(environment, functionsRegistry);
 }
 
+Interpreter::~Interpreter() = default;
+
+void Interpreter::EnableMemoization(size_t maxEntriesPerFunction)
+{
+    m_memoization = std::make_unique<Memoization>(maxEntriesPerFunction);
+}
+
+const std::vector<IStatementPtr>& Interpreter::GetTieredBody(Tiering& tiering, const std::vector<IStatementPtr>& body) const
+{
+    if (const std::vector<IStatementPtr>* optimized = tiering.m_optimized.load(std::memory_order_acquire))
+    {
+        return *optimized;
+    }
+
+    if (!tiering.m_queued && ++tiering.m_callsCount >= HotCallsCount)
+    {
+        tiering.m_queued = true;
+        if (!m_compilationQueue)
+        {
+            m_compilationQueue = std::make_unique<CompilationQueue>();
+        }
+
+        // bodies that fail to fold stay in the baseline engine
+        m_compilationQueue->Enqueue([&tiering, &body]()
+        {
+            tiering.m_optimizedBody = Specializer::Fold(body);
+            if (tiering.m_optimizedBody)
+            {
+                tiering.m_optimized.store(tiering.m_optimizedBody.get(), std::memory_order_release);
+            }
+        });
+    }
+
+    return body;
+}
+
+void Interpreter::WaitForCompilations() const
+{
+    if (m_compilationQueue)
+    {
+        m_compilationQueue->Drain();
+    }
+}
+
 bool Interpreter::AreEqual(const Token& token, const Value& lhs, const Value& rhs)
 {
     if (!lhs.HasValue())
@@ -283,13 +342,54 @@ void Interpreter::VisitPrintStatement(const PrintStatement& statement, IStatemen
 void Interpreter::VisitVariableDeclarationStatement(const VariableDeclarationStatement& statement, IStatementVisitorContext* context) const
 {
     EnvironmentPtr environment = GetEnvironment(*context);
+    if (statement.m_scalarReplacement && DefineScalarReplaced(statement, environment, GetFunctionsRegistry(*context)))
+    {
+        return;
+    }
+
     Value value;
     if (statement.m_initializer)
     {
         value = Eval(*statement.m_initializer, environment, GetFunctionsRegistry(*context));
     }
 
-    environment->Define(statement.m_name.m_lexeme, value);
+    environment->Define(statement.m_name.Symbol(), value);
+}
+
+bool Interpreter::DefineScalarReplaced(const VariableDeclarationStatement& statement, EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const
+{
+    const ScalarReplacement& replacement = *statement.m_scalarReplacement;
+    const CallExpression& callExpression = static_cast<const CallExpression&>(*statement.m_initializer);
+
+    // the callee is a variable, so the generic path can evaluate it again
+    const Value calle = Eval(*callExpression.m_calle, environment, functionsRegistry);
+    const std::shared_ptr<const Class>* classDefinition = calle.GetClass();
+    if (!classDefinition || !EscapeAnalyzer::CanReplace(replacement, *classDefinition, callExpression.m_arguments.size()))
+    {
+        return false;
+    }
+
+    std::vector<Value> arguments;
+    arguments.reserve(callExpression.m_arguments.size());
+    for (const IExpressionPtr& expression : callExpression.m_arguments)
+    {
+        arguments.emplace_back(Eval(*expression, environment, functionsRegistry));
+    }
+
+    for (const ScalarReplacement::FieldInitializer& initializer : replacement.m_initializers)
+    {
+        environment->Define(replacement.m_slots[initializer.m_field], initializer.m_literal ? *initializer.m_literal : arguments[initializer.m_argument]);
+    }
+    environment->Define(statement.m_name.Symbol(), Value());
+    return true;
+}
+
+Value* Interpreter::FindScalarField(const IExpression& owner, uint32_t field, EnvironmentPtr environment)
+{
+    const VariableExpression& variable = static_cast<const VariableExpression&>(owner);
+    EnvironmentPtr variableEnvironment = GetAncestorEnvironment(variable.m_resolved.m_distance, environment);
+    const Value* instance = variableEnvironment->FindLocal(variable.m_name.Symbol());
+    return instance && !instance->HasValue() ? variableEnvironment->FindLocal(field) : nullptr;
 }
 
 void Interpreter::VisitFunctionDeclarationStatement(const FunctionDeclarationStatement& statement, IStatementVisitorContext* context) const
@@ -297,7 +397,7 @@ void Interpreter::VisitFunctionDeclarationStatement(const FunctionDeclarationSta
     EnvironmentPtr environment = GetEnvironment(*context);
 
     const ICallable* callable = GetFunctionsRegistry(*context).Register<const Function>(statement, environment);
-    environment->Define(statement.m_name.m_lexeme, Value(callable));
+    environment->Define(statement.m_name.Symbol(), Value(callable));
 }
 
 void Interpreter::VisitClassDeclarationStatement(const ClassDeclarationStatement& statement, IStatementVisitorContext* context) const
@@ -317,16 +417,27 @@ void Interpreter::VisitClassDeclarationStatement(const ClassDeclarationStatement
             throw InterpreterError(statement.m_superClass->m_name, "Superclass must be a class.");
         }
 
+        if (superClass->IsFinal())
+        {
+            throw InterpreterError(statement.m_superClass->m_name, "Can't inherit from final class '" + std::string(superClass->ToString()) + "'.");
+        }
+
         environment = Environment::CreateLocalEnvironment(environment);
-        environment->Define(TokenTypeToStringView(Token::Type::Super), superClassValue);
+        environment->Define(SymbolTable::Super, superClassValue);
     } 
 
-    std::map<std::string_view, const Function*> methods;
-    std::map<std::string_view, const Function*> staticMethods;
-    std::map<std::string_view, const Function*> getters;
+    Class::Methods methods;
+    Class::Methods staticMethods;
+    Class::Methods getters;
     for (const std::unique_ptr<FunctionDeclarationStatement>& methodDeclaration : statement.m_methods)
     {
-        const std::string_view methodName = methodDeclaration->m_name.m_lexeme;
+        const uint32_t methodName = methodDeclaration->m_name.Symbol();
+        const Function* overridden = superClass && methodDeclaration->m_type == FunctionDeclarationStatement::FunctionDeclarationType::MemberFunction ? superClass->GetMethod(methodName) : nullptr;
+        if (overridden && overridden->IsFinal())
+        {
+            throw InterpreterError(methodDeclaration->m_name, "Can't override final method '" + std::string(methodDeclaration->m_name.m_lexeme) + "'.");
+        }
+
         const Function* function = functionsRegistry.Register<Function>(*methodDeclaration.get(), environment);
         switch (methodDeclaration->m_type)
         {
@@ -347,20 +458,60 @@ void Interpreter::VisitClassDeclarationStatement(const ClassDeclarationStatement
         environment = environment->GetOuter();
     }
 
+    Class::Fields fields;
+    for (const Token& field : statement.m_fields)
+    {
+        if (superClass && superClass->FindField(field.Symbol()) != Class::NoField)
+        {
+            std::string errorMessage = "Field '" + std::string(field.m_lexeme) + "' is already declared in a superclass.";
+            throw InterpreterError(field, errorMessage);
+        }
+
+        const Function* method = superClass ? superClass->GetMethod(field.Symbol()) : nullptr;
+        if (method && method->IsFinal())
+        {
+            throw InterpreterError(field, "Field '" + std::string(field.m_lexeme) + "' hides a final method.");
+        }
+        fields.push_back(field.Symbol());
+    }
+
+    if (!fields.empty() && superClass && !superClass->IsRecord())
+    {
+        throw InterpreterError(statement.m_superClass->m_name, "A record class can only inherit from a record class.");
+    }
+
     std::shared_ptr<Class> classDefinition = std::make_shared<Class>(
-        statement.m_name.m_lexeme, superClass, std::move(methods), std::move(staticMethods), std::move(getters));
+        statement.m_name, superClass, std::move(methods), std::move(staticMethods), std::move(getters), fields, statement.m_final);
 
-    environment->Define(statement.m_name.m_lexeme, Value(classDefinition)); 
+    environment->Define(statement.m_name.Symbol(), Value(classDefinition)); 
 }
 
 void Interpreter::VisitBlockStatement(const BlockStatement& statement, IStatementVisitorContext* context) const
 {
     EnvironmentPtr outer = GetEnvironment(*context);
-    EnvironmentPtr inner = Environment::CreateLocalEnvironment(outer);
-    FunctionsRegistry& functionsRegistry = GetFunctionsRegistry(*context);
-    for (const IStatementPtr& statement : statement.m_block)
+    EnvironmentPtr inner = statement.m_hasScope ? Environment::CreateLocalEnvironment(outer) : outer;
+    ExecuteBlock(statement.m_block, 0, inner, outer, GetFunctionsRegistry(*context));
+}
+
+void Interpreter::ExecuteBlock(const std::vector<IStatementPtr>& statements, size_t first, EnvironmentPtr inner, EnvironmentPtr outer, FunctionsRegistry& functionsRegistry) const
+{
+    if (inner == outer)
+    {
+        // break and return requests are raised on the enclosing environment directly
+        for (size_t i = first; i < statements.size(); ++i)
+        {
+            Execute(*statements[i], outer, functionsRegistry);
+            if (outer->BreakRequested() || outer->ReturnRequested())
+            {
+                break;
+            }
+        }
+        return;
+    }
+
+    for (size_t i = first; i < statements.size(); ++i)
     {
-        Execute(*statement, inner, functionsRegistry);
+        Execute(*statements[i], inner, functionsRegistry);
         if (inner->BreakRequested())
         {
             break;
@@ -395,9 +546,45 @@ void Interpreter::VisitWhileStatement(const WhileStatement& statement, IStatemen
     EnvironmentPtr environment = GetEnvironment(*context);
     FunctionsRegistry& functionsRegistry = GetFunctionsRegistry(*context);
 
-    while (Eval(*statement.m_condition, environment, functionsRegistry).IsTruthy())
+    while (true)
     {
-        Execute(*statement.m_body, environment, functionsRegistry);
+        if (!statement.m_trace && !statement.m_untraceable && ++statement.m_iterations >= Trace::HotLoopIterations)
+        {
+            statement.m_trace = Trace::Record(statement, *environment);
+            statement.m_untraceable = !statement.m_trace;
+        }
+
+        // a hot loop runs in its trace, a failed guard leaves the rest of the iteration to the interpreter
+        bool iterationDone = false;
+        if (statement.m_trace)
+        {
+            Trace::Exit exit = statement.m_trace->Execute(*environment);
+            if (exit.m_reason == Trace::ExitReason::LoopEnd || exit.m_reason == Trace::ExitReason::Break)
+            {
+                break;
+            }
+            else if (exit.m_reason == Trace::ExitReason::SideExit)
+            {
+                ResumeIteration(statement, exit, environment, functionsRegistry);
+                iterationDone = true;
+            }
+
+            if (!statement.m_trace->IsProfitable())
+            {
+                statement.m_trace.reset();
+                statement.m_untraceable = true;
+            }
+        }
+
+        if (!iterationDone)
+        {
+            if (!Eval(*statement.m_condition, environment, functionsRegistry).IsTruthy())
+            {
+                break;
+            }
+            Execute(*statement.m_body, environment, functionsRegistry);
+        }
+
         if (environment->BreakRequested())
         {
             environment->ClearBreak();
@@ -411,6 +598,105 @@ void Interpreter::VisitWhileStatement(const WhileStatement& statement, IStatemen
     }
 }
 
+void Interpreter::ResumeIteration(const WhileStatement& statement, const Trace::Exit& exit, EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const
+{
+    const BlockStatement* block = dynamic_cast<const BlockStatement*>(statement.m_body.get());
+    if (!block)
+    {
+        Execute(*statement.m_body, environment, functionsRegistry);
+        return;
+    }
+
+    // the locals the trace declared so far are defined in the environment of the body
+    EnvironmentPtr inner = block->m_hasScope ? Environment::CreateLocalEnvironment(environment) : environment;
+    for (const auto& [symbol, value] : exit.m_locals)
+    {
+        inner->Define(symbol, value);
+    }
+    ExecuteBlock(block->m_block, exit.m_statement, inner, environment, functionsRegistry);
+}
+
+void Interpreter::VisitForStatement(const ForStatement& statement, IStatementVisitorContext* context) const
+{
+    EnvironmentPtr environment = GetEnvironment(*context);
+    FunctionsRegistry& functionsRegistry = GetFunctionsRegistry(*context);
+
+    // one environment holds the loop variable for all iterations
+    EnvironmentPtr loopEnvironment = statement.m_hasScope ? Environment::CreateLocalEnvironment(environment) : environment;
+    if (statement.m_initializer)
+    {
+        Execute(*statement.m_initializer, loopEnvironment, functionsRegistry);
+    }
+
+    // counted loops read and update the counter in place, map nodes never move
+    Value* counter = statement.m_counter ? loopEnvironment->FindLocal(statement.m_counter->Symbol()) : nullptr;
+    double rangeEnd = 0.0;
+    if (statement.m_rangeEnd)
+    {
+        rangeEnd = GetNumberOperand(*statement.m_comparison, Eval(*statement.m_rangeEnd, loopEnvironment, functionsRegistry));
+    }
+
+    ExpressionVisitorContext comparison(loopEnvironment, functionsRegistry);
+    while (true)
+    {
+        if (statement.m_rangeEnd)
+        {
+            if (GetNumberOperand(*statement.m_comparison, *counter) >= rangeEnd)
+            {
+                break;
+            }
+        }
+        else if (counter)
+        {
+            Value limit = Eval(*statement.m_limit, loopEnvironment, functionsRegistry);
+            const double* counterValue = counter->GetNumber();
+            const double* limitValue = limit.GetNumber();
+            if (counterValue && limitValue)
+            {
+                ApplyNumberOperator(*statement.m_comparison, *counterValue, *limitValue, comparison);
+            }
+            else
+            {
+                ApplyGenericOperator(*statement.m_comparison, *counter, limit, comparison);
+            }
+
+            if (!comparison.m_result.IsTruthy())
+            {
+                break;
+            }
+        }
+        else if (statement.m_condition && !Eval(*statement.m_condition, loopEnvironment, functionsRegistry).IsTruthy())
+        {
+            break;
+        }
+
+        Execute(*statement.m_body, loopEnvironment, functionsRegistry);
+        if (loopEnvironment->BreakRequested())
+        {
+            loopEnvironment->ClearBreak();
+            break;
+        }
+
+        if (loopEnvironment->ReturnRequested())
+        {
+            if (loopEnvironment != environment)
+            {
+                environment->RequestReturn(loopEnvironment->GetReturnValue());
+            }
+            break;
+        }
+
+        if (counter && counter->GetNumber())
+        {
+            *counter = Value(*counter->GetNumber() + statement.m_step);
+        }
+        else if (statement.m_increment)
+        {
+            Eval(*statement.m_increment, loopEnvironment, functionsRegistry);
+        }
+    }
+}
+
 void Interpreter::VisitBreakStatement(const BreakStatement& statement, IStatementVisitorContext* context) const
 {
     GetEnvironment(*context)->RequestBreak();
@@ -424,48 +710,179 @@ void Interpreter::VisitReturnStatement(const ReturnStatement& statement, IStatem
 
 void Interpreter::VisitUnaryExpression(const UnaryExpression& unaryExpression, IExpressionVisitorContext* context) const
 {
-    Value expResult = Eval(*unaryExpression.m_expression, GetEnvironment(*context), GetFunctionsRegistry(*context));
-
     ExpressionVisitorContext* result = static_cast<ExpressionVisitorContext*>(context);
-    if (unaryExpression.m_operator.m_type == Token::Type::Minus)
+
+    if (unaryExpression.m_operandType == ExpressionType::Number)
     {
-        double number = GetNumberOperand(unaryExpression.m_operator, expResult);
-        result->m_result = Value(-number);
+        const double number = EvalNumber(*unaryExpression.m_expression, GetEnvironment(*context), GetFunctionsRegistry(*context));
+        result->SetNumber(unaryExpression.m_operator.m_type == Token::Type::Minus ? -number : number);
+        return;
     }
-    else if (unaryExpression.m_operator.m_type == Token::Type::Plus)
+
+    Value expResult = Eval(*unaryExpression.m_expression, GetEnvironment(*context), GetFunctionsRegistry(*context));
+    result->m_result = ApplyUnaryOperator(unaryExpression.m_operator, expResult);
+}
+
+Value Interpreter::ApplyUnaryOperator(const Token& op, const Value& operand)
+{
+    if (op.m_type == Token::Type::Minus)
     {
-        double number = GetNumberOperand(unaryExpression.m_operator, expResult);
-        result->m_result = Value(number);
+        return Value(-GetNumberOperand(op, operand));
     }
-    else if (unaryExpression.m_operator.m_type == Token::Type::Bang)
+    else if (op.m_type == Token::Type::Plus)
     {
-        result->m_result = Value(!expResult.IsTruthy());
+        return Value(GetNumberOperand(op, operand));
     }
-    else
+    else if (op.m_type == Token::Type::Bang)
     {
-        throw InterpreterError(unaryExpression.m_operator, "Unsupported unary operator.");
+        return Value(!operand.IsTruthy());
     }
+
+    throw InterpreterError(op, "Unsupported unary operator.");
+}
+
+Value Interpreter::ApplyBinaryOperator(const Token& op, const Value& lhs, const Value& rhs, FunctionsRegistry& functionsRegistry)
+{
+    ExpressionVisitorContext result(nullptr, functionsRegistry);
+    ApplyGenericOperator(op, lhs, rhs, result);
+    return result.m_result;
 }
 
 void Interpreter::VisitBinaryExpression(const BinaryExpression& binaryExpression, IExpressionVisitorContext* context) const
 {
     EnvironmentPtr environment = GetEnvironment(*context);
+    FunctionsRegistry& functionsRegistry = GetFunctionsRegistry(*context);
     
     ExpressionVisitorContext* exprResult = static_cast<ExpressionVisitorContext*>(context);
 
-    Value leftExprResult = Eval(*binaryExpression.m_left, environment, GetFunctionsRegistry(*context));
+    switch (binaryExpression.m_operandsType)
+    {
+    case ExpressionType::Number:
+    {
+        const double lhs = EvalNumber(*binaryExpression.m_left, environment, functionsRegistry);
+        const double rhs = EvalNumber(*binaryExpression.m_right, environment, functionsRegistry);
+        ApplyNumberOperator(binaryExpression.m_operator, lhs, rhs, *exprResult);
+    } return;
+    case ExpressionType::String:
+    {
+        Value lhs = Eval(*binaryExpression.m_left, environment, functionsRegistry);
+        Value rhs = Eval(*binaryExpression.m_right, environment, functionsRegistry);
+        ApplyStringOperator(binaryExpression.m_operator, *lhs.GetString(), *rhs.GetString(), *exprResult);
+    } return;
+    case ExpressionType::Boolean:
+    {
+        Value lhs = Eval(*binaryExpression.m_left, environment, functionsRegistry);
+        Value rhs = Eval(*binaryExpression.m_right, environment, functionsRegistry);
+        const bool result = *lhs.GetBoolean() == *rhs.GetBoolean();
+        exprResult->m_result = Value(binaryExpression.m_operator.m_type == Token::Type::EqualEqual ? result : !result);
+    } return;
+    default: break;
+    }
+
+    Value leftExprResult = Eval(*binaryExpression.m_left, environment, functionsRegistry);
+    Value rightExprResult = Eval(*binaryExpression.m_right, environment, functionsRegistry);
+
+    // the node specializes itself on the operand types it has seen so far and falls back to the generic path for good once they change
+    switch (binaryExpression.m_feedback)
+    {
+    case TypeFeedback::Uninitialized:
+    {
+        binaryExpression.m_feedback = ObserveOperands(binaryExpression.m_operator, leftExprResult, rightExprResult);
+    } break;
+    case TypeFeedback::Number:
+    {
+        const double* lhs = leftExprResult.GetNumber();
+        const double* rhs = rightExprResult.GetNumber();
+        if (lhs && rhs)
+        {
+            ApplyNumberOperator(binaryExpression.m_operator, *lhs, *rhs, *exprResult);
+            return;
+        }
+
+        binaryExpression.m_feedback = TypeFeedback::Generic;
+    } break;
+    case TypeFeedback::String:
+    {
+        const std::string* lhs = leftExprResult.GetString();
+        const std::string* rhs = rightExprResult.GetString();
+        if (lhs && rhs)
+        {
+            ApplyStringOperator(binaryExpression.m_operator, *lhs, *rhs, *exprResult);
+            return;
+        }
+
+        binaryExpression.m_feedback = TypeFeedback::Generic;
+    } break;
+    default: break;
+    }
 
-    Token::Type operatorType = binaryExpression.m_operator.m_type;
+    ApplyGenericOperator(binaryExpression.m_operator, leftExprResult, rightExprResult, *exprResult);
+}
 
-    switch (operatorType)
+TypeFeedback Interpreter::ObserveOperands(const Token& op, const Value& lhs, const Value& rhs)
+{
+    if (op.m_type == Token::Type::Comma)
+    {
+        return TypeFeedback::Generic;
+    }
+    else if (lhs.GetNumber() && rhs.GetNumber())
+    {
+        return TypeFeedback::Number;
+    }
+    else if (lhs.GetString() && rhs.GetString())
+    {
+        const bool stringOperator = op.m_type == Token::Type::Plus || op.m_type == Token::Type::EqualEqual || op.m_type == Token::Type::BangEqual;
+        return stringOperator ? TypeFeedback::String : TypeFeedback::Generic;
+    }
+
+    return TypeFeedback::Generic;
+}
+
+void Interpreter::ApplyNumberOperator(const Token& op, double lhs, double rhs, ExpressionVisitorContext& result)
+{
+    switch (op.m_type)
+    {
+    case Token::Type::Slash:
+    {
+        if (rhs == 0.0)
+        {
+            throw InterpreterError(op, "Division by zero.");
+        }
+        result.SetNumber(lhs / rhs);
+    } break;
+    case Token::Type::Star:         result.SetNumber(lhs * rhs); break;
+    case Token::Type::Minus:        result.SetNumber(lhs - rhs); break;
+    case Token::Type::Plus:         result.SetNumber(lhs + rhs); break;
+    case Token::Type::Less:         result.m_result = Value(lhs < rhs); break;
+    case Token::Type::LessEqual:    result.m_result = Value(lhs <= rhs); break;
+    case Token::Type::Greater:      result.m_result = Value(lhs > rhs); break;
+    case Token::Type::GreaterEqual: result.m_result = Value(lhs >= rhs); break;
+    case Token::Type::EqualEqual:   result.m_result = Value(lhs == rhs); break;
+    case Token::Type::BangEqual:    result.m_result = Value(lhs != rhs); break;
+    default: throw InterpreterError(op, "Unsuported binary operator"); break;
+    }
+}
+
+void Interpreter::ApplyStringOperator(const Token& op, const std::string& lhs, const std::string& rhs, ExpressionVisitorContext& result)
+{
+    switch (op.m_type)
+    {
+    case Token::Type::Plus:         result.m_result = Value(lhs + rhs); break;
+    case Token::Type::EqualEqual:   result.m_result = Value(lhs == rhs); break;
+    case Token::Type::BangEqual:    result.m_result = Value(lhs != rhs); break;
+    default: throw InterpreterError(op, "Unsuported binary operator"); break;
+    }
+}
+
+void Interpreter::ApplyGenericOperator(const Token& op, const Value& lhs, const Value& rhs, ExpressionVisitorContext& result)
+{
+    switch (op.m_type)
     {
     case Token::Type::EqualEqual:
     case Token::Type::BangEqual:
     {
-        Value rightExprResult = Eval(*binaryExpression.m_right, environment, GetFunctionsRegistry(*context));
-
-        bool result = AreEqual(binaryExpression.m_operator, leftExprResult, rightExprResult);
-        exprResult->m_result = Value(operatorType == Token::Type::EqualEqual ? result : !result);        
+        bool equal = AreEqual(op, lhs, rhs);
+        result.m_result = Value(op.m_type == Token::Type::EqualEqual ? equal : !equal);        
     } break;
 
     case Token::Type::Minus:
@@ -477,49 +894,25 @@ void Interpreter::VisitBinaryExpression(const BinaryExpression& binaryExpression
     case Token::Type::Greater:
     case Token::Type::GreaterEqual:
     {
-        if (Token::Type::Plus == operatorType)
+        if (Token::Type::Plus == op.m_type)
         {
-            if (const std::string* lhs = leftExprResult.GetString())
+            if (const std::string* lhsString = lhs.GetString())
             {
-                Value rightExprResult = Eval(*binaryExpression.m_right, environment, GetFunctionsRegistry(*context));
-                if (const std::string* rhs = rightExprResult.GetString())
+                if (const std::string* rhsString = rhs.GetString())
                 {
-                    exprResult->m_result = Value(*lhs + *rhs);
+                    result.m_result = Value(*lhsString + *rhsString);
                     return;
                 }
                 else
                 {
-                    throw InterpreterError(binaryExpression.m_operator, "Expecting string as right hand operand.");
+                    throw InterpreterError(op, "Expecting string as right hand operand.");
                 }
             }
         }
 
-        double lhs = GetNumberOperand(binaryExpression.m_operator, leftExprResult);
-
-        Value rightExprResult = Eval(*binaryExpression.m_right, environment, GetFunctionsRegistry(*context));
-
-        double rhs = GetNumberOperand(binaryExpression.m_operator, rightExprResult);
-
-        switch (operatorType)
-        {
-        case Token::Type::Slash:
-        {
-            if (rhs == 0.0)
-            {
-                throw InterpreterError(binaryExpression.m_operator, "Division by zero.");
-            }
-            exprResult->m_result = Value(lhs / rhs); 
-        } break;
-        case Token::Type::Star:         exprResult->m_result = Value(lhs * rhs); break;
-        case Token::Type::Minus:        exprResult->m_result = Value(lhs - rhs); break;
-        case Token::Type::Plus:         exprResult->m_result = Value(lhs + rhs); break;
-        case Token::Type::Less:         exprResult->m_result = Value(lhs < rhs); break;
-        case Token::Type::LessEqual:    exprResult->m_result = Value(lhs <= rhs); break;
-        case Token::Type::Greater:      exprResult->m_result = Value(lhs > rhs); break;
-        case Token::Type::GreaterEqual: exprResult->m_result = Value(lhs >= rhs); break;
-        }
+        ApplyNumberOperator(op, GetNumberOperand(op, lhs), GetNumberOperand(op, rhs), result);
     } break;
-    default: throw InterpreterError(binaryExpression.m_operator, "Unsuported binary operator"); break;
+    default: throw InterpreterError(op, "Unsuported binary operator"); break;
     }    
 }
 
@@ -544,29 +937,57 @@ void Interpreter::VisitGroupingExpression(const GroupingExpression& groupingExpr
 void Interpreter::VisitLiteralExpression(const LiteralExpression& literalExpression, IExpressionVisitorContext* context) const
 {
     ExpressionVisitorContext* result = static_cast<ExpressionVisitorContext*>(context);
+    if (result->m_numberRequested)
+    {
+        if (const double* number = literalExpression.m_value.GetNumber())
+        {
+            result->SetNumber(*number);
+            return;
+        }
+    }
+
     result->m_result = literalExpression.m_value; 
 }
 
 void Interpreter::VisitVariableExpression(const VariableExpression& variableExpression, IExpressionVisitorContext* context) const
 {
     ExpressionVisitorContext* result = static_cast<ExpressionVisitorContext*>(context);
-    EnvironmentPtr environment = result->m_environment;
-    if (m_locals.empty())
-    {
-        result->m_result = environment->GetValue(variableExpression.m_name);
-    }
-    else
+    if (const Value* constant = variableExpression.m_resolved.m_constant)
     {
-        auto it = m_locals.find(&variableExpression);
-        if (it == m_locals.end())
+        const double* number = result->m_numberRequested ? constant->GetNumber() : nullptr;
+        if (number)
         {
-            result->m_result = environment->GetGlobalEnvironment()->GetValue(variableExpression.m_name);
+            result->SetNumber(*number);
         }
         else
         {
-            result->m_result = environment->GetValue(variableExpression.m_name, it->second);
+            result->m_result = *constant;
         }
+        return;
+    }
+
+    if (variableExpression.m_resolved.m_distance == ResolvedName::Inlined)
+    {
+        result->m_result = (*m_inlineFrame)[variableExpression.m_resolved.m_inlineSlot];
+        return;
     }
+
+    EnvironmentPtr environment = result->m_environment;
+    result->m_result = GetValue(variableExpression.m_name, variableExpression.m_resolved, environment);
+}
+
+Value Interpreter::GetValue(const Token& name, const ResolvedName& resolved, EnvironmentPtr environment)
+{
+    if (resolved.m_distance == ResolvedName::Unresolved)
+    {
+        return environment->GetValue(name);
+    }
+    else if (resolved.m_distance == ResolvedName::Global)
+    {
+        return environment->GetGlobalEnvironment()->GetValue(name);
+    }
+
+    return environment->GetValue(name, resolved.m_distance);
 }
 
 void Interpreter::VisitAssignmentExpression(const AssignmentExpression& assignmentExpression, IExpressionVisitorContext* context) const
@@ -574,22 +995,18 @@ void Interpreter::VisitAssignmentExpression(const AssignmentExpression& assignme
     EnvironmentPtr environment = GetEnvironment(*context);
     Value value = Eval(*assignmentExpression.m_expression, GetEnvironment(*context), GetFunctionsRegistry(*context));
 
-    if (m_locals.empty())
+    const uint32_t distance = assignmentExpression.m_resolved.m_distance;
+    if (distance == ResolvedName::Unresolved)
     {
         environment->Assign(assignmentExpression.m_name, value);
     }
+    else if (distance == ResolvedName::Global)
+    {
+        environment->GetGlobalEnvironment()->Assign(assignmentExpression.m_name, value);
+    }
     else
     {
-        auto it = m_locals.find(&assignmentExpression);
-        if (it == m_locals.end())
-        {
-            environment->GetGlobalEnvironment()->Assign(assignmentExpression.m_name, value);
-        }
-        else
-        {
-            environment->Assign(assignmentExpression.m_name, value, it->second);
-        }
-
+        environment->Assign(assignmentExpression.m_name, value, distance);
     }
     
     ExpressionVisitorContext* result = static_cast<ExpressionVisitorContext*>(context);
@@ -621,17 +1038,67 @@ void Interpreter::VisitCallExpression(const CallExpression& callExpression, IExp
 {
     ExpressionVisitorContext* result = static_cast<ExpressionVisitorContext*>(context);
 
-    Value calle = Eval(*callExpression.m_calle, GetEnvironment(*context), GetFunctionsRegistry(*context));
-    
+    Value calle;
+    std::shared_ptr<ClassInstance> receiver;
+    if (const Function* method = FindCalledMethod(callExpression, receiver, calle, GetEnvironment(*context), GetFunctionsRegistry(*context)))
+    {
+        if (static_cast<size_t>(method->Arity()) != callExpression.m_arguments.size())
+        {
+            std::stringstream message;
+            message << "Expected " << method->Arity() << " arguments, but got " << callExpression.m_arguments.size() << '.';
+            throw InterpreterError(callExpression.m_token, message.str());
+        }
+
+        std::vector<Value> arguments;
+        arguments.reserve(callExpression.m_arguments.size());
+
+        for (const IExpressionPtr& expression : callExpression.m_arguments)
+        {
+            arguments.emplace_back(Eval(*expression, GetEnvironment(*context), GetFunctionsRegistry(*context)));
+        }
+
+        result->m_result = method->CallMethod(*this, receiver, GetFunctionsRegistry(*context), arguments);
+        return;
+    }
+
     if (calle.GetCallable())
     {
         const ICallable* callable = *calle.GetCallable();
 
-        if (callable->Arity() != callExpression.m_arguments.size())
+        if (callable != callExpression.m_cachedCallable)
         {
-            std::stringstream message;
-            message << "Expected " << callable->Arity() << " arguments, but got " << callExpression.m_arguments.size() << '.';   
-            throw InterpreterError(callExpression.m_token, message.str());
+            if (static_cast<size_t>(callable->Arity()) != callExpression.m_arguments.size())
+            {
+                std::stringstream message;
+                message << "Expected " << callable->Arity() << " arguments, but got " << callExpression.m_arguments.size() << '.';   
+                throw InterpreterError(callExpression.m_token, message.str());
+            }
+
+            CacheCallee(callExpression, callable, nullptr, nullptr);
+
+            // memoized functions are called to get their results cached
+            if (!callExpression.m_inlined && !callExpression.m_megamorphic && callable != callExpression.m_notInlined && !m_memoization)
+            {
+                callExpression.m_inlined = Inliner::Inline(callExpression, *callable, *GetEnvironment(*context)->GetGlobalEnvironment());
+                callExpression.m_notInlined = callExpression.m_inlined ? nullptr : callable;
+            }
+
+            if (!callExpression.m_inlined && !callExpression.m_megamorphic && callable != callExpression.m_specializedCallee && !m_memoization)
+            {
+                callExpression.m_specializedCallee = callable;
+                callExpression.m_specialization = SpecializeCall(callExpression, *callable, GetEnvironment(*context), GetFunctionsRegistry(*context));
+            }
+        }
+
+        if (callExpression.m_inlined && callExpression.m_inlined->m_callee == callable)
+        {
+            result->m_result = EvalInlined(callExpression, *callExpression.m_inlined, GetEnvironment(*context), GetFunctionsRegistry(*context));
+            return;
+        }
+
+        if (callExpression.m_specialization && callExpression.m_specializedCallee == callable)
+        {
+            callable = callExpression.m_specialization;
         }
 
         std::vector<Value> arguments;
@@ -657,19 +1124,21 @@ void Interpreter::VisitCallExpression(const CallExpression& callExpression, IExp
         const std::shared_ptr<const Class> classDefinition = *calle.GetClass();
         std::shared_ptr<ClassInstance> instance = classDefinition->CreateInstance();
 
-        if (const Function* constructor = instance->m_definition.GetMethod(classDefinition->ToString()))
+        const Function* constructor = callExpression.m_cachedConstructor;
+        if (classDefinition != callExpression.m_cachedClass)
+        {
+            constructor = classDefinition->GetConstructor();
+            CacheCallee(callExpression, nullptr, classDefinition, constructor);
+        }
+
+        if (constructor)
         {
             if (constructor->Arity() != arguments.size())
             {
                 throw InterpreterError(callExpression.m_token, "Class constructor doesn't match the passed arguments count");
             }
             
-            const Function* bound = constructor->Bind(instance, GetFunctionsRegistry(*context));
-            bound->Call(
-                *this,
-                GetEnvironment(*context)->GetGlobalEnvironment(),
-                GetFunctionsRegistry(*context),
-                arguments);
+            constructor->CallMethod(*this, instance, GetFunctionsRegistry(*context), arguments);
         }
 
         result->m_result = Value(instance);
@@ -680,29 +1149,153 @@ void Interpreter::VisitCallExpression(const CallExpression& callExpression, IExp
     }
 }
 
+const Function* Interpreter::SpecializeCall(const CallExpression& callExpression, const ICallable& callable, EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const
+{
+    const Function* function = dynamic_cast<const Function*>(&callable);
+    if (!function)
+    {
+        return nullptr;
+    }
+
+    // literal subexpressions don't read the environment, runtime errors are left for the call
+    EnvironmentPtr globals = environment->GetGlobalEnvironment();
+    Specializer::Folder folder = [&](const IExpression& expression, Value& value)
+    {
+        try
+        {
+            value = Eval(expression, globals, functionsRegistry);
+            return true;
+        }
+        catch (const InterpreterError&)
+        {
+            return false;
+        }
+    };
+
+    return m_specializer->Specialize(callExpression, *function, globals, functionsRegistry, folder);
+}
+
+Value Interpreter::EvalInlined(const CallExpression& callExpression, const InlinedBody& inlined, EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const
+{
+    std::vector<Value> frame;
+    frame.reserve(inlined.m_slotsCount);
+    for (const IExpressionPtr& argument : callExpression.m_arguments)
+    {
+        frame.push_back(Eval(*argument, environment, functionsRegistry));
+    }
+
+    struct FrameScope
+    {
+        ~FrameScope() { m_interpreter.m_inlineFrame = m_outer; }
+
+        const Interpreter& m_interpreter;
+        std::vector<Value>* m_outer;
+    } frameScope{ *this, m_inlineFrame };
+    m_inlineFrame = &frame;
+
+    for (const IExpressionPtr& local : inlined.m_locals)
+    {
+        frame.push_back(Eval(*local, environment, functionsRegistry));
+    }
+
+    return Eval(*inlined.m_result, environment, functionsRegistry);
+}
+
+Value Interpreter::EvalCallee(const CallExpression& callExpression, EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const
+{
+    const VariableExpression* callee = callExpression.m_calleeVariable;
+    if (!callee || !callee->m_resolved.m_final || callee->m_resolved.m_distance != ResolvedName::Global)
+    {
+        return Eval(*callExpression.m_calle, environment, functionsRegistry);
+    }
+
+    // the slot is never erased, so it sees redefinitions made by other programms sharing the environment
+    Environment& globals = *environment->GetGlobalEnvironment();
+    if (callExpression.m_calleeSlotOwner != globals.GetId())
+    {
+        Value* slot = globals.FindLocal(callee->m_name.Symbol());
+        if (!slot)
+        {
+            return Eval(*callExpression.m_calle, environment, functionsRegistry);
+        }
+
+        callExpression.m_calleeSlot = slot;
+        callExpression.m_calleeSlotOwner = globals.GetId();
+    }
+
+    return *callExpression.m_calleeSlot;
+}
+
+void Interpreter::CacheCallee(const CallExpression& callExpression, const ICallable* callable, std::shared_ptr<const Class> classDefinition, const Function* constructor)
+{
+    if (callExpression.m_megamorphic)
+    {
+        return;
+    }
+
+    if (callExpression.m_cachedCallable || callExpression.m_cachedClass)
+    {
+        // a second callee shows up, the call site stops caching for good
+        callExpression.m_megamorphic = true;
+        callExpression.m_cachedCallable = nullptr;
+        callExpression.m_cachedClass = nullptr;
+        callExpression.m_cachedConstructor = nullptr;
+        return;
+    }
+
+    callExpression.m_cachedCallable = callable;
+    callExpression.m_cachedClass = classDefinition;
+    callExpression.m_cachedConstructor = constructor;
+}
+
 void Interpreter::VisitGetExpression(const GetExpression& getExpression, IExpressionVisitorContext* context) const
 {
     ExpressionVisitorContext* result = static_cast<ExpressionVisitorContext*>(context);
+    if (const Value* field = getExpression.m_scalarField ? FindScalarField(*getExpression.m_owner, getExpression.m_scalarField, GetEnvironment(*context)) : nullptr)
+    {
+        result->m_result = *field;
+        return;
+    }
+
     Value owner = Eval(*getExpression.m_owner, GetEnvironment(*context), GetFunctionsRegistry(*context));
+    result->m_result = GetProperty(getExpression, owner, GetEnvironment(*context), GetFunctionsRegistry(*context));
+}
 
+Value Interpreter::GetProperty(const GetExpression& getExpression, const Value& owner, EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const
+{
     if (const std::shared_ptr<ClassInstance>* instance = owner.GetClassInstace())
     {
-        auto memberIt = (*instance)->m_properties.find(getExpression.m_name.m_lexeme);
-        if (memberIt != (*instance)->m_properties.end())
+        const Class& definition = (*instance)->m_definition;
+        if (definition.GetId() == getExpression.m_cachedClassId && !getExpression.m_cachedMethod)
+        {
+            return (*instance)->m_fields[getExpression.m_cachedField];
+        }
+
+        const uint32_t field = definition.IsRecord() ? definition.FindField(getExpression.m_name.Symbol()) : Class::NoField;
+        auto memberIt = (*instance)->m_properties.find(getExpression.m_name.Symbol());
+        if (field != Class::NoField)
+        {
+            getExpression.m_cachedClassId = definition.GetId();
+            getExpression.m_cachedField = field;
+            getExpression.m_cachedMethod = nullptr;
+            return (*instance)->m_fields[field];
+        }
+        else if (memberIt != (*instance)->m_properties.end())
+        {
+            return memberIt->second;
+        }
+        else if (const Function *method = definition.GetMethod(getExpression.m_name.Symbol()))
         {
-            result->m_result = memberIt->second;
+            return Value(method->Bind(*instance, functionsRegistry));
         }
-        else if (const Function *method = (*instance)->m_definition.GetMethod(getExpression.m_name.m_lexeme))
+        else if (const Function *getter = definition.GetGetter(getExpression.m_name.Symbol()))
         {
-            result->m_result = Value(method->Bind(*instance, GetFunctionsRegistry(*context)));
+            return getter->CallMethod(*this, *instance, functionsRegistry, std::vector<Value>());
         }
-        else if (const Function *getter = (*instance)->m_definition.GetGetter(getExpression.m_name.m_lexeme))
+        else if (definition.IsRecord())
         {
-            const Function* boundGetter = getter->Bind(*instance, GetFunctionsRegistry(*context));
-            result->m_result = boundGetter->Call(*this,
-                                                GetEnvironment(*context)->GetGlobalEnvironment(),
-                                                GetFunctionsRegistry(*context),
-                                                std::vector<Value>());
+            std::string errorMessage = "Undefined property '" + std::string(getExpression.m_name.m_lexeme) + "' of record class '" + std::string(definition.ToString()) + "'.";
+            throw InterpreterError(getExpression.m_name, errorMessage);
         }
         else
         {
@@ -712,9 +1305,9 @@ void Interpreter::VisitGetExpression(const GetExpression& getExpression, IExpres
     }
     else if (const std::shared_ptr<const Class>* classDefinition = owner.GetClass())
     {
-        if (const Function *method = (*classDefinition)->GetStaticMethod(getExpression.m_name.m_lexeme))
+        if (const Function *method = (*classDefinition)->GetStaticMethod(getExpression.m_name.Symbol()))
         {
-            result->m_result = Value(method);
+            return Value(method);
         }
         else
         {
@@ -728,15 +1321,162 @@ void Interpreter::VisitGetExpression(const GetExpression& getExpression, IExpres
     }
 }
 
+const Function* Interpreter::FindMethod(const GetExpression& getExpression, const ClassInstance& instance)
+{
+    const uint32_t name = getExpression.m_name.Symbol();
+    if (!instance.m_properties.empty() && instance.m_properties.count(name))
+    {
+        return nullptr;
+    }
+
+    const Class& definition = instance.m_definition;
+    if (definition.GetId() != getExpression.m_cachedClassId)
+    {
+        const Function* method = definition.IsRecord() && definition.FindField(name) != Class::NoField ? nullptr : definition.GetMethod(name);
+        if (!method)
+        {
+            return nullptr; // fields are cached by GetProperty
+        }
+
+        getExpression.m_cachedClassId = definition.GetId();
+        getExpression.m_cachedMethod = method;
+    }
+
+    return getExpression.m_cachedMethod;
+}
+
+const Function* Interpreter::FindCalledMethod(const CallExpression& callExpression, std::shared_ptr<ClassInstance>& receiver, Value& callee, EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const
+{
+    if (const SuperExpression* superExpression = callExpression.m_calleeSuper)
+    {
+        return FindSuperMethod(*superExpression, receiver, environment);
+    }
+
+    const GetExpression* property = callExpression.m_calleeProperty;
+    if (!property || property->m_scalarField)
+    {
+        callee = EvalCallee(callExpression, environment, functionsRegistry);
+        return nullptr;
+    }
+
+    const ResolvedName& resolvedThis = property->m_finalMethod ? static_cast<const ThisExpression&>(*property->m_owner).m_resolved : ResolvedName();
+    if (property->m_finalMethod && resolvedThis.m_distance < ResolvedName::Inlined)
+    {
+        // 'this' is bound right inside the closure of the methods of its class
+        EnvironmentPtr thisEnvironment = GetAncestorEnvironment(resolvedThis.m_distance, environment);
+        const std::shared_ptr<ClassInstance>& instance = *thisEnvironment->FindLocal(SymbolTable::This)->GetClassInstace();
+        if (!instance->m_properties.empty() && instance->m_properties.count(property->m_name.Symbol()))
+        {
+            callee = GetProperty(*property, Value(instance), environment, functionsRegistry);
+            return nullptr;
+        }
+
+        const uint64_t closureId = thisEnvironment->GetOuter()->GetId();
+        if (property->m_cachedClosureId != closureId)
+        {
+            property->m_cachedClosureId = closureId;
+            property->m_cachedMethod = instance->m_definition.GetMethod(property->m_name.Symbol());
+            assert(property->m_cachedMethod);
+        }
+
+        receiver = instance;
+        return property->m_cachedMethod;
+    }
+
+    Value owner = Eval(*property->m_owner, environment, functionsRegistry);
+    if (const std::shared_ptr<ClassInstance>* instance = owner.GetClassInstace())
+    {
+        if (const Function* method = FindMethod(*property, **instance))
+        {
+            receiver = *instance;
+            return method;
+        }
+    }
+
+    callee = GetProperty(*property, owner, environment, functionsRegistry);
+    return nullptr;
+}
+
+const Function* Interpreter::FindSuperMethod(const SuperExpression& superExpression, std::shared_ptr<ClassInstance>& receiver, EnvironmentPtr environment)
+{
+    // 'this' is bound right inside the environment holding 'super'
+    const Value* superClassValue = nullptr;
+    const Value* instanceValue = nullptr;
+    const uint32_t distance = superExpression.m_resolved.m_distance;
+    if (distance == ResolvedName::Unresolved || distance == ResolvedName::Global || distance == 0)
+    {
+        // unresolved programms look 'super' up through all enclosing environments
+        for (EnvironmentPtr thisEnvironment = environment; thisEnvironment->GetOuter() && !superClassValue; thisEnvironment = thisEnvironment->GetOuter())
+        {
+            superClassValue = thisEnvironment->GetOuter()->FindLocal(SymbolTable::Super);
+            instanceValue = thisEnvironment->FindLocal(SymbolTable::This);
+        }
+    }
+    else
+    {
+        EnvironmentPtr thisEnvironment = GetAncestorEnvironment(distance - 1, environment);
+        superClassValue = thisEnvironment->GetOuter()->FindLocal(SymbolTable::Super);
+        instanceValue = thisEnvironment->FindLocal(SymbolTable::This);
+    }
+
+    if (!superClassValue || !superClassValue->GetClass() || !instanceValue || !instanceValue->GetClassInstace())
+    {
+        throw InterpreterError(superExpression.m_keyword, "Can't use 'super' outside of a method of a subclass.");
+    }
+
+    const Class& superClass = **superClassValue->GetClass();
+    if (superClass.GetId() != superExpression.m_cachedClassId)
+    {
+        const Function* method = superClass.GetMethod(superExpression.m_method.Symbol());
+        if (!method)
+        {
+            std::string errorMessage = "Undefined property '" + std::string(superExpression.m_method.m_lexeme) + "'.";
+            throw InterpreterError(superExpression.m_method, errorMessage);
+        }
+
+        superExpression.m_cachedClassId = superClass.GetId();
+        superExpression.m_cachedMethod = method;
+    }
+
+    receiver = *instanceValue->GetClassInstace();
+    return superExpression.m_cachedMethod;
+}
+
 void Interpreter::VisitSetExpression(const SetExpression& setExpression, IExpressionVisitorContext* context) const
 {
     ExpressionVisitorContext* result = static_cast<ExpressionVisitorContext*>(context);
+    if (Value* field = setExpression.m_scalarField ? FindScalarField(setExpression.m_owner, setExpression.m_scalarField, GetEnvironment(*context)) : nullptr)
+    {
+        *field = Eval(*setExpression.m_value, GetEnvironment(*context), GetFunctionsRegistry(*context));
+        return;
+    }
+
     Value owner = Eval(setExpression.m_owner, GetEnvironment(*context), GetFunctionsRegistry(*context));
 
     if (const std::shared_ptr<ClassInstance>* instance = owner.GetClassInstace())
     {
+        const Class& definition = (*instance)->m_definition;
+        if (definition.IsRecord())
+        {
+            uint32_t field = setExpression.m_cachedField;
+            if (definition.GetId() != setExpression.m_cachedClassId)
+            {
+                field = definition.FindField(setExpression.m_name.Symbol());
+                if (field == Class::NoField)
+                {
+                    std::string errorMessage = "Undefined field '" + std::string(setExpression.m_name.m_lexeme) + "' of record class '" + std::string(definition.ToString()) + "'.";
+                    throw InterpreterError(setExpression.m_name, errorMessage);
+                }
+                setExpression.m_cachedClassId = definition.GetId();
+                setExpression.m_cachedField = field;
+            }
+
+            (*instance)->m_fields[field] = Eval(*setExpression.m_value, GetEnvironment(*context), GetFunctionsRegistry(*context));
+            return;
+        }
+
         Value value = Eval(*setExpression.m_value, GetEnvironment(*context), GetFunctionsRegistry(*context));
-        (*instance)->m_properties[setExpression.m_name.m_lexeme] = value;
+        (*instance)->m_properties[setExpression.m_name.Symbol()] = value;
     }
     else
     {
@@ -759,53 +1499,17 @@ void Interpreter::VisitThisExpression(const ThisExpression& thisExpression, IExp
 {
     ExpressionVisitorContext* result = static_cast<ExpressionVisitorContext*>(context);
     EnvironmentPtr environment = result->m_environment;
-    if (m_locals.empty())
-    {
-        result->m_result = environment->GetValue(thisExpression.m_keyword);
-    }
-    else
-    {
-        auto it = m_locals.find(&thisExpression);
-        if (it == m_locals.end())
-        {
-            result->m_result = environment->GetGlobalEnvironment()->GetValue(thisExpression.m_keyword);
-        }
-        else
-        {
-            result->m_result = environment->GetValue(thisExpression.m_keyword, it->second);
-        }
-    }
+    result->m_result = GetValue(thisExpression.m_keyword, thisExpression.m_resolved, environment);
 }
 
 void Interpreter::VisitSuperExpression(const SuperExpression& superExpression, IExpressionVisitorContext* context) const
 {
     ExpressionVisitorContext* result = static_cast<ExpressionVisitorContext*>(context);
-    EnvironmentPtr environment = result->m_environment;
-
-    auto it = m_locals.find(&superExpression);
-    assert(it != m_locals.end());
-
-    Value superClassValue = environment->GetValue(superExpression.m_keyword, it->second);
-    assert(superClassValue.GetClass());
-    std::shared_ptr<const Class> superClass = *superClassValue.GetClass();
-
-    Token thisToken = superExpression.m_keyword;
-    thisToken.m_type = Token::Type::This;
-    thisToken.m_lexeme = TokenTypeToStringView(Token::Type::This);
-
-    Value instanceValue = environment->GetValue(thisToken, it->second-1);
-    assert(instanceValue.GetClassInstace());
-    std::shared_ptr<ClassInstance> classInstance = *instanceValue.GetClassInstace();
 
-    if (const Function* method = superClass->GetMethod(superExpression.m_method.m_lexeme))
-    {
-        result->m_result = Value(method->Bind(classInstance, GetFunctionsRegistry(*context)));
-    }
-    else
-    {
-        std::string errorMessage = "Undefined property '" + std::string(superExpression.m_method.m_lexeme) + "'.";
-        throw InterpreterError(superExpression.m_method, errorMessage);
-    }
+    // a method of the superclass read without calling it is bound to the instance
+    std::shared_ptr<ClassInstance> instance;
+    const Function* method = FindSuperMethod(superExpression, instance, result->m_environment);
+    result->m_result = Value(method->Bind(instance, GetFunctionsRegistry(*context)));
 }
 
 void Interpreter::Execute(const IStatement& statement, EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const
@@ -821,7 +1525,21 @@ Value Interpreter::Eval(const IExpression& expression, EnvironmentPtr environmen
     return context.m_result;
 }
 
+double Interpreter::EvalNumber(const IExpression& expression, EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const
+{
+    ExpressionVisitorContext context(environment, functionsRegistry);
+    context.m_numberRequested = true;
+    expression.Accept(*this, &context);
+    if (context.m_hasNumber)
+    {
+        return context.m_number;
+    }
+
+    assert(context.m_result.GetNumber());
+    return *context.m_result.GetNumber();
+}
+
 void Interpreter::RegisterNativeFunctions(EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const
 {
-    environment->Define("clock", Value(functionsRegistry.Register<ClockCallable>()));
+    environment->Define(SymbolTable::Intern("clock"), Value(functionsRegistry.Register<ClockCallable>()));
 }
\ No newline at end of file
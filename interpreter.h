@@ -3,15 +3,27 @@
 #include "expressionvisitor.h"
 #include "statementvisitor.h"
 #include "value.h"
+#include "trace.h"
 #include <any>
 #include <iostream>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <memory>
 #include <type_traits>
 
 struct Token;
 struct IExpression;
+struct ResolvedName;
+enum class TypeFeedback;
+class ICallable;
+class Class;
+class Function;
+class Memoization;
+class Specializer;
+class CompilationQueue;
+struct Tiering;
+struct InlinedBody;
 struct IStatement;
 using IStatementPtr = std::unique_ptr<const IStatement>;
 
@@ -26,7 +38,9 @@ struct Environment : std::enable_shared_from_this<Environment>
 
     ~Environment();
 
-    void Define(std::string_view name, const Value& value);
+    void Define(uint32_t symbol, const Value& value);
+    // storage of a variable defined in this environment, stays valid for the environment lifetime
+    Value* FindLocal(uint32_t symbol);
     void Assign(const Token& token, const Value& value);
     void Assign(const Token& token, const Value& value, size_t distance);
     Value GetValue(const Token& token) const;
@@ -42,6 +56,8 @@ struct Environment : std::enable_shared_from_this<Environment>
     const Value& GetReturnValue() const;
 
     EnvironmentPtr GetGlobalEnvironment();
+    // unique among all environments created by the process, identifies the global environment in call site caches
+    uint64_t GetId() const { return m_id; }
 
     EnvironmentPtr GetOuter() { return m_outer; }
     ConstEnvironmentPtr GetOuter() const { return m_outer; }
@@ -56,9 +72,11 @@ protected:
     Environment &operator=(const Environment&) = delete;
 
 protected:
-    std::map<std::string, Value> m_values;
+    std::unordered_map<uint32_t, Value> m_values; // keyed by SymbolTable ids
     Value m_returnValue;
     EnvironmentPtr m_outer = nullptr;
+    Environment* m_global; // the outermost environment, kept alive by the chain of m_outer
+    uint64_t m_id;
     bool m_break = false;
     bool m_return = false;
     std::ostream& m_outputStream;
@@ -93,9 +111,26 @@ struct Interpreter : IExpressionVisitor, IStatementVisitor
         const Token& m_operator;
     };
 
-    Interpreter(EnvironmentPtr environment, FunctionsRegistry& functionsRegistry, std::map<const IExpression*, size_t>&& locals = std::map<const IExpression*, size_t>());
+    Interpreter(EnvironmentPtr environment, FunctionsRegistry& functionsRegistry);
+    ~Interpreter();
+
+    // results of pure top-level functions are cached from now on
+    void EnableMemoization(size_t maxEntriesPerFunction);
+    Memoization* GetMemoization() const { return m_memoization.get(); }
+
     void Interpret(EnvironmentPtr environment, FunctionsRegistry& functionsRegistry, const std::vector<IStatementPtr>& program, std::ostream& errorsLog) const;
     void Execute(const IStatement& statement, EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const;
+
+    // a body called that many times is folded on the worker thread, calls execute the given body until the folded one is installed
+    static constexpr uint32_t HotCallsCount = 1000;
+    const std::vector<IStatementPtr>& GetTieredBody(Tiering& tiering, const std::vector<IStatementPtr>& body) const;
+    // waits for the bodies being compiled, used by tests
+    void WaitForCompilations() const;
+
+    // operators on values of unknown types, also used by the compiled programms, see Runtime
+    static Value ApplyUnaryOperator(const Token& op, const Value& operand);
+    static Value ApplyBinaryOperator(const Token& op, const Value& lhs, const Value& rhs, FunctionsRegistry& functionsRegistry);
+    static double GetNumberOperand(const Token& token, const Value& lhs);
 protected:
     struct StatementVisitorContext : IStatementVisitorContext
     {
@@ -115,9 +150,26 @@ protected:
             , m_functionsRegistry(functionsRegistry)
         {}
 
+        // numeric results are kept unboxed when the caller asked for a number
+        void SetNumber(double number)
+        {
+            if (m_numberRequested)
+            {
+                m_number = number;
+                m_hasNumber = true;
+            }
+            else
+            {
+                m_result = Value(number);
+            }
+        }
+
         EnvironmentPtr m_environment;
         Value m_result;
         FunctionsRegistry& m_functionsRegistry;
+        double m_number = 0.0;
+        bool m_numberRequested = false;
+        bool m_hasNumber = false;
     };
     
     virtual void VisitExpressionStatement(const ExpressionStatement& statement, IStatementVisitorContext* context) const override;
@@ -128,6 +180,7 @@ protected:
     virtual void VisitBlockStatement(const BlockStatement& statement, IStatementVisitorContext* context) const override;
     virtual void VisitIfStatement(const IfStatement& statement, IStatementVisitorContext* context) const override;
     virtual void VisitWhileStatement(const WhileStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitForStatement(const ForStatement& statement, IStatementVisitorContext* context) const override;
     virtual void VisitBreakStatement(const BreakStatement& statement, IStatementVisitorContext* context) const override;
     virtual void VisitReturnStatement(const ReturnStatement& statement, IStatementVisitorContext* context) const override;
 
@@ -147,17 +200,46 @@ protected:
     virtual void VisitSuperExpression(const SuperExpression& superExpression, IExpressionVisitorContext* context) const override;
 
     Value Eval(const IExpression& expression, EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const;
+    // evaluates an expression proven to be a number by TypeInferrer
+    double EvalNumber(const IExpression& expression, EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const;
 
     void RegisterNativeFunctions(EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const;
 
     static bool AreEqual(const Token& token, const Value& lhs, const Value& rhs);
-    static double GetNumberOperand(const Token& token, const Value& lhs);
+    static TypeFeedback ObserveOperands(const Token& op, const Value& lhs, const Value& rhs);
+    static void ApplyNumberOperator(const Token& op, double lhs, double rhs, ExpressionVisitorContext& result);
+    static void ApplyStringOperator(const Token& op, const std::string& lhs, const std::string& rhs, ExpressionVisitorContext& result);
+    static void ApplyGenericOperator(const Token& op, const Value& lhs, const Value& rhs, ExpressionVisitorContext& result);
+    static Value GetValue(const Token& name, const ResolvedName& resolved, EnvironmentPtr environment);
+
+    // executes the statements from the first one on, inner is the environment of the block or the outer one
+    void ExecuteBlock(const std::vector<IStatementPtr>& statements, size_t first, EnvironmentPtr inner, EnvironmentPtr outer, FunctionsRegistry& functionsRegistry) const;
+    // completes an iteration of the loop after a side exit of its trace
+    void ResumeIteration(const WhileStatement& statement, const Trace::Exit& exit, EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const;
+    Value EvalInlined(const CallExpression& callExpression, const InlinedBody& inlined, EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const;
+    // methods are called without binding them, the instance is returned as the receiver. otherwise evaluates the callee
+    const Function* FindCalledMethod(const CallExpression& callExpression, std::shared_ptr<ClassInstance>& receiver, Value& callee, EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const;
+    // method of the instance cached by the get expression, null when the name isn't a method
+    static const Function* FindMethod(const GetExpression& getExpression, const ClassInstance& instance);
+    static const Function* FindSuperMethod(const SuperExpression& superExpression, std::shared_ptr<ClassInstance>& receiver, EnvironmentPtr environment);
+    Value GetProperty(const GetExpression& getExpression, const Value& owner, EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const;
+    // final global callees are read directly from their storage
+    Value EvalCallee(const CallExpression& callExpression, EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const;
+    // clone of the callee folded for the literal arguments of the call site
+    const Function* SpecializeCall(const CallExpression& callExpression, const ICallable& callable, EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const;
+    // defines the fields of an instance proven local by EscapeAnalyzer, false when its class can't be replaced
+    bool DefineScalarReplaced(const VariableDeclarationStatement& statement, EnvironmentPtr environment, FunctionsRegistry& functionsRegistry) const;
+    // storage of a field of a scalar replaced owner, null when the owner holds an instance
+    static Value* FindScalarField(const IExpression& owner, uint32_t field, EnvironmentPtr environment);
+    static void CacheCallee(const CallExpression& callExpression, const ICallable* callable, std::shared_ptr<const Class> classDefinition, const Function* constructor);
 
     static EnvironmentPtr GetEnvironment(IExpressionVisitorContext& context);
     static EnvironmentPtr GetEnvironment(IStatementVisitorContext& context);
     static FunctionsRegistry& GetFunctionsRegistry(IExpressionVisitorContext& context);
     static FunctionsRegistry& GetFunctionsRegistry(IStatementVisitorContext& context);
 
-
-    std::map<const IExpression*, size_t> m_locals;    
+    std::unique_ptr<Memoization> m_memoization;
+    std::unique_ptr<Specializer> m_specializer;
+    mutable std::unique_ptr<CompilationQueue> m_compilationQueue; // destroyed first, its jobs read the bodies of the specializations
+    mutable std::vector<Value>* m_inlineFrame = nullptr; // slots of the inlined body being evaluated
 };
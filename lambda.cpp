@@ -18,10 +18,10 @@ Value Lambda::Call(const Interpreter& interpreter, EnvironmentPtr globals, Funct
     for (size_t i = 0; i < arguments.size(); ++i)
     {
         const Token& token = m_lambdaExpression.m_parameters[i];
-        localEnvironment->Define(token.m_lexeme, arguments[i]);
+        localEnvironment->Define(token.Symbol(), arguments[i]);
     }
 
-    for (const IStatementPtr& statement : m_lambdaExpression.m_body)
+    for (const IStatementPtr& statement : interpreter.GetTieredBody(m_lambdaExpression.m_tiering, m_lambdaExpression.m_body))
     {
         interpreter.Execute(*statement, localEnvironment, functionsRegistry);
         if (localEnvironment->ReturnRequested())
@@ -9,6 +9,9 @@ class Lambda : public ICallable
 public:
     Lambda(const LambdaExpression& lambdaExpression, EnvironmentPtr closure);
 
+    const LambdaExpression& GetExpression() const { return m_lambdaExpression; }
+    const EnvironmentPtr& GetClosure() const { return m_closure; }
+
 protected:
     virtual Value Call(const Interpreter& interpreter, EnvironmentPtr globals, FunctionsRegistry& functionsRegistry, const std::vector<Value>& arguments) const override;
     virtual int Arity() const override;
@@ -1,75 +1,157 @@
 #include <iostream>
-#include <fstream>
 #include <string>
 #include <sstream>
 #include <optional>
 #include <assert.h>
+#include <algorithm>
 #include <filesystem>
+#include <fstream>
+#include <cstdlib>
+#include "gekko.h"
+#include "sourcefile.h"
 #include "scanner.h"
 #include "parser.h"
 #include "resolver.h"
+#include "typeinferrer.h"
+#include "escapeanalyzer.h"
+#include "frontend.h"
+#include "replsession.h"
+#include "memoization.h"
+#include "profile.h"
+#include "transpiler.h"
+#include "runtime.h"
 #include "astprinter.h"
 #include "statements.h"
 #include "expressions.h"
 #include "mocks/mockedinterpreter.h"
 #include "mocks/mockedparser.h"
 
-void run(EnvironmentPtr environment, FunctionsRegistry& functionsRegistry, std::string_view source)
+// files are processed by the front end in parallel and then executed one after another in a shared environment.
+// a profile of a previous run of the same files seeds the feedback, the profile of this run replaces it on exit.
+// deferred function bodies are parsed and checked on their first call, so errors in them are reported late
+void runFiles(const std::vector<const char*>& filenames, bool memoize, bool deferFunctionBodies, const char* profileFilename)
 {
-    Scanner scanner(source);
-    Parser parser(scanner.Tokens());
-    std::vector<IStatementPtr> program = parser.Parse(std::cout);
-    Resolver resolver;
-    Resolver::Result resolution = resolver.Resolve(program);
-    if (!resolution.m_hasErrors)
+    // declared first so they outlive everything that refers to the sources
+    std::vector<std::unique_ptr<SourceFile>> scripts;
+    std::vector<std::string_view> sources;
+    for (const char* filename : filenames)
     {
-        Interpreter interpreter(environment, functionsRegistry, std::move(resolution.m_locals));
-        interpreter.Interpret(environment, functionsRegistry, program, std::cerr);
+        std::cout << "running file: " << filename << std::endl;
+
+        std::unique_ptr<SourceFile> script = SourceFile::Open(filename);
+        if (script)
+        {
+            sources.push_back(script->Content());
+            scripts.push_back(std::move(script));
+        }
+        else
+        {
+            std::cout << "can't open file: " << filename << std::endl;
+        }
     }
-}
 
-std::optional<std::string> GetFileContent(const char* filename)
-{
-    std::ifstream script(filename);
-    if (script.is_open())
+    std::vector<Frontend::Unit> units = Frontend(deferFunctionBodies).Process(sources, std::cout);
+
+    EnvironmentPtr environment = Environment::CreateGlobalEnvironment();
+    FunctionsRegistry functionsRegistry; 
+    Interpreter interpreter(environment, functionsRegistry);
+    if (memoize)
     {
-        std::stringstream buffer;
-        buffer << script.rdbuf();
-        script.close();
+        interpreter.EnableMemoization(Memoization::DefaultMaxEntriesPerFunction);
+    }
 
-        return buffer.str();
+    Profile profile(sources);
+    const bool warm = profileFilename && profile.Load(profileFilename);
+
+    for (const Frontend::Unit& unit : units)
+    {
+        if (!unit.m_resolution.m_hasErrors)
+        {
+            TypeInferrer().Infer(unit.m_program);
+            EscapeAnalyzer().Analyze(unit.m_program);
+            if (warm)
+            {
+                profile.Apply(unit.m_program);
+            }
+            interpreter.Interpret(environment, functionsRegistry, unit.m_program, std::cerr);
+        }
     }
-    else
+
+    if (profileFilename)
     {
-        std::cout << "can't open file: " << filename << std::endl;
-        return std::nullopt;
+        Profile recorded(sources);
+        for (const Frontend::Unit& unit : units)
+        {
+            if (!unit.m_resolution.m_hasErrors)
+            {
+                recorded.Record(unit.m_program);
+            }
+        }
+
+        if (!recorded.Save(profileFilename))
+        {
+            std::cout << "can't write profile: " << profileFilename << std::endl;
+        }
+    }
+
+    if (memoize)
+    {
+        const Memoization::Statistics& statistics = interpreter.GetMemoization()->GetStatistics();
+        std::cout << "memoization: " << statistics.m_hits << " hits, " << statistics.m_misses << " misses, " << statistics.m_evictions << " evictions" << std::endl;
     }
 }
 
-void runFile(const char* filename)
+// set by the build to where the compiled programms find the runtime headers and library
+#ifndef GEKKO_INCLUDE_DIR
+#define GEKKO_INCLUDE_DIR "."
+#endif
+#ifndef GEKKO_RUNTIME_LIBRARY
+#define GEKKO_RUNTIME_LIBRARY "libgekkoruntime.a"
+#endif
+
+// translates the script to C++ next to the executable and builds it with $CXX or c++
+int compileFile(const char* filename, const std::string& executable)
 {
-    std::cout << "running file: " << filename << std::endl;
+    std::unique_ptr<SourceFile> script = SourceFile::Open(filename);
+    if (!script)
+    {
+        std::cout << "can't open file: " << filename << std::endl;
+        return 1;
+    }
 
-    std::optional<std::string> script = GetFileContent(filename);
-    if (script.has_value())
+    // errors the interpreter runs despite, like unused variables, refuse the build too
+    std::vector<Frontend::Unit> units = Frontend().Process({ script->Content() }, std::cout);
+    if (units.front().m_errorsReported || units.front().m_resolution.m_hasErrors)
     {
-        EnvironmentPtr environment = Environment::CreateGlobalEnvironment();
-        FunctionsRegistry functionsRegistry; 
-        run(environment, functionsRegistry, script.value());
+        return 1;
     }
+
+    Transpiler::Result result = Transpiler().Transpile(units.front().m_program, script->Content());
+    if (!result.m_translated)
+    {
+        std::cout << "classes, properties, lambdas and nested functions aren't translated, statements using them are run by the interpreter" << std::endl;
+    }
+
+    const std::string cppFilename = executable + ".cpp";
+    std::ofstream(cppFilename) << result.m_code;
+
+    const char* compiler = std::getenv("CXX");
+    const std::string command = std::string(compiler ? compiler : "c++") + " -std=c++20 -O2 -I\"" GEKKO_INCLUDE_DIR "\" \"" + cppFilename
+        + "\" \"" GEKKO_RUNTIME_LIBRARY "\" -lpthread -o \"" + executable + "\"";
+    std::cout << command << std::endl;
+    return std::system(command.c_str()) == 0 ? 0 : 1;
 }
 
 void runPrompt()
 {
-    EnvironmentPtr environment = Environment::CreateGlobalEnvironment();
-    FunctionsRegistry functionsRegistry; 
+    ReplSession session;
 
     std::string line; 
 
     std::cout << "> ";
     while (std::getline(std::cin, line))
     {
-        run(environment, functionsRegistry, line);
+        session.Execute(std::move(line));
         std::cout << "> ";
     }
 }
@@ -92,18 +174,29 @@ void runTests()
         assert(scanner.Tokens()[1].m_lexeme == "test");
         assert(scanner.Tokens()[2].m_type == Token::Type::Equal);
         assert(scanner.Tokens()[3].m_type == Token::Type::Number);
-        const double* val = scanner.Tokens()[3].m_literalvalue.GetNumber();
+        Value literal = scanner.Tokens()[3].LiteralValue();
+        const double* val = literal.GetNumber();
         assert(val && *val == 42.7);
         assert(scanner.Tokens()[4].m_type == Token::Type::EndOfFile);
     }
 
+    // symbols
+    {
+        Scanner scanner("this.test = super.test + other;");
+        const std::vector<Token>& tokens = scanner.Tokens();
+        assert(tokens[0].Symbol() == SymbolTable::This && tokens[4].Symbol() == SymbolTable::Super);
+        assert(tokens[2].Symbol() == tokens[6].Symbol() && SymbolTable::Name(tokens[2].Symbol()) == "test");
+        assert(tokens[8].Symbol() == SymbolTable::Intern("other") && tokens[8].Symbol() != tokens[2].Symbol());
+        assert(tokens[1].Symbol() == SymbolTable::None);
+    }
+
     // multiline script
     {
-        std::optional<std::string> script = GetFileContent("../../scripts/unit_test_1.gk");
+        std::unique_ptr<SourceFile> script = SourceFile::Open("../../scripts/unit_test_1.gk");
 
-        assert(script.has_value());
+        assert(script);
 
-        Scanner scanner(script.value());
+        Scanner scanner(script->Content());
 
         assert(scanner.Tokens().size() == 5);
         assert(scanner.Tokens()[0].m_type == Token::Type::Var);
@@ -111,7 +204,8 @@ void runTests()
         assert(scanner.Tokens()[1].m_lexeme == "someString");
         assert(scanner.Tokens()[2].m_type == Token::Type::Equal);
         assert(scanner.Tokens()[3].m_type == Token::Type::String);
-        const std::string* val = scanner.Tokens()[3].m_literalvalue.GetString();
+        Value literal = scanner.Tokens()[3].LiteralValue();
+        const std::string* val = literal.GetString();
         assert(val && *val == "TestString");
         assert(scanner.Tokens()[4].m_type == Token::Type::EndOfFile);
     }
@@ -228,6 +322,7 @@ void runTests()
             Scanner scanner(
                 "print \"hi\" or 2;"
                 "print nil or \"yes\";" 
+                "print nil or false or \"chain\";"
             );
             MockedParser parser(scanner.Tokens());
             std::stringstream outputStream;
@@ -240,7 +335,7 @@ void runTests()
             {
                 interpreter.Execute(*statement, environment, functionsRegistry);
             }
-            assert(outputStream.str() == "hi\nyes\n");
+            assert(outputStream.str() == "hi\nyes\nchain\n");
         }
 
         {   // while test
@@ -326,6 +421,613 @@ void runTests()
             }
             assert(outputStream.str() == "abc\n");
         }
+
+        { // type inference test
+            Scanner scanner(
+                "{"
+                    "var sum = 0;"
+                    "var text = \"a\";"
+                    "for (var i = 0; i < 4; i = i + 1)"
+                    "{"
+                        "sum = sum + i;"
+                    "}"
+                    "print sum * 2;"
+                    "print text + text;"
+                "}"
+            );
+            Parser parser(scanner.Tokens());
+            std::vector<IStatementPtr> programm = parser.Parse(std::cerr);
+            Resolver::Result resolution = Resolver().Resolve(programm);
+            assert(!resolution.m_hasErrors);
+            TypeInferrer().Infer(programm);
+
+            const BlockStatement* block = dynamic_cast<const BlockStatement*>(programm[0].get());
+            const PrintStatement* printNumber = dynamic_cast<const PrintStatement*>(block->m_block[3].get());
+            const PrintStatement* printString = dynamic_cast<const PrintStatement*>(block->m_block[4].get());
+            assert(dynamic_cast<const BinaryExpression*>(printNumber->m_expression.get())->m_operandsType == ExpressionType::Number);
+            assert(dynamic_cast<const BinaryExpression*>(printString->m_expression.get())->m_operandsType == ExpressionType::String);
+
+            std::stringstream outputStream;
+            EnvironmentPtr environment = Environment::CreateGlobalEnvironment(outputStream);
+            FunctionsRegistry functionsRegistry;
+            Interpreter interpreter(environment, functionsRegistry);
+            interpreter.Interpret(environment, functionsRegistry, programm, std::cerr);
+            assert(outputStream.str() == "12.000000\naa\n");
+        }
+
+        { // runtime type feedback test
+            Scanner scanner(
+                "fun Add(a, b)"
+                "{"
+                    "return a + b;"
+                "}"
+                "print Add(1, 2);"
+                "print Add(3, 4);"
+                "print Add(\"a\", \"b\");"
+            );
+            Parser parser(scanner.Tokens());
+            std::stringstream outputStream;
+            EnvironmentPtr environment = Environment::CreateGlobalEnvironment(outputStream);
+            FunctionsRegistry functionsRegistry;
+            MockedInterpreter interpreter(environment, functionsRegistry);
+
+            std::vector<IStatementPtr> programm = parser.Parse(std::cerr);
+            for (const IStatementPtr& statement : programm)
+            {
+                interpreter.Execute(*statement, environment, functionsRegistry);
+            }
+            assert(outputStream.str() == "3.000000\n7.000000\nab\n");
+
+            const FunctionDeclarationStatement* add = dynamic_cast<const FunctionDeclarationStatement*>(programm[0].get());
+            const ReturnStatement* addReturn = dynamic_cast<const ReturnStatement*>(add->m_body[0].get());
+            assert(dynamic_cast<const BinaryExpression*>(addReturn->m_returnValue.get())->m_feedback == TypeFeedback::Generic);
+        }
+        { // for statement test
+            Scanner scanner(
+                "for (var i = 0; i < 3; i = i + 1) { if (i == 2) break; print i; }"
+                "for (var i = 3..5) print i;"
+                "for (var i = 0; i < 4; i = i + 1) { i = i + 1; print i; }"
+                "for (var s = \"a\"; s != \"aaa\"; s = s + \"a\") print s;"
+            );
+            Parser parser(scanner.Tokens());
+            std::stringstream outputStream;
+            EnvironmentPtr environment = Environment::CreateGlobalEnvironment(outputStream);
+            FunctionsRegistry functionsRegistry;
+            MockedInterpreter interpreter(environment, functionsRegistry);
+
+            std::vector<IStatementPtr> programm = parser.Parse(std::cerr);
+            for (const IStatementPtr& statement : programm)
+            {
+                interpreter.Execute(*statement, environment, functionsRegistry);
+            }
+            assert(outputStream.str() == "0.000000\n1.000000\n3.000000\n4.000000\n1.000000\n3.000000\na\naa\n");
+
+            assert(dynamic_cast<const ForStatement*>(programm[0].get())->m_counter != nullptr);
+            assert(dynamic_cast<const ForStatement*>(programm[1].get())->m_rangeEnd != nullptr);
+            assert(dynamic_cast<const ForStatement*>(programm[3].get())->m_counter == nullptr);
+        }
+        { // scope elision test
+            Scanner scanner(
+                "var a = 1;"
+                "{"
+                    "var a = 2;"
+                    "{ a = a + 1; print a; }"
+                "}"
+                "{ print a; }"
+            );
+            Parser parser(scanner.Tokens());
+            std::vector<IStatementPtr> programm = parser.Parse(std::cerr);
+            Resolver::Result resolution = Resolver().Resolve(programm);
+            assert(!resolution.m_hasErrors);
+
+            const BlockStatement* outer = dynamic_cast<const BlockStatement*>(programm[1].get());
+            assert(outer->m_hasScope);
+            assert(!dynamic_cast<const BlockStatement*>(outer->m_block[1].get())->m_hasScope);
+            assert(!dynamic_cast<const BlockStatement*>(programm[2].get())->m_hasScope);
+
+            std::stringstream outputStream;
+            EnvironmentPtr environment = Environment::CreateGlobalEnvironment(outputStream);
+            FunctionsRegistry functionsRegistry;
+            Interpreter interpreter(environment, functionsRegistry);
+            interpreter.Interpret(environment, functionsRegistry, programm, std::cerr);
+            assert(outputStream.str() == "3.000000\n1.000000\n");
+        }
+        { // deferred function bodies test
+            Scanner scanner(
+                "fun unused() { print 1 +; }"
+                "class A { A(x) { this.x = x; } get() { return this.x; } }"
+                "class B < A { B(x) { this.x = x; } get() { var y = super.get(); return y + 1; } }"
+                "fun add(a, b) { var s = a + b; return s; }"
+                "print add(1, 2);"
+                "print B(4).get();"
+            );
+            Parser parser(scanner.Tokens(), true);
+            std::vector<IStatementPtr> programm = parser.Parse(std::cerr);
+            Resolver::Result resolution = Resolver().Resolve(programm);
+            assert(!resolution.m_hasErrors);
+
+            const FunctionDeclarationStatement* add = dynamic_cast<const FunctionDeclarationStatement*>(programm[3].get());
+            assert(add->m_deferredBody && add->m_body.empty());
+
+            std::stringstream outputStream;
+            EnvironmentPtr environment = Environment::CreateGlobalEnvironment(outputStream);
+            FunctionsRegistry functionsRegistry;
+            Interpreter interpreter(environment, functionsRegistry);
+            interpreter.Interpret(environment, functionsRegistry, programm, std::cerr);
+            assert(outputStream.str() == "3.000000\n5.000000\n");
+            assert(!add->m_deferredBody && add->m_body.size() == 2);
+            assert(dynamic_cast<const FunctionDeclarationStatement*>(programm[0].get())->m_deferredBody);
+        }
+        { // parallel front end test
+            const char* source =
+                "var a = 1;\n"
+                "fun f(x) { var y = x * 2; return y; }\n"
+                "class C { get() { return \"c\"; } }\n"
+                "/* var b = 2;\n */ print f(a);\n"
+                "var s = \"x;\nvar t = 1;\";\n"
+                "print C().get() + s;\n";
+
+            std::vector<Frontend::Unit> units = Frontend(false, 1).Process({ source, "print a + 1;" }, std::cerr);
+            assert(units.size() == 2);
+            assert(units[0].m_scanners.size() == 4 && units[0].m_program.size() == 6);
+            assert(dynamic_cast<const VariableDeclarationStatement*>(units[0].m_program[4].get())->m_name.m_line == 6);
+
+            std::stringstream outputStream;
+            EnvironmentPtr environment = Environment::CreateGlobalEnvironment(outputStream);
+            FunctionsRegistry functionsRegistry;
+            Interpreter interpreter(environment, functionsRegistry);
+            for (const Frontend::Unit& unit : units)
+            {
+                assert(!unit.m_resolution.m_hasErrors);
+                interpreter.Interpret(environment, functionsRegistry, unit.m_program, std::cerr);
+            }
+            assert(outputStream.str() == "2.000000\ncx;\nvar t = 1;\n2.000000\n");
+        }
+        { // resolver test
+            Scanner scanner(
+                "var g = 1;"
+                "fun f(a) { var b = a; { var a = b; print a + g; } return a; }"
+            );
+            Parser parser(scanner.Tokens());
+            std::vector<IStatementPtr> programm = parser.Parse(std::cerr);
+            Resolver::Result resolution = Resolver().Resolve(programm);
+            assert(!resolution.m_hasErrors);
+
+            const FunctionDeclarationStatement* f = dynamic_cast<const FunctionDeclarationStatement*>(programm[1].get());
+            const Token& parameter = f->m_parameters[0];
+            const VariableDeclarationStatement* b = dynamic_cast<const VariableDeclarationStatement*>(f->m_body[0].get());
+            const ResolvedName& initializer = dynamic_cast<const VariableExpression*>(b->m_initializer.get())->m_resolved;
+            assert(initializer.m_distance == 0 && initializer.m_declaration == &parameter);
+
+            const BlockStatement* block = dynamic_cast<const BlockStatement*>(f->m_body[1].get());
+            const VariableDeclarationStatement* innerA = dynamic_cast<const VariableDeclarationStatement*>(block->m_block[0].get());
+            const ResolvedName& outerB = dynamic_cast<const VariableExpression*>(innerA->m_initializer.get())->m_resolved;
+            assert(outerB.m_distance == 1 && outerB.m_declaration == &b->m_name);
+
+            const BinaryExpression* sum = dynamic_cast<const BinaryExpression*>(dynamic_cast<const PrintStatement*>(block->m_block[1].get())->m_expression.get());
+            assert(dynamic_cast<const VariableExpression*>(sum->m_left.get())->m_resolved.m_declaration == &innerA->m_name);
+            assert(dynamic_cast<const VariableExpression*>(sum->m_right.get())->m_resolved.m_distance == ResolvedName::Global);
+
+            const ReturnStatement* returnA = dynamic_cast<const ReturnStatement*>(f->m_body[2].get());
+            assert(dynamic_cast<const VariableExpression*>(returnA->m_returnValue.get())->m_resolved.m_declaration == &parameter);
+        }
+        { // final bindings test
+            Scanner scanner(
+                "fun f(a) { return a + 1; }"
+                "var v = 0;"
+                "fun g() { var k = 2; var m = 1; m = m + k; return f(k) + m; }"
+                "print g();"
+                "v = g();"
+            );
+            Parser parser(scanner.Tokens());
+            std::vector<IStatementPtr> programm = parser.Parse(std::cerr);
+            Resolver::Result resolution = Resolver().Resolve(programm);
+            assert(!resolution.m_hasErrors);
+
+            const FunctionDeclarationStatement* g = dynamic_cast<const FunctionDeclarationStatement*>(programm[2].get());
+            const AssignmentExpression* assignM = dynamic_cast<const AssignmentExpression*>(dynamic_cast<const ExpressionStatement*>(g->m_body[2].get())->m_expression.get());
+            const BinaryExpression* sum = dynamic_cast<const BinaryExpression*>(assignM->m_expression.get());
+            const ResolvedName& m = dynamic_cast<const VariableExpression*>(sum->m_left.get())->m_resolved;
+            const ResolvedName& k = dynamic_cast<const VariableExpression*>(sum->m_right.get())->m_resolved;
+            assert(!m.m_final && !m.m_constant);
+            assert(k.m_final && k.m_constant && *k.m_constant->GetNumber() == 2.0);
+
+            const BinaryExpression* result = dynamic_cast<const BinaryExpression*>(dynamic_cast<const ReturnStatement*>(g->m_body[3].get())->m_returnValue.get());
+            const CallExpression* callF = dynamic_cast<const CallExpression*>(result->m_left.get());
+            assert(callF->m_calleeVariable && callF->m_calleeVariable->m_resolved.m_final);
+            const AssignmentExpression* assignV = dynamic_cast<const AssignmentExpression*>(dynamic_cast<const ExpressionStatement*>(programm[4].get())->m_expression.get());
+            assert(dynamic_cast<const CallExpression*>(assignV->m_expression.get())->m_calleeVariable->m_resolved.m_final);
+
+            std::stringstream outputStream;
+            EnvironmentPtr environment = Environment::CreateGlobalEnvironment(outputStream);
+            FunctionsRegistry functionsRegistry;
+            Interpreter interpreter(environment, functionsRegistry);
+            interpreter.Interpret(environment, functionsRegistry, programm, std::cerr);
+            assert(callF->m_calleeSlot != nullptr);
+
+            // a redefinition by another programm is seen through the cached storage
+            Scanner redefinition("fun f(a) { return a; } print g();");
+            Parser redefinitionParser(redefinition.Tokens());
+            std::vector<IStatementPtr> redefinitionProgramm = redefinitionParser.Parse(std::cerr);
+            Resolver::Result redefinitionResolution = Resolver().Resolve(redefinitionProgramm);
+            assert(!redefinitionResolution.m_hasErrors);
+            interpreter.Interpret(environment, functionsRegistry, redefinitionProgramm, std::cerr);
+            assert(outputStream.str() == "6.000000\n5.000000\n");
+        }
+        { // memoization test
+            Scanner scanner(
+                "fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }"
+                "fun twice(n) { var f = fib(n); return f + fib(n); }"
+                "var calls = 0;"
+                "fun counted(n) { calls = calls + 1; return n; }"
+                "print fib(20);"
+                "print twice(10);"
+                "counted(1); counted(1); print calls;"
+            );
+            Parser parser(scanner.Tokens(), true);
+            std::vector<IStatementPtr> programm = parser.Parse(std::cerr);
+            Resolver::Result resolution = Resolver().Resolve(programm);
+            assert(!resolution.m_hasErrors);
+
+            std::stringstream outputStream;
+            EnvironmentPtr environment = Environment::CreateGlobalEnvironment(outputStream);
+            FunctionsRegistry functionsRegistry;
+            Interpreter interpreter(environment, functionsRegistry);
+            interpreter.EnableMemoization(64);
+            interpreter.Interpret(environment, functionsRegistry, programm, std::cerr);
+
+            const Memoization::Statistics& statistics = interpreter.GetMemoization()->GetStatistics();
+            assert(statistics.m_misses == 22 && statistics.m_hits == 20 && statistics.m_evictions == 0);
+
+            // results of functions calling a redefined function are dropped
+            Scanner redefinition("fun fib(n) { return n; } print twice(10);");
+            Parser redefinitionParser(redefinition.Tokens());
+            std::vector<IStatementPtr> redefinitionProgramm = redefinitionParser.Parse(std::cerr);
+            Resolver::Result redefinitionResolution = Resolver().Resolve(redefinitionProgramm);
+            assert(!redefinitionResolution.m_hasErrors);
+            interpreter.Interpret(environment, functionsRegistry, redefinitionProgramm, std::cerr);
+            assert(outputStream.str() == "6765.000000\n110.000000\n2.000000\n20.000000\n");
+        }
+        { // inliner test
+            Scanner scanner(
+                "fun square(x) { return x * x; }"
+                "fun hypot2(a, b) { var s = square(a) + square(b); return s; }"
+                "var twice = fun (a) { return a + a; };"
+                "fun count(n) { if (n > 0) return count(n - 1) + 1; return 0; }"
+                "print hypot2(3, 4);"
+                "print twice(hypot2(1, 2));"
+                "print count(3);"
+            );
+            Parser parser(scanner.Tokens());
+            std::vector<IStatementPtr> programm = parser.Parse(std::cerr);
+            Resolver::Result resolution = Resolver().Resolve(programm);
+            assert(!resolution.m_hasErrors);
+
+            std::stringstream outputStream;
+            EnvironmentPtr environment = Environment::CreateGlobalEnvironment(outputStream);
+            FunctionsRegistry functionsRegistry;
+            Interpreter interpreter(environment, functionsRegistry);
+            interpreter.Interpret(environment, functionsRegistry, programm, std::cerr);
+
+            auto printedCall = [&](size_t statement) { return dynamic_cast<const CallExpression*>(dynamic_cast<const PrintStatement*>(programm[statement].get())->m_expression.get()); };
+            assert(printedCall(4)->m_inlined && printedCall(4)->m_inlined->m_slotsCount == 3);
+            assert(printedCall(5)->m_inlined);
+            assert(!printedCall(6)->m_inlined);
+
+            // the inlined body of hypot2 calls the redefined function
+            Scanner redefinition("fun square(x) { return x; } print hypot2(3, 4);");
+            Parser redefinitionParser(redefinition.Tokens());
+            std::vector<IStatementPtr> redefinitionProgramm = redefinitionParser.Parse(std::cerr);
+            Resolver::Result redefinitionResolution = Resolver().Resolve(redefinitionProgramm);
+            assert(!redefinitionResolution.m_hasErrors);
+            interpreter.Interpret(environment, functionsRegistry, redefinitionProgramm, std::cerr);
+            assert(outputStream.str() == "25.000000\n10.000000\n3.000000\n7.000000\n");
+        }
+        { // specialization test
+            Scanner scanner(
+                "fun scale(mode, x) { if (mode == \"double\") return x * 2; else if (mode == \"half\") return x / 2; return x; }"
+                "print scale(\"double\", 5);"
+                "print scale(\"half\", 5);"
+                "print scale(\"double\", 5);"
+                "var mode = \"none\";"
+                "var x = 7;"
+                "print scale(mode, x);"
+            );
+            Parser parser(scanner.Tokens());
+            std::vector<IStatementPtr> programm = parser.Parse(std::cerr);
+            Resolver::Result resolution = Resolver().Resolve(programm);
+            assert(!resolution.m_hasErrors);
+
+            std::stringstream outputStream;
+            EnvironmentPtr environment = Environment::CreateGlobalEnvironment(outputStream);
+            FunctionsRegistry functionsRegistry;
+            Interpreter interpreter(environment, functionsRegistry);
+            interpreter.Interpret(environment, functionsRegistry, programm, std::cerr);
+            assert(outputStream.str() == "10.000000\n2.500000\n10.000000\n7.000000\n");
+
+            // call sites passing the same literals share the specialization
+            auto printedCall = [&](size_t statement) { return dynamic_cast<const CallExpression*>(dynamic_cast<const PrintStatement*>(programm[statement].get())->m_expression.get()); };
+            assert(printedCall(1)->m_specialization && printedCall(1)->m_specialization == printedCall(3)->m_specialization);
+            assert(printedCall(2)->m_specialization && printedCall(2)->m_specialization != printedCall(1)->m_specialization);
+            assert(!printedCall(6)->m_specialization);
+        }
+        { // trace test
+            Scanner scanner(
+                "var total = 0;"
+                "var i = 0;"
+                "while (i < 1000) { var half = i / 2; if (i == 500) total = total - 1; else total = total + half; i = i + 1; }"
+                "while (i > 990) { print i; i = i - 5; }"
+                "print total;"
+            );
+            Parser parser(scanner.Tokens());
+            std::vector<IStatementPtr> programm = parser.Parse(std::cerr);
+            Resolver::Result resolution = Resolver().Resolve(programm);
+            assert(!resolution.m_hasErrors);
+
+            std::stringstream outputStream;
+            EnvironmentPtr environment = Environment::CreateGlobalEnvironment(outputStream);
+            FunctionsRegistry functionsRegistry;
+            Interpreter interpreter(environment, functionsRegistry);
+            interpreter.Interpret(environment, functionsRegistry, programm, std::cerr);
+
+            // the guard of the 'if' fails once, the rest of that iteration is interpreted
+            assert(dynamic_cast<const WhileStatement*>(programm[2].get())->m_trace);
+            assert(!dynamic_cast<const WhileStatement*>(programm[3].get())->m_trace);
+            assert(outputStream.str() == "1000.000000\n995.000000\n249499.000000\n");
+        }
+        { // tier-up test
+            Scanner scanner(
+                "fun area(r) { if (r < 0) return 0; return r * (2 * 2); }"
+                "var total = 0;"
+                "for (var i = 0; i < 1000; i = i + 1) total = total + area(i);"
+            );
+            Parser parser(scanner.Tokens());
+            std::vector<IStatementPtr> programm = parser.Parse(std::cerr);
+            Resolver::Result resolution = Resolver().Resolve(programm);
+            assert(!resolution.m_hasErrors);
+
+            std::stringstream outputStream;
+            EnvironmentPtr environment = Environment::CreateGlobalEnvironment(outputStream);
+            FunctionsRegistry functionsRegistry;
+            Interpreter interpreter(environment, functionsRegistry);
+            interpreter.Interpret(environment, functionsRegistry, programm, std::cerr);
+            interpreter.WaitForCompilations();
+
+            // the folded body is installed for the next calls
+            const FunctionDeclarationStatement& area = *dynamic_cast<const FunctionDeclarationStatement*>(programm[0].get());
+            assert(area.m_tiering.m_optimized.load() && area.m_tiering.m_optimized.load() != &area.m_body);
+
+            Scanner next("print total; print area(3);");
+            Parser nextParser(next.Tokens());
+            std::vector<IStatementPtr> nextProgramm = nextParser.Parse(std::cerr);
+            Resolver::Result nextResolution = Resolver().Resolve(nextProgramm);
+            assert(!nextResolution.m_hasErrors);
+            interpreter.Interpret(environment, functionsRegistry, nextProgramm, std::cerr);
+            assert(outputStream.str() == "1998000.000000\n12.000000\n");
+        }
+        { // escape analysis test
+            Scanner scanner(
+                "class Vec { Vec(x, y) { this.x = x; this.y = y; } }"
+                "class Loud { Loud(x) { print x; this.x = x; } }"
+                "fun length2(a, b) { var v = Vec(a, b); v.x = v.x * 2; return v.x * v.x + v.y * v.y; }"
+                "fun leak(a) { var v = Vec(a, a); return v; }"
+                "fun captured() { var v = Vec(1, 2); fun get() { return v.x; } return get(); }"
+                "fun loud() { var l = Loud(5); return l.x; }"
+                "print length2(1, 2);"
+                "print leak(3).x;"
+                "print captured();"
+                "print loud();"
+            );
+            Parser parser(scanner.Tokens());
+            std::vector<IStatementPtr> programm = parser.Parse(std::cerr);
+            Resolver::Result resolution = Resolver().Resolve(programm);
+            assert(!resolution.m_hasErrors);
+            EscapeAnalyzer().Analyze(programm);
+
+            auto local = [&](size_t function) { return dynamic_cast<const VariableDeclarationStatement*>(dynamic_cast<const FunctionDeclarationStatement*>(programm[function].get())->m_body[0].get()); };
+            assert(local(2)->m_scalarReplacement && local(2)->m_scalarReplacement->m_fields.size() == 2);
+            assert(!local(3)->m_scalarReplacement && !local(4)->m_scalarReplacement);
+            assert(local(5)->m_scalarReplacement);
+
+            std::stringstream outputStream;
+            EnvironmentPtr environment = Environment::CreateGlobalEnvironment(outputStream);
+            FunctionsRegistry functionsRegistry;
+            Interpreter interpreter(environment, functionsRegistry);
+            interpreter.Interpret(environment, functionsRegistry, programm, std::cerr);
+            assert(outputStream.str() == "8.000000\n3.000000\n1.000000\n5.000000\n5.000000\n");
+
+            // the constructor of Loud does more than assigning fields, so its instance is created
+            assert(local(2)->m_scalarReplacement->m_replaceable && !local(5)->m_scalarReplacement->m_replaceable);
+        }
+        { // record class test
+            Scanner scanner(
+                "class Point { var x; var y; Point(x, y) { this.x = x; this.y = y; } sum() { return this.x + this.y; } }"
+                "class Point3 < Point { var z; Point3(x, y) { this.x = x; this.y = y; } }"
+                "fun area(a, b) { var v = Point(a, b); return v.x * v.y; }"
+                "var p = Point(1, 2); p.x = 5; print p.sum();"
+                "var q = Point3(1, 2); q.z = 3; print q.sum() + q.z;"
+                "print area(2, 3);"
+                "p.w = 1;"
+            );
+            Parser parser(scanner.Tokens());
+            std::vector<IStatementPtr> programm = parser.Parse(std::cerr);
+            assert(dynamic_cast<const ClassDeclarationStatement*>(programm[0].get())->m_fields.size() == 2);
+            Resolver::Result resolution = Resolver().Resolve(programm);
+            assert(!resolution.m_hasErrors);
+            EscapeAnalyzer().Analyze(programm);
+
+            std::stringstream outputStream;
+            std::stringstream errorStream;
+            EnvironmentPtr environment = Environment::CreateGlobalEnvironment(outputStream);
+            FunctionsRegistry functionsRegistry;
+            Interpreter interpreter(environment, functionsRegistry);
+            interpreter.Interpret(environment, functionsRegistry, programm, errorStream);
+            assert(outputStream.str() == "7.000000\n6.000000\n6.000000\n");
+            assert(errorStream.str().find("Undefined field 'w' of record class 'Point'.") != std::string::npos);
+
+            // fields are checked statically inside the methods of a record class
+            Scanner undeclaredScanner("class A { var a; f() { this.b = 1; } }");
+            Parser undeclaredParser(undeclaredScanner.Tokens());
+            std::vector<IStatementPtr> undeclaredProgramm = undeclaredParser.Parse(std::cerr);
+            std::stringstream resolverErrors;
+            Gekko::SetErrorOutput(&resolverErrors);
+            Resolver::Result undeclaredResolution = Resolver().Resolve(undeclaredProgramm);
+            assert(undeclaredResolution.m_hasErrors);
+            Gekko::SetErrorOutput(nullptr);
+            assert(resolverErrors.str().find("Undefined field 'b' of record class 'A'.") != std::string::npos);
+        }
+        { // final classes and methods test
+            Scanner scanner(
+                "class Shape { Shape(n) { this.n = n; } final name() { return this.n; } describe() { return this.name() + \"!\"; } area() { return 0; } }"
+                "class Square < Shape { Square(s) { super.Shape(\"square\"); this.s = s; } area() { return this.s * this.s + super.area(); } }"
+                "final class Circle < Shape { Circle(r) { super.Shape(\"circle\"); this.r = r; } area() { return 3 * this.r * this.r; } }"
+                "var shapes = Square(2); var circle = Circle(1); var area = circle.area;"
+                "var i = 0; while (i < 3) { print shapes.describe() + circle.describe(); i = i + 1; }"
+                "print shapes.area() + area();"
+                "class Override < Shape { name() { return 1; } }"
+            );
+            Parser parser(scanner.Tokens());
+            std::vector<IStatementPtr> programm = parser.Parse(std::cerr);
+            Resolver::Result resolution = Resolver().Resolve(programm);
+            assert(!resolution.m_hasErrors);
+
+            const ClassDeclarationStatement& shape = *dynamic_cast<const ClassDeclarationStatement*>(programm[0].get());
+            const ReturnStatement& describe = *dynamic_cast<const ReturnStatement*>(shape.m_methods[2]->m_body[0].get());
+            const CallExpression& callName = *dynamic_cast<const CallExpression*>(dynamic_cast<const BinaryExpression*>(describe.m_returnValue.get())->m_left.get());
+            assert(shape.m_methods[1]->m_final && dynamic_cast<const ClassDeclarationStatement*>(programm[2].get())->m_final);
+            assert(callName.m_calleeProperty && callName.m_calleeProperty->m_finalMethod);
+
+            std::stringstream outputStream;
+            std::stringstream errorStream;
+            EnvironmentPtr environment = Environment::CreateGlobalEnvironment(outputStream);
+            FunctionsRegistry functionsRegistry;
+            Interpreter interpreter(environment, functionsRegistry);
+            interpreter.Interpret(environment, functionsRegistry, programm, errorStream);
+            assert(outputStream.str() == "square!circle!\nsquare!circle!\nsquare!circle!\n7.000000\n");
+            assert(errorStream.str().find("Can't override final method 'name'.") != std::string::npos);
+
+            // only the class and the unbound method read through a property are registered, method calls don't bind
+            assert(functionsRegistry.m_registered.size() < 20);
+
+            // without resolution 'super' is looked up through the enclosing environments
+            Scanner unresolvedScanner("class A { m() { return 1; } } class B < A { m() { return super.m() + 1; } } print B().m();");
+            Parser unresolvedParser(unresolvedScanner.Tokens());
+            std::vector<IStatementPtr> unresolvedProgramm = unresolvedParser.Parse(std::cerr);
+            std::stringstream unresolvedOutputStream;
+            EnvironmentPtr unresolvedEnvironment = Environment::CreateGlobalEnvironment(unresolvedOutputStream);
+            interpreter.Interpret(unresolvedEnvironment, functionsRegistry, unresolvedProgramm, std::cerr);
+            assert(unresolvedOutputStream.str() == "2.000000\n");
+        }
+        { // profile test
+            const char* source =
+                "fun twice(x) { if (x < 0) return 0; return x + x; }"
+                "fun half(x) { return x / 2; }"
+                "var f = twice; var total = 0; var i = 0;"
+                "while (i < 10) { if (i == 5) f = half; total = total + f(i); i = i + 1; }"
+                "print total;";
+            const std::string filename = (std::filesystem::temp_directory_path() / "gekko_profile_test.txt").string();
+
+            auto run = [&](Profile* warm)
+            {
+                Scanner scanner(source);
+                Parser parser(scanner.Tokens());
+                std::vector<IStatementPtr> programm = parser.Parse(std::cerr);
+                Resolver::Result resolution = Resolver().Resolve(programm);
+                assert(!resolution.m_hasErrors);
+                TypeInferrer().Infer(programm);
+
+                const FunctionDeclarationStatement& twice = *dynamic_cast<const FunctionDeclarationStatement*>(programm[0].get());
+                const WhileStatement& loop = *dynamic_cast<const WhileStatement*>(programm[5].get());
+                const BinaryExpression& sum = *dynamic_cast<const BinaryExpression*>(dynamic_cast<const ReturnStatement*>(twice.m_body[1].get())->m_returnValue.get());
+                if (warm)
+                {
+                    // iterations are counted with the check that ends the loop
+                    warm->Apply(programm);
+                    assert(twice.m_tiering.m_callsCount == 5 && loop.m_iterations == 11 && sum.m_feedback == TypeFeedback::Number);
+                }
+
+                std::stringstream outputStream;
+                EnvironmentPtr environment = Environment::CreateGlobalEnvironment(outputStream);
+                FunctionsRegistry functionsRegistry;
+                Interpreter interpreter(environment, functionsRegistry);
+                interpreter.Interpret(environment, functionsRegistry, programm, std::cerr);
+                assert(outputStream.str() == "37.500000\n");
+
+                Profile recorded({ source });
+                recorded.Record(programm);
+                const bool saved = recorded.Save(filename);
+                assert(saved);
+            };
+
+            run(nullptr);
+            Profile profile({ source });
+            const bool loaded = profile.Load(filename);
+            assert(loaded);
+            assert(std::count_if(profile.GetSites().begin(), profile.GetSites().end(), [](const Profile::Site& site)
+                { return site.m_type == Profile::SiteType::Call && site.m_value == static_cast<uint32_t>(Profile::CallState::Megamorphic); }) == 1);
+            run(&profile);
+
+            // the profile of other sources is ignored
+            const bool loadedForOtherSources = Profile({ "print 1;" }).Load(filename);
+            assert(!loadedForOtherSources);
+            std::filesystem::remove(filename);
+        }
+        { // transpiler test
+            Scanner scanner(
+                "fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }"
+                "var f = fib;"
+                "for (var i = 0..3) print f(i) + fib(i);"
+            );
+            Parser parser(scanner.Tokens());
+            std::vector<IStatementPtr> programm = parser.Parse(std::cerr);
+            Resolver::Result resolution = Resolver().Resolve(programm);
+            assert(!resolution.m_hasErrors);
+
+            // fib is declared once so it is called directly, f is called through the runtime
+            Transpiler::Result result = Transpiler().Transpile(programm, "");
+            assert(result.m_translated);
+            assert(result.m_code.find("f_fib_0({ runtime->Binary(") != std::string::npos);
+            assert(result.m_code.find("runtime->Call(") != std::string::npos);
+
+            Scanner classScanner("class A {} print A();");
+            Parser classParser(classScanner.Tokens());
+            std::vector<IStatementPtr> classProgramm = classParser.Parse(std::cerr);
+            Resolver::Result classResolution = Resolver().Resolve(classProgramm);
+            assert(!classResolution.m_hasErrors);
+            Transpiler::Result classResult = Transpiler().Transpile(classProgramm, "class A {} print A();");
+            assert(!classResult.m_translated);
+            assert(classResult.m_code.find("runtime->Run(0);") != std::string::npos);
+            assert(classResult.m_code.find("runtime->Print(runtime->Call(") != std::string::npos);
+
+            // statements run by the interpreter share the globals with the translated ones
+            std::stringstream outputStream;
+            Runtime runtime(outputStream);
+            Runtime::Global a;
+            runtime.Import(a, "a");
+            runtime.Load("var a = 1; print a; class B { B(v) { this.v = v; } }");
+            runtime.Run(0);
+            Token name(Token::Type::Identifier, "a", 1);
+            assert(*runtime.Get(a, name).GetNumber() == 1);
+            runtime.Assign(a, Value(2.0), name);
+            runtime.Run(1);
+            assert(outputStream.str() == "2.000000\n");
+
+            Runtime::Global b;
+            runtime.Import(b, "B");
+            runtime.Run(2);
+            Value instance = runtime.Call(name, { runtime.Get(b, name), { Value(3.0) } });
+            assert(instance.GetClassInstace());
+        }
+        { // repl session test
+            std::stringstream outputStream;
+            ReplSession session(outputStream);
+            session.Execute("fun f(x) { var y = x + 1; return y; }");
+            session.Execute("class A { get() { return f(this.v); } }");
+            session.Execute("var a = A(); a.v = 1;");
+            session.Execute("{ var b = a.get(); print b; }");
+            session.Execute("print f(a.get());");
+            assert(outputStream.str() == "2.000000\n3.000000\n");
+        }
     }
 }
 
@@ -335,13 +1037,47 @@ int main(int argc, char* argv[])
 
     runTests();
 
-    if (argc > 2)
+    // compile <script> [<executable>] builds a native executable
+    if (argc >= 3 && std::string_view(argv[1]) == "compile")
+    {
+        return compileFile(argv[2], argc >= 4 ? argv[3] : std::filesystem::path(argv[2]).stem().string());
+    }
+
+    // --memoize caches results of pure functions, --lazy parses function bodies on their first call,
+    // --profile <file> starts warm from the profile of the previous run
+    bool memoize = false;
+    bool deferFunctionBodies = false;
+    const char* profileFilename = nullptr;
+    int firstFile = 1;
+    for (; firstFile < argc; ++firstFile)
     {
-        std::cout << "Usage: Gekko [script]" << std::endl;
+        const std::string_view option(argv[firstFile]);
+        if (option == "--memoize")
+        {
+            memoize = true;
+        }
+        else if (option == "--lazy")
+        {
+            deferFunctionBodies = true;
+        }
+        else if (option == "--profile")
+        {
+            if (firstFile + 1 == argc)
+            {
+                std::cout << "usage: --profile <file> <script>..." << std::endl;
+                return 1;
+            }
+            profileFilename = argv[++firstFile];
+        }
+        else
+        {
+            break;
+        }
     }
-    else if (argc == 2)
+
+    if (argc > firstFile)
     {
-        runFile(argv[1]);
+        runFiles(std::vector<const char*>(argv + firstFile, argv + argc), memoize, deferFunctionBodies, profileFilename);
     }
     else
     {
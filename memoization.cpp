@@ -0,0 +1,213 @@
+#include "memoization.h"
+#include "purityanalyzer.h"
+#include "function.h"
+#include "interpreter.h"
+#include "expressions.h"
+#include "token.h"
+
+Memoization::Memoization(size_t maxEntriesPerFunction)
+    : m_maxEntriesPerFunction(maxEntriesPerFunction)
+{}
+
+const Value* Memoization::Find(const Function& function, Environment& globals, const std::vector<Value>& arguments, std::optional<std::string>& key)
+{
+    key = MakeKey(arguments);
+    if (!key)
+    {
+        return nullptr;
+    }
+
+    // states are stored in nodes, so the reference survives analysis of other functions
+    FunctionState& state = m_functions[&function];
+    if (state.m_purity == Purity::Pure && !AreDependenciesValid(state))
+    {
+        state = FunctionState();
+    }
+
+    if (state.m_purity == Purity::Unknown)
+    {
+        Analyze(function, globals);
+    }
+
+    if (state.m_purity != Purity::Pure)
+    {
+        key.reset();
+        return nullptr;
+    }
+
+    auto it = state.m_results.find(*key);
+    if (it != state.m_results.end())
+    {
+        ++m_statistics.m_hits;
+        return &it->second;
+    }
+
+    ++m_statistics.m_misses;
+    return nullptr;
+}
+
+void Memoization::Store(const Function& function, std::string&& key, const Value& result)
+{
+    FunctionState& state = m_functions[&function];
+    if (state.m_purity != Purity::Pure)
+    {
+        return; // invalidated by a redefinition during the call
+    }
+
+    if (state.m_results.size() >= m_maxEntriesPerFunction)
+    {
+        m_statistics.m_evictions += state.m_results.size();
+        state.m_results.clear();
+    }
+    state.m_results.emplace(std::move(key), result);
+}
+
+std::optional<std::string> Memoization::MakeKey(const std::vector<Value>& arguments)
+{
+    std::string key;
+    for (const Value& argument : arguments)
+    {
+        if (!argument.AppendKey(key))
+        {
+            return std::nullopt; // instances are mutable, functions and classes aren't worth it
+        }
+    }
+
+    return key;
+}
+
+bool Memoization::AreDependenciesValid(const FunctionState& state)
+{
+    for (const Dependency& dependency : state.m_dependencies)
+    {
+        const ICallable* const* callable = dependency.m_slot->GetCallable();
+        if (!callable || *callable != dependency.m_callable)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Memoization::Analyze(const Function& root, Environment& globals)
+{
+    struct Node
+    {
+        const Function* m_function;
+        bool m_pure = true;
+        bool m_analyzed = false; // decided by an earlier analysis, m_dependencies are already transitive
+        std::vector<Dependency> m_dependencies;
+        std::vector<size_t> m_callees;
+    };
+
+    std::vector<Node> nodes;
+    std::unordered_map<const Function*, size_t> indices;
+    auto getNode = [&](const Function* function)
+    {
+        auto [it, inserted] = indices.emplace(function, nodes.size());
+        if (inserted)
+        {
+            nodes.push_back({ function });
+        }
+        return it->second;
+    };
+
+    getNode(&root);
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        const FunctionState& state = m_functions[nodes[i].m_function];
+        if (state.m_purity != Purity::Unknown)
+        {
+            nodes[i].m_pure = state.m_purity == Purity::Pure;
+            nodes[i].m_dependencies = state.m_dependencies;
+            nodes[i].m_analyzed = true;
+            continue;
+        }
+
+        PurityAnalyzer::Result result;
+        try
+        {
+            result = PurityAnalyzer().Analyze(nodes[i].m_function->GetDeclaration());
+        }
+        catch (const Interpreter::InterpreterError&)
+        {
+            result.m_pure = false; // the body is invalid, calls report it
+        }
+
+        nodes[i].m_pure = result.m_pure;
+        for (const VariableExpression* callee : result.m_callees)
+        {
+            const Value* slot = globals.FindLocal(callee->m_name.Symbol());
+            const ICallable* const* callable = slot ? slot->GetCallable() : nullptr;
+            if (!callable)
+            {
+                nodes[i].m_pure = false; // not defined yet or a class, instances are never the same
+                break;
+            }
+
+            nodes[i].m_dependencies.push_back({ slot, *callable });
+            if (const Function* function = dynamic_cast<const Function*>(*callable))
+            {
+                const size_t callee = getNode(function);
+                nodes[i].m_callees.push_back(callee);
+            }
+            else if (!(*callable)->IsPure())
+            {
+                nodes[i].m_pure = false;
+                break;
+            }
+        }
+    }
+
+    // recursive functions assume themselves pure, so impurity is propagated to callers until nothing changes
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        for (Node& node : nodes)
+        {
+            for (size_t callee : node.m_callees)
+            {
+                if (node.m_pure && !nodes[callee].m_pure)
+                {
+                    node.m_pure = false;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    for (const Node& node : nodes)
+    {
+        if (node.m_analyzed)
+        {
+            continue;
+        }
+
+        FunctionState& state = m_functions[node.m_function];
+        state.m_purity = node.m_pure ? Purity::Pure : Purity::Impure;
+        if (!node.m_pure)
+        {
+            continue;
+        }
+
+        // dependencies of all reachable functions
+        std::vector<bool> visited(nodes.size());
+        std::vector<size_t> stack = { indices[node.m_function] };
+        visited[stack.back()] = true;
+        while (!stack.empty())
+        {
+            const Node& reached = nodes[stack.back()];
+            stack.pop_back();
+            state.m_dependencies.insert(state.m_dependencies.end(), reached.m_dependencies.begin(), reached.m_dependencies.end());
+            for (size_t callee : reached.m_callees)
+            {
+                if (!visited[callee])
+                {
+                    visited[callee] = true;
+                    stack.push_back(callee);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "value.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ICallable;
+class Function;
+struct Environment;
+
+// opt-in cache of results of pure functions, keyed by argument values.
+// purity is proven by PurityAnalyzer, functions called by a pure function are taken from the global environment
+// and its results stay valid while the same functions are stored under the called names.
+class Memoization
+{
+public:
+    static constexpr size_t DefaultMaxEntriesPerFunction = 64 * 1024;
+
+    struct Statistics
+    {
+        uint64_t m_hits = 0;
+        uint64_t m_misses = 0;
+        uint64_t m_evictions = 0; // results dropped because a function reached the limit
+    };
+
+    explicit Memoization(size_t maxEntriesPerFunction = DefaultMaxEntriesPerFunction);
+
+    // returns the memoized result of the call, otherwise sets the key to store the result with when the call can be memoized.
+    // only calls with numbers, strings, booleans and nil as arguments are memoized
+    const Value* Find(const Function& function, Environment& globals, const std::vector<Value>& arguments, std::optional<std::string>& key);
+    void Store(const Function& function, std::string&& key, const Value& result);
+
+    const Statistics& GetStatistics() const { return m_statistics; }
+
+private:
+    enum class Purity
+    {
+        Unknown,
+        Pure,
+        Impure
+    };
+
+    // a called function, the slot has to keep it for the results to stay valid
+    struct Dependency
+    {
+        const Value* m_slot;
+        const ICallable* m_callable;
+    };
+
+    struct FunctionState
+    {
+        Purity m_purity = Purity::Unknown;
+        std::vector<Dependency> m_dependencies; // transitive
+        std::unordered_map<std::string, Value> m_results;
+    };
+
+    static std::optional<std::string> MakeKey(const std::vector<Value>& arguments);
+    static bool AreDependenciesValid(const FunctionState& state);
+    // decides the purity of the function and of all functions it calls that weren't analyzed before
+    void Analyze(const Function& function, Environment& globals);
+
+    std::unordered_map<const Function*, FunctionState> m_functions;
+    size_t m_maxEntriesPerFunction;
+    Statistics m_statistics;
+};
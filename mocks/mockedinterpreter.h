@@ -9,8 +9,8 @@ struct MockedEnvironment : Environment
 {
     static MockedEnvironmentPtr Create() { return std::shared_ptr<MockedEnvironment>(new MockedEnvironment()); }
 
-    bool Hasvalue(const std::string& name) const { return m_values.find(name) != m_values.end(); }
-    Value GetValue(const std::string& name) const { return m_values.find(name)->second; }
+    bool Hasvalue(const std::string& name) const { return m_values.find(SymbolTable::Intern(name)) != m_values.end(); }
+    Value GetValue(const std::string& name) const { return m_values.find(SymbolTable::Intern(name))->second; }
 };
 
 struct MockedInterpreter : Interpreter
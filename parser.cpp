@@ -3,6 +3,7 @@
 #include "expressions.h"
 #include "expressionvisitor.h"
 #include "gekko.h"
+#include <array>
 #include <assert.h>
 
 enum class FunctionType
@@ -11,8 +12,9 @@ enum class FunctionType
     ClassMethod
 };
 
-Parser::Parser(const std::vector<Token>& tokens)
+Parser::Parser(const std::vector<Token>& tokens, bool deferFunctionBodies)
     : m_tokens(tokens)
+    , m_deferFunctionBodies(deferFunctionBodies)
 {}
 
 std::vector<IStatementPtr> Parser::Parse(std::ostream& logOutput)
@@ -28,54 +30,41 @@ std::vector<IStatementPtr> Parser::Parse(std::ostream& logOutput)
     }
     catch(const ParseError& pe)
     {
-        if (pe.m_token.m_type == Token::Type::EndOfFile)
-        {
-            Gekko::ReportError(pe.m_token.m_line, " at end", pe.m_message);
-        }
-        else
-        {
-            Gekko::ReportError(pe.m_token.m_line, " at '" + std::string(pe.m_token.m_lexeme) + "'", pe.m_message);
-        }
-
+        m_hasErrors = true;
+        ReportParseError(pe);
         Synchronize();
     }
     catch(const std::exception& e)
     {
+        m_hasErrors = true;
         logOutput << e.what() << '\n';
     }
 
     return programme;
 }
 
-IExpressionPtr Parser::ParseBinaryExpression(std::function<IExpressionPtr()> exprFunc, std::initializer_list<Token::Type> tokenTypes)
+void Parser::ReportParseError(const ParseError& parseError) const
 {
-    for (Token::Type tokenType : tokenTypes)
+    if (parseError.m_token.m_type == Token::Type::EndOfFile)
     {
-        if (!CanBeUnary(tokenType) && Match(tokenType))
-        {
-            const Token& op = m_tokens[m_current++];
-            exprFunc(); // discard right handed expression in case of an error
-            throw ParseError(op, "Binary operator appearing at the beginning of an expression");
-        }
+        Gekko::ReportError(parseError.m_token.m_line, " at end", parseError.m_message);
     }
-
-    IExpressionPtr left = exprFunc();
-    while (MatchAny(tokenTypes))
+    else
     {
-        const Token& op = m_tokens[m_current++];
-
-        IExpressionPtr right = exprFunc();
-        left = std::make_unique<BinaryExpression>(std::move(left), op, std::move(right));
+        Gekko::ReportError(parseError.m_token.m_line, " at '" + std::string(parseError.m_token.m_lexeme) + "'", parseError.m_message);
     }
-    
-    return left;
 }
 
 IStatementPtr Parser::ParseDeclaration()
 {
     if (ConsumeIfMatch(Token::Type::Class))
     {
-        return ParseClassDeclaration();
+        return ParseClassDeclaration(false);
+    }
+    else if (ConsumeIfMatch(Token::Type::Final))
+    {
+        Consume(Token::Type::Class, "Expect 'class' after 'final'.");
+        return ParseClassDeclaration(true);
     }
     else if (ConsumeIfMatch(Token::Type::Var))
     {
@@ -89,7 +78,7 @@ IStatementPtr Parser::ParseDeclaration()
     return ParseStatement();
 }
 
-IStatementPtr Parser::ParseClassDeclaration()
+IStatementPtr Parser::ParseClassDeclaration(bool isFinal)
 {
     const Token& name = Consume(Token::Type::Identifier, "Expect class name.");
 
@@ -103,14 +92,35 @@ IStatementPtr Parser::ParseClassDeclaration()
     Consume(Token::Type::OpeningBrace, "Expect '{' before class body.");
 
     std::vector<std::unique_ptr<FunctionDeclarationStatement>> methods;
+    ClassDeclarationStatement::FieldsType fields;
     while (CurrentToken().m_type != Token::Type::ClosingBrace && CurrentToken().m_type != Token::Type::EndOfFile)
     {
-        methods.push_back(ParseFunctionDeclaration(FunctionType::ClassMethod));
+        if (ConsumeIfMatch(Token::Type::Var))
+        {
+            fields.emplace_back(Consume(Token::Type::Identifier, "Expect field name."));
+            Consume(Token::Type::Semicolon, "Expect ';' after field declaration.");
+        }
+        else
+        {
+            const bool isFinalMethod = ConsumeIfMatch(Token::Type::Final);
+            methods.push_back(ParseFunctionDeclaration(FunctionType::ClassMethod));
+            methods.back()->m_final = isFinalMethod;
+        }
     }
 
     Consume(Token::Type::ClosingBrace, "Expect '}' after class body.");
 
-    return std::make_unique<ClassDeclarationStatement>(name, std::move(superClass), std::move(methods));
+    std::unique_ptr<ClassDeclarationStatement> classDeclaration = std::make_unique<ClassDeclarationStatement>(name, std::move(superClass), std::move(methods), std::move(fields));
+    classDeclaration->m_final = isFinal;
+    for (const std::unique_ptr<FunctionDeclarationStatement>& method : classDeclaration->m_methods)
+    {
+        if (method->m_deferredBody)
+        {
+            method->m_deferredBody->m_owner = classDeclaration.get();
+        }
+    }
+
+    return classDeclaration;
 }
 
 IStatementPtr Parser::ParseVariableDeclaration()
@@ -144,11 +154,7 @@ std::unique_ptr<FunctionDeclarationStatement> Parser::ParseFunctionDeclaration(F
 
     if (functionType == FunctionType::ClassMethod && ConsumeIfMatch(Token::Type::OpeningBrace))
     {
-        FunctionDeclarationStatement::BodyType functionBody = ParseBlock();
-        return std::make_unique<FunctionDeclarationStatement>(name,
-                                                            std::move(parameters),
-                                                            std::move(functionBody),
-                                                            FunctionDeclarationStatement::FunctionDeclarationType::MemberGetter);
+        functionDeclarationType = FunctionDeclarationStatement::FunctionDeclarationType::MemberGetter;
     }
     else
     {
@@ -170,19 +176,82 @@ std::unique_ptr<FunctionDeclarationStatement> Parser::ParseFunctionDeclaration(F
         Consume(Token::Type::ClosingParenthesis, "Expect ')' after " + functionTypeName + " parameters.");
 
         Consume(Token::Type::OpeningBrace, "Expect '{' before " + functionTypeName + " body.");
+    }
 
-        FunctionDeclarationStatement::BodyType functionBody = ParseBlock();
-        return std::make_unique<FunctionDeclarationStatement>(name, std::move(parameters), std::move(functionBody), functionDeclarationType);
+    // top-level bodies are only brace matched when deferring, they are parsed on the first call
+    if (m_deferFunctionBodies && m_blockDepth == 0)
+    {
+        const int bodyBegin = m_current;
+        SkipFunctionBody();
+
+        std::unique_ptr<FunctionDeclarationStatement> declaration = std::make_unique<FunctionDeclarationStatement>(
+            name, std::move(parameters), FunctionDeclarationStatement::BodyType(), functionDeclarationType);
+        declaration->m_deferredBody = std::make_unique<FunctionDeclarationStatement::DeferredBody>(
+            FunctionDeclarationStatement::DeferredBody{m_tokens, bodyBegin});
+        return declaration;
+    }
+
+    FunctionDeclarationStatement::BodyType functionBody = ParseBlock();
+    return std::make_unique<FunctionDeclarationStatement>(name, std::move(parameters), std::move(functionBody), functionDeclarationType);
+}
+
+void Parser::SkipFunctionBody()
+{
+    // only the nesting of braces and parentheses is validated here
+    std::vector<Token::Type> closing = { Token::Type::ClosingBrace };
+    while (!closing.empty())
+    {
+        const Token& token = CurrentToken();
+        switch (token.m_type)
+        {
+        case Token::Type::OpeningBrace:
+            closing.push_back(Token::Type::ClosingBrace);
+            break;
+        case Token::Type::OpeningParenthesis:
+            closing.push_back(Token::Type::ClosingParenthesis);
+            break;
+        case Token::Type::ClosingBrace:
+        case Token::Type::ClosingParenthesis:
+            if (token.m_type != closing.back())
+            {
+                throw ParseError(token, "Unbalanced '" + std::string(token.m_lexeme) + "' in function body.");
+            }
+            closing.pop_back();
+            break;
+        case Token::Type::EndOfFile:
+            throw ParseError(token, "Expect '}' after block.");
+        default:
+            break;
+        }
+        ++m_current;
+    }
+}
+
+bool Parser::ParseFunctionBody(int bodyBegin, std::vector<IStatementPtr>& body)
+{
+    m_current = bodyBegin;
+    try
+    {
+        body = ParseBlock();
+        return true;
+    }
+    catch(const ParseError& pe)
+    {
+        m_hasErrors = true;
+        ReportParseError(pe);
+        return false;
     }
 }
 
 std::vector<IStatementPtr> Parser::ParseBlock()
 {
     std::vector<IStatementPtr> block;
+    ++m_blockDepth;
     while (!Match(Token::Type::ClosingBrace) && !Match(Token::Type::EndOfFile))
     {
         block.push_back(ParseDeclaration());
     }
+    --m_blockDepth;
 
     Consume(Token::Type::ClosingBrace, "Expect '}' after block.");
 
@@ -253,50 +322,137 @@ IStatementPtr Parser::ParseForStatement()
 {
     Consume(Token::Type::OpeningParenthesis, "Expect '(' after 'for'.");
     IStatementPtr initStatement;
+    const Token* counter = nullptr;
+
+    if (ConsumeIfMatch(Token::Type::Var))
+    {
+        const Token& name = Consume(Token::Type::Identifier, "Expect variable name.");
+
+        IExpressionPtr initializer;
+        if (ConsumeIfMatch(Token::Type::Equal))
+        {
+            initializer = ParseExpression();
+            counter = &name;
+        }
 
-    if (!ConsumeIfMatch(Token::Type::Semicolon))
+        if (initializer && Match(Token::Type::DotDot))
+        {
+            const Token& range = m_tokens[m_current++];
+            IExpressionPtr rangeEnd = ParseExpression();
+            Consume(Token::Type::ClosingParenthesis, "Expect ')' after loop range.");
+
+            initStatement = std::make_unique<VariableDeclarationStatement>(name, std::move(initializer));
+            std::unique_ptr<ForStatement> forStatement = std::make_unique<ForStatement>(std::move(initStatement), nullptr, nullptr, ParseStatement());
+            forStatement->m_counter = &name;
+            forStatement->m_comparison = &range;
+            forStatement->m_rangeEnd = std::move(rangeEnd);
+            return forStatement;
+        }
+
+        Consume(Token::Type::Semicolon, "Expect ';' after variable declaration.");
+        initStatement = std::make_unique<VariableDeclarationStatement>(name, std::move(initializer));
+    }
+    else if (!ConsumeIfMatch(Token::Type::Semicolon))
     {
-        initStatement = ConsumeIfMatch(Token::Type::Var) ? ParseVariableDeclaration() : ParseExpressionStatement();
+        initStatement = ParseExpressionStatement();
     }
 
     IExpressionPtr condition;
+    const Token* comparison = nullptr;
+    const IExpression* limit = nullptr;
     if (!Match(Token::Type::Semicolon))
     {
-        condition = ParseExpression();
+        if (counter)
+        {
+            condition = ParseCountedLoopCondition(*counter, comparison, limit);
+        }
+
+        if (!condition)
+        {
+            condition = ParseExpression();
+        }
     }
     
     Consume(Token::Type::Semicolon, "Expect ';' after loop condition.");
  
+    double step = 0.0;
+    const bool isCounted = limit && MatchCountedLoopIncrement(*counter, step);
+
     IExpressionPtr increment;
-    if (!Match(Token::Type::Semicolon))
+    if (!Match(Token::Type::ClosingParenthesis))
     {
         increment = ParseExpression();
     }
 
     Consume(Token::Type::ClosingParenthesis, "Expect ')' after loop increment.");
 
-    IStatementPtr body = ParseStatement();
+    std::unique_ptr<ForStatement> forStatement = std::make_unique<ForStatement>(std::move(initStatement), std::move(condition), std::move(increment), ParseStatement());
+    if (isCounted)
+    {
+        forStatement->m_counter = counter;
+        forStatement->m_comparison = comparison;
+        forStatement->m_limit = limit;
+        forStatement->m_step = step;
+    }
+
+    return forStatement;
+}
+
+IExpressionPtr Parser::ParseCountedLoopCondition(const Token& counter, const Token*& comparison, const IExpression*& limit)
+{
+    // 'counter <op> limit;' where limit binds tighter than the comparison
+    const int start = m_current;
+    if (m_tokens[start].m_type != Token::Type::Identifier || m_tokens[start].Symbol() != counter.Symbol())
+    {
+        return nullptr;
+    }
 
-    std::vector<IStatementPtr> bodyWithIncrement;
-    bodyWithIncrement.push_back(std::move(body));
-    if (increment)
+    const Token& op = m_tokens[start + 1];
+    if (op.m_type != Token::Type::Less && op.m_type != Token::Type::LessEqual &&
+        op.m_type != Token::Type::Greater && op.m_type != Token::Type::GreaterEqual)
     {
-        IStatementPtr incrementStatement = std::make_unique<ExpressionStatement>(std::move(increment));
-        bodyWithIncrement.push_back(std::move(incrementStatement));
+        return nullptr;
     }
 
-    IStatementPtr whileBody = std::make_unique<BlockStatement>(std::move(bodyWithIncrement));
-    IStatementPtr whileStatement = std::make_unique<WhileStatement>(std::move(condition), std::move(whileBody));
+    m_current = start + 2;
+    IExpressionPtr right = ParseExpression(Precedence::Term);
+    if (!Match(Token::Type::Semicolon))
+    {
+        m_current = start;
+        return nullptr;
+    }
+
+    comparison = &op;
+    limit = right.get();
+    return std::make_unique<BinaryExpression>(std::make_unique<VariableExpression>(m_tokens[start]), op, std::move(right));
+}
+
+bool Parser::MatchCountedLoopIncrement(const Token& counter, double& step) const
+{
+    // 'counter = counter + number)' or 'counter = counter - number)'
+    if (static_cast<size_t>(m_current) + 5 >= m_tokens.size())
+    {
+        return false;
+    }
 
-    std::vector<IStatementPtr> InitializerWithWhile;
-    if (initStatement)    
+    const Token* tokens = &m_tokens[m_current];
+    if (tokens[0].m_type != Token::Type::Identifier || tokens[0].Symbol() != counter.Symbol() ||
+        tokens[1].m_type != Token::Type::Equal ||
+        tokens[2].m_type != Token::Type::Identifier || tokens[2].Symbol() != counter.Symbol() ||
+        (tokens[3].m_type != Token::Type::Plus && tokens[3].m_type != Token::Type::Minus) ||
+        tokens[4].m_type != Token::Type::Number ||
+        tokens[5].m_type != Token::Type::ClosingParenthesis)
     {
-        InitializerWithWhile.push_back(std::move(initStatement));
+        return false;
     }
 
-    InitializerWithWhile.push_back(std::move(whileStatement));
+    step = *tokens[4].LiteralValue().GetNumber();
+    if (tokens[3].m_type == Token::Type::Minus)
+    {
+        step = -step;
+    }
 
-    return std::make_unique<BlockStatement>(std::move(InitializerWithWhile));
+    return true;
 }
 
 IStatementPtr Parser::ParseBreakStatement()
@@ -341,141 +497,148 @@ IStatementPtr Parser::ParseExpressionStatement()
     return std::make_unique<ExpressionStatement>(std::move(expression));
 }
 
-IExpressionPtr Parser::ParseExpression()
+// binding power and kind of every token used as an infix operator, everything else ends an expression
+struct OperatorInfo
+{
+    enum class Kind : uint8_t
+    {
+        None,
+        Binary,
+        Logical,
+        Ternary,
+        Assignment
+    };
+
+    Kind m_kind = Kind::None;
+    Parser::Precedence m_precedence = Parser::Precedence::None;
+};
+
+static constexpr std::array<OperatorInfo, static_cast<size_t>(Token::Type::EndOfFile) + 1> Operators = []()
 {
-    return ParseComma();
+    using Kind = OperatorInfo::Kind;
+    using Precedence = Parser::Precedence;
+
+    std::array<OperatorInfo, static_cast<size_t>(Token::Type::EndOfFile) + 1> operators{};
+    auto set = [&operators](Token::Type type, Kind kind, Precedence precedence) { operators[static_cast<size_t>(type)] = {kind, precedence}; };
+
+    set(Token::Type::Comma, Kind::Binary, Precedence::Comma);
+    set(Token::Type::Equal, Kind::Assignment, Precedence::Assignment);
+    set(Token::Type::Questionmark, Kind::Ternary, Precedence::Ternary);
+    set(Token::Type::Or, Kind::Logical, Precedence::Or);
+    set(Token::Type::And, Kind::Logical, Precedence::And);
+    set(Token::Type::BangEqual, Kind::Binary, Precedence::Equality);
+    set(Token::Type::EqualEqual, Kind::Binary, Precedence::Equality);
+    set(Token::Type::Greater, Kind::Binary, Precedence::Comparison);
+    set(Token::Type::GreaterEqual, Kind::Binary, Precedence::Comparison);
+    set(Token::Type::Less, Kind::Binary, Precedence::Comparison);
+    set(Token::Type::LessEqual, Kind::Binary, Precedence::Comparison);
+    set(Token::Type::Minus, Kind::Binary, Precedence::Term);
+    set(Token::Type::Plus, Kind::Binary, Precedence::Term);
+    set(Token::Type::Slash, Kind::Binary, Precedence::Factor);
+    set(Token::Type::Star, Kind::Binary, Precedence::Factor);
+    return operators;
+}();
+
+static const OperatorInfo& GetOperatorInfo(Token::Type type)
+{
+    return Operators[static_cast<size_t>(type)];
 }
 
-IExpressionPtr Parser::ParseComma()
+// all binary operators are left associative, their right operand binds one level tighter
+static Parser::Precedence NextPrecedence(Parser::Precedence precedence)
 {
-    return ParseBinaryExpression(std::bind(&Parser::ParseAssignment, this), {Token::Type::Comma});
+    return static_cast<Parser::Precedence>(static_cast<uint8_t>(precedence) + 1);
 }
 
-IExpressionPtr Parser::ParseAssignment()
+IExpressionPtr Parser::ParseExpression(Precedence precedence)
 {
-   IExpressionPtr expression = ParseTernaryConditional(); 
-    if (ConsumeIfMatch(Token::Type::Equal))
+    const Token& first = CurrentToken();
+    const OperatorInfo& prefix = GetOperatorInfo(first.m_type);
+    if (prefix.m_kind == OperatorInfo::Kind::Binary && !CanBeUnary(first.m_type) && prefix.m_precedence >= precedence)
     {
-        struct VariableGetter : IExpressionVisitor, IExpressionVisitorContext
-        {
-            void VisitVariableExpression(const VariableExpression& variableExpression, IExpressionVisitorContext* context) const
-            {
-                VariableGetter* getter = static_cast<VariableGetter*>(context);
-                getter->m_result = &variableExpression.m_name;
-            }
-
-            const Token* m_result = nullptr;
-        } getVariableVisitor;
-
-        expression->Accept(getVariableVisitor, &getVariableVisitor);
+        ++m_current;
+        ParseExpression(NextPrecedence(prefix.m_precedence)); // discard right handed expression in case of an error
+        throw ParseError(first, "Binary operator appearing at the beginning of an expression");
+    }
 
-        if (getVariableVisitor.m_result)
+    IExpressionPtr left = ParseUnary();
+    AssignmentTarget target = m_lastTarget;
+    while (true)
+    {
+        const Token& op = CurrentToken();
+        const OperatorInfo& info = GetOperatorInfo(op.m_type);
+        if (info.m_kind == OperatorInfo::Kind::None || info.m_precedence < precedence)
         {
-            IExpressionPtr value = ParseAssignment();
-            return std::make_unique<AssignmentExpression>(*getVariableVisitor.m_result, std::move(value));
+            break;
         }
-        else
-        {
-            struct IsGetExpression : IExpressionVisitor, IExpressionVisitorContext
-            {
-                void VisitGetExpression(const GetExpression& variableExpression, IExpressionVisitorContext* context) const
-                {
-                    IsGetExpression* me = static_cast<IsGetExpression*>(context);
-                    me->m_result = &variableExpression;
-                }
-
-                const GetExpression* m_result = nullptr;
 
-            } isGetExpression;
-
-            expression->Accept(isGetExpression, &isGetExpression);
-
-            if (const GetExpression* getExpression = isGetExpression.m_result)
-            {
-                IExpressionPtr value = ParseAssignment();
-                return std::make_unique<SetExpression>(std::move(expression), *getExpression->m_owner, getExpression->m_name, std::move(value));
-            }
-            else
+        ++m_current;
+        switch (info.m_kind)
+        {
+        case OperatorInfo::Kind::Binary:
+        {
+            IExpressionPtr right = ParseExpression(NextPrecedence(info.m_precedence));
+            left = std::make_unique<BinaryExpression>(std::move(left), op, std::move(right));
+        } break;
+        case OperatorInfo::Kind::Logical:
+        {
+            IExpressionPtr right = ParseExpression(NextPrecedence(info.m_precedence));
+            left = std::make_unique<LogicalExpression>(std::move(left), op, std::move(right));
+        } break;
+        case OperatorInfo::Kind::Ternary:
+        {
+            IExpressionPtr trueBranch = ParseExpression();
+            if (!ConsumeIfMatch(Token::Type::Colon))
             {
-                ParseError(m_tokens[m_current], "Invalid assignment target.");
+                throw ParseError(m_tokens[m_current], "missing colon ':' after questionmark '?' in ternary conditional operator.");
             }
-        }
-    }
-
-    return expression;
- }
 
-IExpressionPtr Parser::ParseTernaryConditional()
-{
-    IExpressionPtr expression = ParseOr();
-
-    while (ConsumeIfMatch(Token::Type::Questionmark))
-    {
-        IExpressionPtr trueBranch = ParseExpression();
-
-        if (ConsumeIfMatch(Token::Type::Colon))
-        {
             IExpressionPtr falseBranch = ParseExpression();
-            expression = std::make_unique<TernaryConditionalExpression>(std::move(expression), std::move(trueBranch), std::move(falseBranch));
-        }
-        else
+            left = std::make_unique<TernaryConditionalExpression>(std::move(left), std::move(trueBranch), std::move(falseBranch));
+        } break;
+        case OperatorInfo::Kind::Assignment:
         {
-            throw ParseError(m_tokens[m_current], "missing colon ':' after questionmark '?' in ternary conditional operator.");
+            left = ParseAssignment(std::move(left), target, op);
+        } break;
+        default: break;
         }
+
+        target = AssignmentTarget::None;
     }
 
-    return expression;
+    return left;
 }
 
-IExpressionPtr Parser::ParseLogicalExpression(std::function<IExpressionPtr()> exprFunc, Token::Type tokenType)
+IExpressionPtr Parser::ParseAssignment(IExpressionPtr target, AssignmentTarget targetKind, const Token& equal)
 {
-    IExpressionPtr expression = exprFunc();
-    if (Match(tokenType))
+    // right associative, 'a = b = c' assigns 'b = c' to 'a'
+    switch (targetKind)
     {
-        const Token& token = m_tokens[m_current++];
-        IExpressionPtr right = exprFunc();
-        return std::make_unique<LogicalExpression>(std::move(expression), token, std::move(right));
+    case AssignmentTarget::Variable:
+    {
+        const Token& name = static_cast<const VariableExpression&>(*target).m_name;
+        return std::make_unique<AssignmentExpression>(name, ParseExpression(Precedence::Assignment));
+    }
+    case AssignmentTarget::Property:
+    {
+        const GetExpression& getExpression = static_cast<const GetExpression&>(*target);
+        const IExpression& owner = *getExpression.m_owner;
+        const Token& name = getExpression.m_name;
+        IExpressionPtr value = ParseExpression(Precedence::Assignment);
+        return std::make_unique<SetExpression>(std::move(target), owner, name, std::move(value));
+    }
+    default: throw ParseError(equal, "Invalid assignment target.");
     }
-
-    return expression;    
-}
-
-IExpressionPtr Parser::ParseOr()
-{
-    return ParseLogicalExpression(std::bind(&Parser::ParseAnd, this), Token::Type::Or);
-}
-
-IExpressionPtr Parser::ParseAnd()
-{
-    return ParseLogicalExpression(std::bind(&Parser::ParseEquality, this), Token::Type::And);
-}
-
-IExpressionPtr Parser::ParseEquality()
-{
-    return ParseBinaryExpression(std::bind(&Parser::ParseComparison, this), {Token::Type::BangEqual, Token::Type::EqualEqual});
-} 
-
-IExpressionPtr Parser::ParseComparison()
-{    
-    return ParseBinaryExpression(std::bind(&Parser::ParseTerm, this), {Token::Type::Greater, Token::Type::GreaterEqual, Token::Type::LessEqual, Token::Type::Less});
-} 
-
-IExpressionPtr Parser::ParseTerm()
-{
-    return ParseBinaryExpression(std::bind(&Parser::ParseFactor, this), {Token::Type::Minus, Token::Type::Plus});
-}
-
-IExpressionPtr Parser::ParseFactor()
-{
-    return ParseBinaryExpression(std::bind(&Parser::ParseUnary, this), {Token::Type::Slash, Token::Type::Star});
 }
 
 IExpressionPtr Parser::ParseUnary()
 {
-    if (MatchAny({Token::Type::Bang, Token::Type::Minus}))
+    if (Match(Token::Type::Bang) || Match(Token::Type::Minus))
     {
         const Token& op = m_tokens[m_current++];
-        return std::make_unique<UnaryExpression>(op, ParseUnary());
+        IExpressionPtr right = ParseUnary();
+        m_lastTarget = AssignmentTarget::None;
+        return std::make_unique<UnaryExpression>(op, std::move(right));
     }
 
     return ParseCall();
@@ -483,7 +646,9 @@ IExpressionPtr Parser::ParseUnary()
 
 IExpressionPtr Parser::ParseCall()
 {
+    const bool isIdentifier = Match(Token::Type::Identifier);
     IExpressionPtr expression = ParsePrimary();
+    AssignmentTarget target = isIdentifier ? AssignmentTarget::Variable : AssignmentTarget::None;
     while (true)
     {
         if (ConsumeIfMatch(Token::Type::OpeningParenthesis))
@@ -493,7 +658,7 @@ IExpressionPtr Parser::ParseCall()
             {
                 do
                 {
-                    argumets.emplace_back(ParseAssignment());
+                    argumets.emplace_back(ParseExpression(Precedence::Assignment));
                     if (argumets.size() >= 255)
                     {
                         Gekko::ReportError(CurrentToken(), "Can't have more than 255 arguments.");
@@ -503,11 +668,13 @@ IExpressionPtr Parser::ParseCall()
 
             Consume(Token::Type::ClosingParenthesis, "Expect ')' after arguments.");
             expression = std::make_unique<CallExpression>(std::move(expression), PreviousToken(), std::move(argumets));
+            target = AssignmentTarget::None;
         }
         else if (ConsumeIfMatch(Token::Type::Dot))
         {
             const Token& name = Consume(Token::Type::Identifier, "Expect property name after '.'.");
             expression = std::make_unique<GetExpression>(std::move(expression),  name);   
+            target = AssignmentTarget::Property;
         }
         else
         {
@@ -515,6 +682,7 @@ IExpressionPtr Parser::ParseCall()
         }
     }
 
+    m_lastTarget = target;
     return expression;
 }
 
@@ -527,7 +695,7 @@ IExpressionPtr Parser::ParsePrimary()
     case Token::Type::True:     return std::make_unique<LiteralExpression>(Value(true));
     case Token::Type::Nil:      return std::make_unique<LiteralExpression>();
     case Token::Type::Number:
-    case Token::Type::String:   return std::make_unique<LiteralExpression>(Value(token.m_literalvalue));
+    case Token::Type::String:   return std::make_unique<LiteralExpression>(token.LiteralValue());
     case Token::Type::OpeningParenthesis:
     {
         IExpressionPtr expression = ParseExpression();
@@ -579,19 +747,6 @@ IExpressionPtr Parser::ParsePrimary()
     }
 }
 
-bool Parser::MatchAny(std::initializer_list<Token::Type> tokenTypes) const
-{
-    for (Token::Type tokenType : tokenTypes)
-    {
-        if (m_tokens[m_current].m_type == tokenType)
-        {
-            return true;
-        }            
-    } 
-
-    return false;   
-}
-
 bool Parser::Match(Token::Type tokenType) const
 {
     return m_tokens[m_current].m_type == tokenType;
@@ -648,6 +803,7 @@ void Parser::Synchronize()
         switch (m_tokens[m_current].m_type)
         {
         case Token::Type::Class:
+        case Token::Type::Final:
         case Token::Type::Fun:
         case Token::Type::Var:
         case Token::Type::For:
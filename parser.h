@@ -1,7 +1,7 @@
 #pragma once 
 
 #include <vector>
-#include <functional>
+#include <cstdint>
 #include "token.h"
 
 struct IExpression;
@@ -14,13 +14,34 @@ struct FunctionDeclarationStatement;
 enum class FunctionType;
 
 // consumes an array of tokens and produces a programm (for now an array of statements).
-// uses recursive descent for it. 
+// uses recursive descent for statements and precedence climbing for expressions.
 class Parser
 {
 public:
-    Parser(const std::vector<Token>& tokens);
+    // binding power of infix operators, from the loosest to the tightest
+    enum class Precedence : uint8_t
+    {
+        None,
+        Comma,
+        Assignment,
+        Ternary,
+        Or,
+        And,
+        Equality,
+        Comparison,
+        Term,
+        Factor
+    };
+
+    // with deferFunctionBodies top-level function and method bodies are only brace matched,
+    // see FunctionDeclarationStatement::DeferredBody
+    Parser(const std::vector<Token>& tokens, bool deferFunctionBodies = false);
 
     std::vector<IStatementPtr> Parse(std::ostream& logOutput);
+    // parsing stops at the first error, the programm holds the statements before it
+    bool HasErrors() const { return m_hasErrors; }
+    // parses a body deferred by a parser over the same tokens, reports errors and returns false on failure
+    bool ParseFunctionBody(int bodyBegin, std::vector<IStatementPtr>& body);
 protected:
     struct ParseError : std::exception
     {
@@ -35,10 +56,14 @@ protected:
         std::string m_message;
     };
 
-    IExpressionPtr ParseBinaryExpression(std::function<IExpressionPtr()> exprFunc, std::initializer_list<Token::Type> tokenTypes);
-    IExpressionPtr ParseLogicalExpression(std::function<IExpressionPtr()> exprFunc, Token::Type tokenType);
+    // kind of the last expression produced by ParseCall/ParseUnary, decides what '=' assigns to
+    enum class AssignmentTarget
+    {
+        None,
+        Variable,
+        Property
+    };
 
-    bool MatchAny(std::initializer_list<Token::Type> tokenTypes) const;
     bool Match(Token::Type tokenType) const;
     bool ConsumeIfMatch(Token::Type tokenType);
     const Token& Consume(Token::Type tokenType, std::string&& errorMessage);
@@ -48,35 +73,35 @@ protected:
     const Token& PreviousToken() const;
  
     IStatementPtr ParseDeclaration();
-    IStatementPtr ParseClassDeclaration();
+    IStatementPtr ParseClassDeclaration(bool isFinal);
     IStatementPtr ParseVariableDeclaration();
     std::unique_ptr<FunctionDeclarationStatement> ParseFunctionDeclaration(FunctionType functionType); 
+    void SkipFunctionBody();
     IStatementPtr ParseStatement();
     IStatementPtr ParseBlockStatement();
     IStatementPtr ParseIfStatement();
     IStatementPtr ParseWhileStatement();
     IStatementPtr ParseForStatement();
+    IExpressionPtr ParseCountedLoopCondition(const Token& counter, const Token*& comparison, const IExpression*& limit);
+    bool MatchCountedLoopIncrement(const Token& counter, double& step) const;
     IStatementPtr ParseBreakStatement();
     IStatementPtr ParseReturnStatement();
     IStatementPtr ParsePrintStatement();
     IStatementPtr ParseExpressionStatement();
-    IExpressionPtr ParseExpression();
-    IExpressionPtr ParseAssignment();
-    IExpressionPtr ParseComma();
-    IExpressionPtr ParseTernaryConditional();
-    IExpressionPtr ParseOr();
-    IExpressionPtr ParseAnd();
-    IExpressionPtr ParseEquality();
-    IExpressionPtr ParseComparison();
-    IExpressionPtr ParseTerm();
-    IExpressionPtr ParseFactor();
+    IExpressionPtr ParseExpression(Precedence precedence = Precedence::Comma);
+    IExpressionPtr ParseAssignment(IExpressionPtr target, AssignmentTarget targetKind, const Token& equal);
     IExpressionPtr ParseUnary();
     IExpressionPtr ParseCall();
     IExpressionPtr ParsePrimary();
     std::vector<IStatementPtr> ParseBlock();
 
     void Synchronize();
+    void ReportParseError(const ParseError& parseError) const;
 
     int m_current = 0;
+    int m_blockDepth = 0;
+    bool m_hasErrors = false;
+    AssignmentTarget m_lastTarget = AssignmentTarget::None;
     const std::vector<Token>& m_tokens; 
+    const bool m_deferFunctionBodies = false;
 };
\ No newline at end of file
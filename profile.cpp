@@ -0,0 +1,376 @@
+#include "profile.h"
+#include "statementvisitor.h"
+#include "expressionvisitor.h"
+#include "statements.h"
+#include "expressions.h"
+#include "function.h"
+#include "interpreter.h"
+#include "trace.h"
+#include <algorithm>
+#include <fstream>
+
+namespace
+{
+    struct ProfileContext : IStatementVisitorContext, IExpressionVisitorContext
+    {
+        ProfileContext(std::vector<Profile::Site>& sites, bool recording, size_t next)
+            : m_sites(sites)
+            , m_recording(recording)
+            , m_next(next)
+        {}
+
+        // records the site or takes the one to apply, returns null unless applying
+        const Profile::Site* Visit(Profile::SiteType type, uint32_t value)
+        {
+            if (m_recording)
+            {
+                m_sites.push_back(Profile::Site{type, value});
+                return nullptr;
+            }
+
+            if (m_mismatched || m_next >= m_sites.size() || m_sites[m_next].m_type != type)
+            {
+                m_mismatched = true;
+                return nullptr;
+            }
+            return &m_sites[m_next++];
+        }
+
+        std::vector<Profile::Site>& m_sites;
+        bool m_recording;
+        size_t m_next;
+        bool m_mismatched = false;
+    };
+
+    ProfileContext& GetProfileContext(IStatementVisitorContext* context)
+    {
+        return *static_cast<ProfileContext*>(context);
+    }
+
+    ProfileContext& GetProfileContext(IExpressionVisitorContext* context)
+    {
+        return *static_cast<ProfileContext*>(context);
+    }
+
+    // visits the sites in the same order when recording and applying
+    struct ProfileWalker : IStatementVisitor, IExpressionVisitor
+    {
+        void Walk(const std::vector<IStatementPtr>& statements, ProfileContext& context) const
+        {
+            for (const IStatementPtr& statement : statements)
+            {
+                Walk(statement.get(), context);
+            }
+        }
+
+        void Walk(const IStatement* statement, ProfileContext& context) const
+        {
+            if (statement && !context.m_mismatched)
+            {
+                statement->Accept(*this, &context);
+            }
+        }
+
+        void Walk(const IExpression* expression, ProfileContext& context) const
+        {
+            if (expression && !context.m_mismatched)
+            {
+                expression->Accept(*this, &context);
+            }
+        }
+
+        void WalkFunction(Tiering& tiering, const std::vector<IStatementPtr>& body, const FunctionDeclarationStatement* declaration, ProfileContext& context) const
+        {
+            if (context.m_recording)
+            {
+                const bool deferred = declaration && declaration->m_deferredBody;
+                context.Visit(deferred ? Profile::SiteType::DeferredFunction : Profile::SiteType::Function, tiering.m_callsCount);
+                if (!deferred)
+                {
+                    Walk(body, context);
+                }
+                return;
+            }
+
+            if (context.m_mismatched || context.m_next >= context.m_sites.size())
+            {
+                context.m_mismatched = true;
+                return;
+            }
+
+            // functions the recorded run didn't call stay deferred
+            const Profile::SiteType type = context.m_sites[context.m_next].m_type;
+            const Profile::Site* site = context.Visit(type == Profile::SiteType::DeferredFunction ? type : Profile::SiteType::Function, 0);
+            if (!site)
+            {
+                return;
+            }
+
+            tiering.m_callsCount = std::min(site->m_value, Interpreter::HotCallsCount - 1);
+            if (type == Profile::SiteType::DeferredFunction)
+            {
+                return;
+            }
+
+            if (declaration && declaration->m_deferredBody)
+            {
+                try
+                {
+                    Function::ParseDeferredBody(*declaration);
+                }
+                catch (const Interpreter::InterpreterError&)
+                {
+                    context.m_mismatched = true;
+                    return;
+                }
+            }
+            Walk(body, context);
+        }
+
+        virtual void VisitExpressionStatement(const ExpressionStatement& statement, IStatementVisitorContext* context) const override
+        {
+            Walk(statement.m_expression.get(), GetProfileContext(context));
+        }
+
+        virtual void VisitPrintStatement(const PrintStatement& statement, IStatementVisitorContext* context) const override
+        {
+            Walk(statement.m_expression.get(), GetProfileContext(context));
+        }
+
+        virtual void VisitVariableDeclarationStatement(const VariableDeclarationStatement& statement, IStatementVisitorContext* context) const override
+        {
+            Walk(statement.m_initializer.get(), GetProfileContext(context));
+        }
+
+        virtual void VisitFunctionDeclarationStatement(const FunctionDeclarationStatement& statement, IStatementVisitorContext* context) const override
+        {
+            WalkFunction(statement.m_tiering, statement.m_body, &statement, GetProfileContext(context));
+        }
+
+        virtual void VisitClassDeclarationStatement(const ClassDeclarationStatement& statement, IStatementVisitorContext* context) const override
+        {
+            for (const std::unique_ptr<FunctionDeclarationStatement>& method : statement.m_methods)
+            {
+                Walk(method.get(), GetProfileContext(context));
+            }
+        }
+
+        virtual void VisitBlockStatement(const BlockStatement& statement, IStatementVisitorContext* context) const override
+        {
+            Walk(statement.m_block, GetProfileContext(context));
+        }
+
+        virtual void VisitIfStatement(const IfStatement& statement, IStatementVisitorContext* context) const override
+        {
+            ProfileContext& profileContext = GetProfileContext(context);
+            Walk(statement.m_condition.get(), profileContext);
+            Walk(statement.m_trueBranch.get(), profileContext);
+            Walk(statement.m_falseBranch.get(), profileContext);
+        }
+
+        virtual void VisitWhileStatement(const WhileStatement& statement, IStatementVisitorContext* context) const override
+        {
+            ProfileContext& profileContext = GetProfileContext(context);
+            const uint32_t iterations = statement.m_untraceable ? Profile::UntraceableLoop : statement.m_trace ? Trace::HotLoopIterations : statement.m_iterations;
+            if (const Profile::Site* site = profileContext.Visit(Profile::SiteType::Loop, iterations))
+            {
+                statement.m_untraceable = site->m_value == Profile::UntraceableLoop;
+                statement.m_iterations = statement.m_untraceable ? 0 : std::min(site->m_value, Trace::HotLoopIterations - 1);
+            }
+
+            Walk(statement.m_condition.get(), profileContext);
+            Walk(statement.m_body.get(), profileContext);
+        }
+
+        virtual void VisitForStatement(const ForStatement& statement, IStatementVisitorContext* context) const override
+        {
+            ProfileContext& profileContext = GetProfileContext(context);
+            Walk(statement.m_initializer.get(), profileContext);
+            Walk(statement.m_condition.get(), profileContext);
+            Walk(statement.m_increment.get(), profileContext);
+            Walk(statement.m_rangeEnd.get(), profileContext);
+            Walk(statement.m_body.get(), profileContext);
+        }
+
+        virtual void VisitReturnStatement(const ReturnStatement& statement, IStatementVisitorContext* context) const override
+        {
+            Walk(statement.m_returnValue.get(), GetProfileContext(context));
+        }
+
+        virtual void VisitUnaryExpression(const UnaryExpression& unaryExpression, IExpressionVisitorContext* context) const override
+        {
+            Walk(unaryExpression.m_expression.get(), GetProfileContext(context));
+        }
+
+        virtual void VisitBinaryExpression(const BinaryExpression& binaryExpression, IExpressionVisitorContext* context) const override
+        {
+            ProfileContext& profileContext = GetProfileContext(context);
+            if (const Profile::Site* site = profileContext.Visit(Profile::SiteType::Operator, static_cast<uint32_t>(binaryExpression.m_feedback)))
+            {
+                binaryExpression.m_feedback = static_cast<TypeFeedback>(site->m_value);
+            }
+
+            Walk(binaryExpression.m_left.get(), profileContext);
+            Walk(binaryExpression.m_right.get(), profileContext);
+        }
+
+        virtual void VisitTernaryConditionalExpression(const TernaryConditionalExpression& ternaryConditionalExpression, IExpressionVisitorContext* context) const override
+        {
+            ProfileContext& profileContext = GetProfileContext(context);
+            Walk(ternaryConditionalExpression.m_condition.get(), profileContext);
+            Walk(ternaryConditionalExpression.m_trueBranch.get(), profileContext);
+            Walk(ternaryConditionalExpression.m_falseBranch.get(), profileContext);
+        }
+
+        virtual void VisitGroupingExpression(const GroupingExpression& groupingExpression, IExpressionVisitorContext* context) const override
+        {
+            Walk(groupingExpression.m_expression.get(), GetProfileContext(context));
+        }
+
+        virtual void VisitAssignmentExpression(const AssignmentExpression& assignmentExpression, IExpressionVisitorContext* context) const override
+        {
+            Walk(assignmentExpression.m_expression.get(), GetProfileContext(context));
+        }
+
+        virtual void VisitLogicalExpression(const LogicalExpression& logicalExpression, IExpressionVisitorContext* context) const override
+        {
+            ProfileContext& profileContext = GetProfileContext(context);
+            Walk(logicalExpression.m_left.get(), profileContext);
+            Walk(logicalExpression.m_right.get(), profileContext);
+        }
+
+        // monomorphic callees don't survive the run, megamorphic call sites skip caching, inlining and specialization right away
+        virtual void VisitCallExpression(const CallExpression& callExpression, IExpressionVisitorContext* context) const override
+        {
+            ProfileContext& profileContext = GetProfileContext(context);
+            const Profile::CallState state = callExpression.m_megamorphic ? Profile::CallState::Megamorphic
+                : callExpression.m_cachedCallable || callExpression.m_cachedClass ? Profile::CallState::Monomorphic : Profile::CallState::Uninitialized;
+            if (const Profile::Site* site = profileContext.Visit(Profile::SiteType::Call, static_cast<uint32_t>(state)))
+            {
+                callExpression.m_megamorphic = site->m_value == static_cast<uint32_t>(Profile::CallState::Megamorphic);
+            }
+
+            Walk(callExpression.m_calle.get(), profileContext);
+            for (const IExpressionPtr& argument : callExpression.m_arguments)
+            {
+                Walk(argument.get(), profileContext);
+            }
+        }
+
+        virtual void VisitGetExpression(const GetExpression& getExpression, IExpressionVisitorContext* context) const override
+        {
+            Walk(getExpression.m_owner.get(), GetProfileContext(context));
+        }
+
+        virtual void VisitSetExpression(const SetExpression& setExpression, IExpressionVisitorContext* context) const override
+        {
+            ProfileContext& profileContext = GetProfileContext(context);
+            Walk(setExpression.m_getter.get(), profileContext);
+            Walk(setExpression.m_value.get(), profileContext);
+        }
+
+        virtual void VisitLambdaExpression(const LambdaExpression& lambdaExpression, IExpressionVisitorContext* context) const override
+        {
+            WalkFunction(lambdaExpression.m_tiering, lambdaExpression.m_body, nullptr, GetProfileContext(context));
+        }
+    };
+
+    constexpr char SiteLetters[] = { 'f', 'd', 'o', 'c', 'l' };
+}
+
+Profile::Profile(const std::vector<std::string_view>& sources)
+    : m_hash(Hash(sources))
+{}
+
+uint64_t Profile::Hash(const std::vector<std::string_view>& sources)
+{
+    // FNV-1a, stays the same across builds and runs
+    uint64_t hash = 14695981039346656037ull;
+    auto append = [&hash](unsigned char byte)
+    {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    };
+
+    for (std::string_view source : sources)
+    {
+        for (char c : source)
+        {
+            append(static_cast<unsigned char>(c));
+        }
+        append(0); // files are hashed separately from their concatenation
+    }
+    return hash;
+}
+
+bool Profile::Load(const std::string& filename)
+{
+    std::ifstream file(filename);
+    std::string magic;
+    uint32_t version = 0;
+    uint64_t hash = 0;
+    if (!(file >> magic >> version >> std::hex >> hash >> std::dec) || magic != "gekko-profile" || version != Version || hash != m_hash)
+    {
+        return false;
+    }
+
+    std::vector<Site> sites;
+    char letter;
+    uint32_t value;
+    while (file >> letter >> value)
+    {
+        const char* type = std::find(std::begin(SiteLetters), std::end(SiteLetters), letter);
+        if (type == std::end(SiteLetters))
+        {
+            return false;
+        }
+        sites.push_back(Site{static_cast<SiteType>(type - std::begin(SiteLetters)), value});
+
+        const bool invalid = (sites.back().m_type == SiteType::Operator && value > static_cast<uint32_t>(TypeFeedback::Generic))
+            || (sites.back().m_type == SiteType::Call && value > static_cast<uint32_t>(CallState::Megamorphic));
+        if (invalid)
+        {
+            return false;
+        }
+    }
+
+    if (!file.eof())
+    {
+        return false;
+    }
+
+    m_sites = std::move(sites);
+    m_applied = 0;
+    m_mismatched = false;
+    return true;
+}
+
+bool Profile::Save(const std::string& filename) const
+{
+    std::ofstream file(filename, std::ios::trunc);
+    file << "gekko-profile " << Version << ' ' << std::hex << m_hash << std::dec << '\n';
+    for (const Site& site : m_sites)
+    {
+        file << SiteLetters[static_cast<size_t>(site.m_type)] << ' ' << site.m_value << '\n';
+    }
+    return static_cast<bool>(file.flush());
+}
+
+void Profile::Record(const std::vector<IStatementPtr>& programm)
+{
+    ProfileContext context(m_sites, true, 0);
+    ProfileWalker().Walk(programm, context);
+}
+
+void Profile::Apply(const std::vector<IStatementPtr>& programm)
+{
+    if (m_mismatched)
+    {
+        return;
+    }
+
+    ProfileContext context(m_sites, false, m_applied);
+    ProfileWalker().Walk(programm, context);
+    m_applied = context.m_next;
+    m_mismatched = context.m_mismatched;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct IStatement;
+using IStatementPtr = std::unique_ptr<const IStatement>;
+
+// feedback of a run stored on exit and loaded by the next run of the same sources, so short runs start warm.
+// sites are the functions, operators, call sites and loops in the order of a walk over the programms,
+// a profile is only applied to the sources it was recorded for, they are matched by a hash of their content.
+class Profile
+{
+public:
+    static constexpr uint32_t Version = 1;
+    static constexpr uint32_t UntraceableLoop = ~0u;
+
+    enum class SiteType : uint8_t
+    {
+        Function, // value is the calls count
+        DeferredFunction, // never called, its body wasn't parsed
+        Operator, // TypeFeedback of a binary expression
+        Call, // CallState
+        Loop // interpreted iterations or UntraceableLoop
+    };
+
+    enum class CallState : uint32_t
+    {
+        Uninitialized,
+        Monomorphic,
+        Megamorphic
+    };
+
+    struct Site
+    {
+        SiteType m_type;
+        uint32_t m_value;
+    };
+
+    explicit Profile(const std::vector<std::string_view>& sources);
+
+    // false when the file is missing, damaged or recorded for other sources
+    bool Load(const std::string& filename);
+    bool Save(const std::string& filename) const;
+
+    // appends the feedback collected in a programm, programms are recorded in the order they are applied
+    void Record(const std::vector<IStatementPtr>& programm);
+    // seeds the feedback of the next programm before it runs, functions called by the recorded run are parsed now.
+    // hot functions and loops get compiled on their first call and iteration, nothing is seeded past a site that doesn't match
+    void Apply(const std::vector<IStatementPtr>& programm);
+
+    const std::vector<Site>& GetSites() const { return m_sites; }
+
+private:
+    static uint64_t Hash(const std::vector<std::string_view>& sources);
+
+    uint64_t m_hash;
+    std::vector<Site> m_sites;
+    size_t m_applied = 0; // sites consumed by Apply
+    bool m_mismatched = false;
+};
@@ -0,0 +1,261 @@
+#include "purityanalyzer.h"
+#include "statements.h"
+#include "expressions.h"
+#include "token.h"
+#include <set>
+
+struct PurityAnalyzerContext : IStatementVisitorContext, IExpressionVisitorContext
+{
+    explicit PurityAnalyzerContext(PurityAnalyzer::Result& result)
+        : m_result(result)
+    {}
+
+    bool IsOwnLocal(const ResolvedName& name) const
+    {
+        return name.m_declaration && m_locals.contains(name.m_declaration);
+    }
+
+    PurityAnalyzer::Result& m_result;
+    std::set<const Token*> m_locals; // parameters and variables declared by the analyzed body
+};
+
+static PurityAnalyzerContext& GetPurityAnalyzerContext(IStatementVisitorContext& context)
+{
+    return static_cast<PurityAnalyzerContext&>(context);
+}
+
+static PurityAnalyzerContext& GetPurityAnalyzerContext(IExpressionVisitorContext& context)
+{
+    return static_cast<PurityAnalyzerContext&>(context);
+}
+
+PurityAnalyzer::Result PurityAnalyzer::Analyze(const FunctionDeclarationStatement& declaration) const
+{
+    Result result;
+    PurityAnalyzerContext context(result);
+    for (const Token& parameter : declaration.m_parameters)
+    {
+        context.m_locals.insert(&parameter);
+    }
+
+    Analyze(declaration.m_body, context);
+
+    if (!result.m_pure)
+    {
+        result.m_callees.clear();
+    }
+    return result;
+}
+
+void PurityAnalyzer::Analyze(const std::vector<IStatementPtr>& statements, PurityAnalyzerContext& context) const
+{
+    for (const IStatementPtr& statement : statements)
+    {
+        if (!context.m_result.m_pure)
+        {
+            return;
+        }
+        statement->Accept(*this, &context);
+    }
+}
+
+void PurityAnalyzer::Analyze(const IExpression& expression, PurityAnalyzerContext& context) const
+{
+    if (context.m_result.m_pure)
+    {
+        expression.Accept(*this, &context);
+    }
+}
+
+void PurityAnalyzer::VisitExpressionStatement(const ExpressionStatement& statement, IStatementVisitorContext* context) const
+{
+    Analyze(*statement.m_expression, GetPurityAnalyzerContext(*context));
+}
+
+void PurityAnalyzer::VisitPrintStatement(const PrintStatement& statement, IStatementVisitorContext* context) const
+{
+    GetPurityAnalyzerContext(*context).m_result.m_pure = false;
+}
+
+void PurityAnalyzer::VisitVariableDeclarationStatement(const VariableDeclarationStatement& statement, IStatementVisitorContext* context) const
+{
+    PurityAnalyzerContext& analyzerContext = GetPurityAnalyzerContext(*context);
+
+    if (statement.m_initializer)
+    {
+        Analyze(*statement.m_initializer, analyzerContext);
+    }
+    analyzerContext.m_locals.insert(&statement.m_name);
+}
+
+void PurityAnalyzer::VisitFunctionDeclarationStatement(const FunctionDeclarationStatement& statement, IStatementVisitorContext* context) const
+{
+    // closures capture the call environment
+    GetPurityAnalyzerContext(*context).m_result.m_pure = false;
+}
+
+void PurityAnalyzer::VisitClassDeclarationStatement(const ClassDeclarationStatement& statement, IStatementVisitorContext* context) const
+{
+    GetPurityAnalyzerContext(*context).m_result.m_pure = false;
+}
+
+void PurityAnalyzer::VisitBlockStatement(const BlockStatement& statement, IStatementVisitorContext* context) const
+{
+    Analyze(statement.m_block, GetPurityAnalyzerContext(*context));
+}
+
+void PurityAnalyzer::VisitIfStatement(const IfStatement& statement, IStatementVisitorContext* context) const
+{
+    PurityAnalyzerContext& analyzerContext = GetPurityAnalyzerContext(*context);
+
+    Analyze(*statement.m_condition, analyzerContext);
+    statement.m_trueBranch->Accept(*this, context);
+    if (statement.m_falseBranch)
+    {
+        statement.m_falseBranch->Accept(*this, context);
+    }
+}
+
+void PurityAnalyzer::VisitWhileStatement(const WhileStatement& statement, IStatementVisitorContext* context) const
+{
+    Analyze(*statement.m_condition, GetPurityAnalyzerContext(*context));
+    statement.m_body->Accept(*this, context);
+}
+
+void PurityAnalyzer::VisitForStatement(const ForStatement& statement, IStatementVisitorContext* context) const
+{
+    PurityAnalyzerContext& analyzerContext = GetPurityAnalyzerContext(*context);
+
+    if (statement.m_initializer)
+    {
+        statement.m_initializer->Accept(*this, context);
+    }
+
+    if (statement.m_rangeEnd)
+    {
+        Analyze(*statement.m_rangeEnd, analyzerContext);
+    }
+
+    if (statement.m_condition)
+    {
+        Analyze(*statement.m_condition, analyzerContext);
+    }
+
+    statement.m_body->Accept(*this, context);
+
+    if (statement.m_increment)
+    {
+        Analyze(*statement.m_increment, analyzerContext);
+    }
+}
+
+void PurityAnalyzer::VisitReturnStatement(const ReturnStatement& statement, IStatementVisitorContext* context) const
+{
+    if (statement.m_returnValue)
+    {
+        Analyze(*statement.m_returnValue, GetPurityAnalyzerContext(*context));
+    }
+}
+
+void PurityAnalyzer::VisitUnaryExpression(const UnaryExpression& unaryExpression, IExpressionVisitorContext* context) const
+{
+    Analyze(*unaryExpression.m_expression, GetPurityAnalyzerContext(*context));
+}
+
+void PurityAnalyzer::VisitBinaryExpression(const BinaryExpression& binaryExpression, IExpressionVisitorContext* context) const
+{
+    PurityAnalyzerContext& analyzerContext = GetPurityAnalyzerContext(*context);
+
+    Analyze(*binaryExpression.m_left, analyzerContext);
+    Analyze(*binaryExpression.m_right, analyzerContext);
+}
+
+void PurityAnalyzer::VisitTernaryConditionalExpression(const TernaryConditionalExpression& ternaryConditionalExpression, IExpressionVisitorContext* context) const
+{
+    PurityAnalyzerContext& analyzerContext = GetPurityAnalyzerContext(*context);
+
+    Analyze(*ternaryConditionalExpression.m_condition, analyzerContext);
+    Analyze(*ternaryConditionalExpression.m_trueBranch, analyzerContext);
+    Analyze(*ternaryConditionalExpression.m_falseBranch, analyzerContext);
+}
+
+void PurityAnalyzer::VisitGroupingExpression(const GroupingExpression& groupingExpression, IExpressionVisitorContext* context) const
+{
+    Analyze(*groupingExpression.m_expression, GetPurityAnalyzerContext(*context));
+}
+
+void PurityAnalyzer::VisitVariableExpression(const VariableExpression& variableExpression, IExpressionVisitorContext* context) const
+{
+    PurityAnalyzerContext& analyzerContext = GetPurityAnalyzerContext(*context);
+
+    // captured and global variables may change between calls
+    if (!variableExpression.m_resolved.m_constant && !analyzerContext.IsOwnLocal(variableExpression.m_resolved))
+    {
+        analyzerContext.m_result.m_pure = false;
+    }
+}
+
+void PurityAnalyzer::VisitAssignmentExpression(const AssignmentExpression& assignmentExpression, IExpressionVisitorContext* context) const
+{
+    PurityAnalyzerContext& analyzerContext = GetPurityAnalyzerContext(*context);
+
+    Analyze(*assignmentExpression.m_expression, analyzerContext);
+    if (!analyzerContext.IsOwnLocal(assignmentExpression.m_resolved))
+    {
+        analyzerContext.m_result.m_pure = false;
+    }
+}
+
+void PurityAnalyzer::VisitLogicalExpression(const LogicalExpression& logicalExpression, IExpressionVisitorContext* context) const
+{
+    PurityAnalyzerContext& analyzerContext = GetPurityAnalyzerContext(*context);
+
+    Analyze(*logicalExpression.m_left, analyzerContext);
+    Analyze(*logicalExpression.m_right, analyzerContext);
+}
+
+void PurityAnalyzer::VisitCallExpression(const CallExpression& callExpression, IExpressionVisitorContext* context) const
+{
+    PurityAnalyzerContext& analyzerContext = GetPurityAnalyzerContext(*context);
+
+    const VariableExpression* callee = callExpression.m_calleeVariable;
+    if (callee && callee->m_resolved.m_distance == ResolvedName::Global)
+    {
+        analyzerContext.m_result.m_callees.push_back(callee);
+    }
+    else
+    {
+        analyzerContext.m_result.m_pure = false;
+    }
+
+    for (const IExpressionPtr& argument : callExpression.m_arguments)
+    {
+        Analyze(*argument, analyzerContext);
+    }
+}
+
+void PurityAnalyzer::VisitGetExpression(const GetExpression& getExpression, IExpressionVisitorContext* context) const
+{
+    // properties may change between calls and getters may have side effects
+    GetPurityAnalyzerContext(*context).m_result.m_pure = false;
+}
+
+void PurityAnalyzer::VisitSetExpression(const SetExpression& setExpression, IExpressionVisitorContext* context) const
+{
+    GetPurityAnalyzerContext(*context).m_result.m_pure = false;
+}
+
+void PurityAnalyzer::VisitLambdaExpression(const LambdaExpression& lambdaExpression, IExpressionVisitorContext* context) const
+{
+    GetPurityAnalyzerContext(*context).m_result.m_pure = false;
+}
+
+void PurityAnalyzer::VisitThisExpression(const ThisExpression& thisExpression, IExpressionVisitorContext* context) const
+{
+    GetPurityAnalyzerContext(*context).m_result.m_pure = false;
+}
+
+void PurityAnalyzer::VisitSuperExpression(const SuperExpression& superExpression, IExpressionVisitorContext* context) const
+{
+    GetPurityAnalyzerContext(*context).m_result.m_pure = false;
+}
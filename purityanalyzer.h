@@ -0,0 +1,57 @@
+#pragma once
+
+#include "statementvisitor.h"
+#include "expressionvisitor.h"
+#include <vector>
+#include <memory>
+
+struct IExpression;
+struct IStatement;
+using IStatementPtr = std::unique_ptr<const IStatement>;
+
+struct PurityAnalyzerContext;
+
+// checks whether a resolved function body depends only on its arguments and has no side effects.
+// a pure body reads only its parameters, its own locals and constants, assigns only its own locals,
+// doesn't print, doesn't touch instances, doesn't create functions or classes
+// and calls only globals, which have to be pure themselves when the call happens.
+class PurityAnalyzer : IExpressionVisitor, IStatementVisitor
+{
+public:
+    struct Result
+    {
+        bool m_pure = true;
+        std::vector<const VariableExpression*> m_callees; // global names called by the body, their purity is checked at runtime
+    };
+
+    Result Analyze(const FunctionDeclarationStatement& declaration) const;
+
+private:
+    void Analyze(const std::vector<IStatementPtr>& statements, PurityAnalyzerContext& context) const;
+    void Analyze(const IExpression& expression, PurityAnalyzerContext& context) const;
+
+    virtual void VisitExpressionStatement(const ExpressionStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitPrintStatement(const PrintStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitVariableDeclarationStatement(const VariableDeclarationStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitFunctionDeclarationStatement(const FunctionDeclarationStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitClassDeclarationStatement(const ClassDeclarationStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitBlockStatement(const BlockStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitIfStatement(const IfStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitWhileStatement(const WhileStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitForStatement(const ForStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitReturnStatement(const ReturnStatement& statement, IStatementVisitorContext* context) const override;
+
+    virtual void VisitUnaryExpression(const UnaryExpression& unaryExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitBinaryExpression(const BinaryExpression& binaryExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitTernaryConditionalExpression(const TernaryConditionalExpression& ternaryConditionalExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitGroupingExpression(const GroupingExpression& groupingExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitVariableExpression(const VariableExpression& variableExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitAssignmentExpression(const AssignmentExpression& assignmentExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitLogicalExpression(const LogicalExpression& logicalExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitCallExpression(const CallExpression& callExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitGetExpression(const GetExpression& getExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitSetExpression(const SetExpression& setExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitLambdaExpression(const LambdaExpression& lambdaExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitThisExpression(const ThisExpression& thisExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitSuperExpression(const SuperExpression& superExpression, IExpressionVisitorContext* context) const override;
+};
@@ -0,0 +1,33 @@
+#include "replsession.h"
+#include "scanner.h"
+#include "parser.h"
+#include "resolver.h"
+#include "typeinferrer.h"
+#include "escapeanalyzer.h"
+#include "statements.h"
+
+ReplSession::ReplSession(std::ostream& output)
+    : m_environment(Environment::CreateGlobalEnvironment(output))
+    , m_interpreter(m_environment, m_functionsRegistry)
+{}
+
+ReplSession::~ReplSession() = default;
+
+void ReplSession::Execute(std::string source)
+{
+    std::unique_ptr<Input> input = std::make_unique<Input>();
+    input->m_source = std::move(source);
+    input->m_scanner = std::make_unique<Scanner>(input->m_source);
+
+    // inputs are top-level code, so names declared by previous inputs are globals and only the new statements are resolved
+    Parser parser(input->m_scanner->Tokens());
+    input->m_program = parser.Parse(std::cout);
+    Resolver::Result resolution = Resolver().Resolve(input->m_program);
+    if (!resolution.m_hasErrors)
+    {
+        TypeInferrer().Infer(input->m_program);
+        EscapeAnalyzer().Analyze(input->m_program);
+        m_interpreter.Interpret(m_environment, m_functionsRegistry, input->m_program, std::cerr);
+        m_inputs.push_back(std::move(input));
+    }
+}
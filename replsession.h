@@ -0,0 +1,37 @@
+#pragma once
+
+#include "interpreter.h"
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Scanner;
+
+// state of an interactive session kept between inputs.
+// every input is scanned, parsed and resolved on its own and executed by the same interpreter,
+// its tokens and statements stay alive since functions and classes declared by it refer to them.
+class ReplSession
+{
+public:
+    explicit ReplSession(std::ostream& output = std::cout);
+    ~ReplSession();
+
+    ReplSession(const ReplSession&) = delete;
+    ReplSession& operator=(const ReplSession&) = delete;
+
+    void Execute(std::string source);
+
+private:
+    struct Input
+    {
+        std::string m_source;
+        std::unique_ptr<Scanner> m_scanner;
+        std::vector<IStatementPtr> m_program;
+    };
+
+    std::vector<std::unique_ptr<Input>> m_inputs; // declared first to outlive everything created from them
+    EnvironmentPtr m_environment;
+    FunctionsRegistry m_functionsRegistry;
+    Interpreter m_interpreter;
+};
@@ -4,6 +4,8 @@
 #include "token.h"
 #include "gekko.h"
 #include <assert.h>
+#include <algorithm>
+#include <unordered_map>
 
 enum class FunctionType
 {
@@ -19,22 +21,93 @@ enum class ClassType
     Subclass
 };
 
+// the members of a record class without a superclass are all known from its declaration
+static bool HasKnownLayout(const ClassDeclarationStatement* classDeclaration)
+{
+    return classDeclaration && !classDeclaration->m_fields.empty() && !classDeclaration->m_superClass;
+}
+
+static bool DeclaresField(const ClassDeclarationStatement& classDeclaration, uint32_t name)
+{
+    return std::any_of(classDeclaration.m_fields.begin(), classDeclaration.m_fields.end(), [name](const Token& field) { return field.Symbol() == name; });
+}
+
+static const FunctionDeclarationStatement* FindInstanceMethod(const ClassDeclarationStatement& classDeclaration, uint32_t name)
+{
+    auto method = std::find_if(classDeclaration.m_methods.begin(), classDeclaration.m_methods.end(), [name](const std::unique_ptr<FunctionDeclarationStatement>& method)
+        { return method->m_name.Symbol() == name && method->m_type != FunctionDeclarationStatement::FunctionDeclarationType::MemberStaticFunction; });
+    return method != classDeclaration.m_methods.end() ? method->get() : nullptr;
+}
+
+static bool DeclaresInstanceMethod(const ClassDeclarationStatement& classDeclaration, uint32_t name)
+{
+    return FindInstanceMethod(classDeclaration, name) != nullptr;
+}
+
+// finds statements that bind a name in the scope they are executed in
+struct DeclarationFinder : IStatementVisitor
+{
+    static bool Declares(const IStatement& statement)
+    {
+        bool declares = false;
+        DeclarationFinder finder(declares);
+        statement.Accept(finder, nullptr);
+        return declares;
+    }
+
+    explicit DeclarationFinder(bool& declares) : m_declares(declares) {}
+
+    virtual void VisitVariableDeclarationStatement(const VariableDeclarationStatement& statement, IStatementVisitorContext* context) const override { m_declares = true; }
+    virtual void VisitFunctionDeclarationStatement(const FunctionDeclarationStatement& statement, IStatementVisitorContext* context) const override { m_declares = true; }
+    virtual void VisitClassDeclarationStatement(const ClassDeclarationStatement& statement, IStatementVisitorContext* context) const override { m_declares = true; }
+
+    bool& m_declares;
+};
+
 struct ResolverContext : IStatementVisitorContext, IExpressionVisitorContext
 {
-    ResolverContext(std::map<const IExpression*, size_t>& locals, bool& hasErrors)
-        : m_locals(locals)
-        , m_hasErrors(hasErrors)
+    explicit ResolverContext(bool& hasErrors)
+        : m_hasErrors(hasErrors)
     {}
     
-    enum class State
+    enum class State : uint8_t
     {
         Declared,
         Defined
     };
 
+    // innermost binding of a name, scopes are numbered from 1 and 0 means the name is global
+    struct Binding
+    {
+        uint32_t m_scope = 0;
+        State m_state = State::Declared;
+        bool m_used = false;
+        const Token* m_declaration = nullptr; // implicit names like 'this' and 'super' have no declaration
+        uint32_t m_declarationInfo = NoDeclarationInfo;
+    };
+
+    static constexpr uint32_t NoDeclarationInfo = ~0u;
+
+    // what is known about a declared name, uses are marked final once no assignment can follow
+    struct DeclarationInfo
+    {
+        uint32_t m_declarationsCount = 0;
+        bool m_assigned = false;
+        const Value* m_constant = nullptr;
+        std::vector<ResolvedName*> m_uses;
+    };
+
+    // binding shadowed by a name bound in the current scope, restored when the scope ends
+    struct Shadowed
+    {
+        uint32_t m_symbol;
+        Binding m_binding;
+    };
+
     void BeginScope()
     {
-        m_scopes.emplace_back();
+        m_scopeBegins.push_back(m_undoLog.size());
+        m_localsBegins.push_back(m_locals.size());
     }
 
     void EndScope()
@@ -42,86 +115,198 @@ struct ResolverContext : IStatementVisitorContext, IExpressionVisitorContext
         m_breakEncountered = nullptr;
         m_returnEncountered = nullptr;
 
-        for (auto it = m_scopes.back().m_unusedVariables.begin(); it != m_scopes.back().m_unusedVariables.end(); ++it)
+        std::vector<const Token*> unusedVariables;
+        for (size_t i = m_undoLog.size(); i-- > m_scopeBegins.back();)
         {
-            Gekko::ReportError(*it->second, "Unused variable.");
+            Binding& binding = m_bindings[m_undoLog[i].m_symbol];
+            if (!binding.m_used)
+            {
+                unusedVariables.push_back(binding.m_declaration);
+            }
+            binding = m_undoLog[i].m_binding;
         }
+        m_undoLog.resize(m_scopeBegins.back());
+        m_scopeBegins.pop_back();
 
-        m_scopes.pop_back();
+        for (size_t i = m_localsBegins.back(); i < m_locals.size(); ++i)
+        {
+            MarkFinalUses(m_locals[i]);
+        }
+        m_locals.resize(m_localsBegins.back());
+        m_localsBegins.pop_back();
+
+        std::sort(unusedVariables.begin(), unusedVariables.end(), [](const Token* lhs, const Token* rhs) { return lhs->m_lexeme < rhs->m_lexeme; });
+        for (const Token* variable : unusedVariables)
+        {
+            Gekko::ReportError(*variable, "Unused variable.");
+        }
+    }
+
+    static void MarkFinalUses(const DeclarationInfo& info)
+    {
+        if (!info.m_assigned)
+        {
+            for (ResolvedName* use : info.m_uses)
+            {
+                use->m_final = true;
+                use->m_constant = info.m_constant;
+            }
+        }
+    }
+
+    // globals of other programms sharing the environment aren't seen, so they are never final
+    void MarkFinalGlobals()
+    {
+        for (const auto& [symbol, info] : m_globals)
+        {
+            if (info.m_declarationsCount == 1)
+            {
+                MarkFinalUses(info);
+            }
+        }
+    }
+
+    DeclarationInfo* GetDeclarationInfo(const Binding& binding)
+    {
+        return binding.m_declarationInfo != NoDeclarationInfo ? &m_locals[binding.m_declarationInfo] : nullptr;
+    }
+
+    uint32_t CurrentScope() const
+    {
+        return static_cast<uint32_t>(m_scopeBegins.size());
+    }
+
+    Binding& GetBinding(uint32_t symbol)
+    {
+        if (symbol >= m_bindings.size())
+        {
+            m_bindings.resize(SymbolTable::Size());
+        }
+        return m_bindings[symbol];
+    }
+
+    // binding of the name in the current scope, the outer one is saved to be restored by EndScope
+    Binding& Bind(uint32_t symbol)
+    {
+        Binding& binding = GetBinding(symbol);
+        if (binding.m_scope != CurrentScope())
+        {
+            m_undoLog.push_back({ symbol, binding });
+            binding = Binding();
+            binding.m_scope = CurrentScope();
+        }
+        return binding;
     }
 
     void Declare(const Token& name)
     {
-        if (!m_scopes.empty())
+        if (CurrentScope() > 0)
         {
-            Scope& scope = m_scopes.back();
-            if (scope.m_variables.contains(name.m_lexeme))
+            if (GetBinding(name.Symbol()).m_scope == CurrentScope())
             {
                 Gekko::ReportError(name, "Already a variable with this name in this scope.");
             }
-            scope.m_variables[name.m_lexeme] = State::Declared;
-            scope.m_unusedVariables[name.m_lexeme] = &name;
+
+            Binding& binding = Bind(name.Symbol());
+            binding.m_state = State::Declared;
+            binding.m_declaration = &name;
+            binding.m_used = false;
+            binding.m_declarationInfo = static_cast<uint32_t>(m_locals.size());
+            m_locals.emplace_back();
+        }
+        else
+        {
+            ++m_globals[name.Symbol()].m_declarationsCount;
+        }
+    }
+
+    // the value of the variable declared in the current scope is known while it isn't assigned
+    void SetConstant(const Token& name, const Value& value)
+    {
+        if (DeclarationInfo* info = CurrentScope() > 0 ? GetDeclarationInfo(GetBinding(name.Symbol())) : nullptr)
+        {
+            info->m_constant = &value;
         }
     }
 
     void Define(const Token& name)
     {
-        Define(name.m_lexeme);
+        Define(name.Symbol());
     }
 
-    void Define(std::string_view name)
+    void Define(uint32_t symbol)
     {
-        if (!m_scopes.empty())
+        if (CurrentScope() > 0)
         {
-            m_scopes.back().m_variables[name] = State::Defined;
+            Binding& binding = Bind(symbol);
+            binding.m_state = State::Defined;
+            binding.m_used |= binding.m_declaration == nullptr;
         }
     }
 
-    void ResolveLocal(const IExpression& expression, const Token& name)
+    void ResolveLocal(const Token& name, ResolvedName& resolved, bool isAssignment = false)
     {
-        for (size_t i = m_scopes.size(); i-- > 0;)
+        resolved.m_final = false;
+        resolved.m_constant = nullptr;
+
+        DeclarationInfo* info = nullptr;
+        Binding& binding = GetBinding(name.Symbol());
+        if (binding.m_scope > 0)
         {
-            if (m_scopes[i].m_variables.contains(name.m_lexeme))
-            {
-                m_locals[&expression] = m_scopes.size() - i - 1;
+            resolved.m_distance = CurrentScope() - binding.m_scope;
+            resolved.m_declaration = binding.m_declaration;
+            binding.m_used = true;
+            info = GetDeclarationInfo(binding);
+        }
+        else
+        {
+            resolved.m_distance = ResolvedName::Global;
+            resolved.m_declaration = nullptr;
+            info = &m_globals[name.Symbol()];
+        }
 
-                if (m_scopes[i].m_unusedVariables.contains(name.m_lexeme))
-                {
-                    m_scopes[i].m_unusedVariables.erase(name.m_lexeme);
-                }
-                return;
-            }
+        if (info && isAssignment)
+        {
+            info->m_assigned = true;
+        }
+        else if (info)
+        {
+            info->m_uses.push_back(&resolved);
         }
     }
 
-    void OwnInitializerCheck(const Token& name) const
+    // for variables changed by the interpreter itself, like counters of counted loops
+    void MarkAssigned(const Token& name)
     {
-        if (!m_scopes.empty())
+        Binding& binding = GetBinding(name.Symbol());
+        if (DeclarationInfo* info = binding.m_scope > 0 ? GetDeclarationInfo(binding) : &m_globals[name.Symbol()])
         {
-            const Scope& localScope = m_scopes.back();            
-            auto it = localScope.m_variables.find(name.m_lexeme);
-            if (it != localScope.m_variables.end())
-            {
-                if (it->second == State::Declared)
-                {
-                    Gekko::ReportError(name, "Can't read local variable in its own initializer.");
-                }
-            }
+            info->m_assigned = true;
         }
     }
 
-    struct Scope
+    void OwnInitializerCheck(const Token& name)
     {
-        std::map<std::string_view, State> m_variables;
-        std::map<std::string_view, const Token*> m_unusedVariables;
-    };
-
-    std::vector<Scope> m_scopes;
+        if (CurrentScope() > 0)
+        {
+            const Binding& binding = GetBinding(name.Symbol());
+            if (binding.m_scope == CurrentScope() && binding.m_state == State::Declared)
+            {
+                Gekko::ReportError(name, "Can't read local variable in its own initializer.");
+            }
+        }
+    }
 
-    std::map<const IExpression*, size_t>& m_locals;
+    std::vector<Binding> m_bindings; // indexed by SymbolTable ids
+    std::vector<Shadowed> m_undoLog;
+    std::vector<size_t> m_scopeBegins; // undo log size at the beginning of every scope
+    std::vector<DeclarationInfo> m_locals; // indexed by Binding::m_declarationInfo
+    std::vector<size_t> m_localsBegins;
+    std::unordered_map<uint32_t, DeclarationInfo> m_globals; // keyed by SymbolTable ids
 
     FunctionType m_functionType = FunctionType::None;
     ClassType m_classType = ClassType::None;
+    const ClassDeclarationStatement* m_class = nullptr; // innermost class whose methods are resolved
     bool m_isInsideStaticMethod = false;
     bool m_isInsideCycle = false;
     const Token* m_breakEncountered = nullptr;
@@ -143,8 +328,48 @@ Resolver::Result Resolver::Resolve(const std::vector<IStatementPtr>& statements)
 {
     Resolver::Result result;
 
-    ResolverContext context(result.m_locals, result.m_hasErrors);
+    ResolverContext context(result.m_hasErrors);
     Resolve(statements, context);
+    context.MarkFinalGlobals();
+
+    return result;
+}
+
+Resolver::Result Resolver::ResolveDeferredBody(const FunctionDeclarationStatement& declaration) const
+{
+    Resolver::Result result;
+
+    ResolverContext context(result.m_hasErrors);
+
+    // deferred bodies are top-level, so only the scopes of the owning class enclose them
+    FunctionType functionType = FunctionType::Function;
+    const ClassDeclarationStatement* owner = declaration.m_deferredBody->m_owner;
+    if (owner)
+    {
+        context.m_classType = owner->m_superClass ? ClassType::Subclass : ClassType::Class;
+        context.m_class = owner;
+        if (owner->m_superClass)
+        {
+            context.BeginScope();
+            context.Define(SymbolTable::Super);
+        }
+
+        context.BeginScope();
+        context.Define(SymbolTable::This);
+
+        if (declaration.m_name.Symbol() == owner->m_name.Symbol())
+        {
+            functionType = FunctionType::Constructor;
+        }
+        context.m_isInsideStaticMethod = declaration.m_type == FunctionDeclarationStatement::FunctionDeclarationType::MemberStaticFunction;
+    }
+
+    ResolveFunction(declaration.m_parameters, declaration.m_body, context, functionType);
+
+    while (context.CurrentScope() > 0)
+    {
+        context.EndScope();
+    }
 
     return result;
 }
@@ -215,6 +440,10 @@ void Resolver::VisitVariableDeclarationStatement(const VariableDeclarationStatem
     if (statement.m_initializer)
     {
         Resolve(*statement.m_initializer, resolverContext);
+        if (const LiteralExpression* literal = dynamic_cast<const LiteralExpression*>(statement.m_initializer.get()))
+        {
+            resolverContext.SetConstant(statement.m_name, literal->m_value);
+        }
     }
     resolverContext.Define(statement.m_name);
 }
@@ -226,7 +455,10 @@ void Resolver::VisitFunctionDeclarationStatement(const FunctionDeclarationStatem
     resolverContext.Declare(statement.m_name);
     resolverContext.Define(statement.m_name);
     
-    ResolveFunction(statement.m_parameters, statement.m_body, resolverContext, FunctionType::Function);
+    if (!statement.m_deferredBody)
+    {
+        ResolveFunction(statement.m_parameters, statement.m_body, resolverContext, FunctionType::Function);
+    }
 }
 
 void Resolver::VisitClassDeclarationStatement(const ClassDeclarationStatement& statement, IStatementVisitorContext* context) const
@@ -235,15 +467,32 @@ void Resolver::VisitClassDeclarationStatement(const ClassDeclarationStatement& s
 
     ClassType oldClassType = resolverContext.m_classType;
     resolverContext.m_classType = ClassType::Class;
+    const ClassDeclarationStatement* oldClass = resolverContext.m_class;
+    resolverContext.m_class = &statement;
 
     resolverContext.Declare(statement.m_name);
     resolverContext.Define(statement.m_name);
 
+    for (auto field = statement.m_fields.begin(); field != statement.m_fields.end(); ++field)
+    {
+        const uint32_t name = field->get().Symbol();
+        if (std::any_of(statement.m_fields.begin(), field, [name](const Token& previous) { return previous.Symbol() == name; }))
+        {
+            resolverContext.m_hasErrors = true;
+            Gekko::ReportError(*field, "Field '" + std::string(field->get().m_lexeme) + "' is already declared in this class.");
+        }
+        else if (DeclaresInstanceMethod(statement, name))
+        {
+            resolverContext.m_hasErrors = true;
+            Gekko::ReportError(*field, "Field '" + std::string(field->get().m_lexeme) + "' has the same name as a method.");
+        }
+    }
+
     if (statement.m_superClass)
     {
         resolverContext.m_classType = ClassType::Subclass;
 
-        if (statement.m_name.m_lexeme == statement.m_superClass->m_name.m_lexeme)
+        if (statement.m_name.Symbol() == statement.m_superClass->m_name.Symbol())
         {
             resolverContext.m_hasErrors = true;
             Gekko::ReportError(statement.m_superClass->m_name, "A class can't inherit from itself.");
@@ -251,15 +500,26 @@ void Resolver::VisitClassDeclarationStatement(const ClassDeclarationStatement& s
         Resolve(*statement.m_superClass, resolverContext);
 
         resolverContext.BeginScope();
-        resolverContext.Define(TokenTypeToStringView(Token::Type::Super));    
+        resolverContext.Define(SymbolTable::Super);    
     }
 
     resolverContext.BeginScope();
-    resolverContext.Define(TokenTypeToStringView(Token::Type::This));
+    resolverContext.Define(SymbolTable::This);
 
     for(const std::unique_ptr<FunctionDeclarationStatement>& methodDeclaration : statement.m_methods)
     {
-        FunctionType functionType = methodDeclaration->m_name.m_lexeme == statement.m_name.m_lexeme ? FunctionType::Constructor : FunctionType::Function;
+        if (methodDeclaration->m_final && methodDeclaration->m_type != FunctionDeclarationStatement::FunctionDeclarationType::MemberFunction)
+        {
+            resolverContext.m_hasErrors = true;
+            Gekko::ReportError(methodDeclaration->m_name, "Only instance methods can be final.");
+        }
+
+        if (methodDeclaration->m_deferredBody)
+        {
+            continue;
+        }
+
+        FunctionType functionType = methodDeclaration->m_name.Symbol() == statement.m_name.Symbol() ? FunctionType::Constructor : FunctionType::Function;
         resolverContext.m_isInsideStaticMethod = methodDeclaration->m_type == FunctionDeclarationStatement::FunctionDeclarationType::MemberStaticFunction;
         ResolveFunction(methodDeclaration->m_parameters, methodDeclaration->m_body, resolverContext, functionType);
         resolverContext.m_isInsideStaticMethod = false;
@@ -273,15 +533,35 @@ void Resolver::VisitClassDeclarationStatement(const ClassDeclarationStatement& s
     resolverContext.EndScope();
 
     resolverContext.m_classType = oldClassType;
+    resolverContext.m_class = oldClass;
 }
 
 void Resolver::VisitBlockStatement(const BlockStatement& statement, IStatementVisitorContext* context) const
 {
     ResolverContext& resolverContext = GetResolverContext(*context); 
 
-    resolverContext.BeginScope();
+    // blocks without declarations are executed in the enclosing environment
+    statement.m_hasScope = false;
+    for (const IStatementPtr& blockStatement : statement.m_block)
+    {
+        if (blockStatement && DeclarationFinder::Declares(*blockStatement))
+        {
+            statement.m_hasScope = true;
+            break;
+        }
+    }
+
+    if (statement.m_hasScope)
+    {
+        resolverContext.BeginScope();
+    }
+
     Resolve(statement.m_block, resolverContext);
-    resolverContext.EndScope();
+
+    if (statement.m_hasScope)
+    {
+        resolverContext.EndScope();
+    }
 }
 
 void Resolver::VisitIfStatement(const IfStatement& statement, IStatementVisitorContext* context) const
@@ -317,6 +597,57 @@ void Resolver::VisitWhileStatement(const WhileStatement& statement, IStatementVi
     resolverContext.m_isInsideCycle = oldIsInsideCycle;
 }
 
+void Resolver::VisitForStatement(const ForStatement& statement, IStatementVisitorContext* context) const
+{
+    ResolverContext& resolverContext = GetResolverContext(*context);
+
+    statement.m_hasScope = statement.m_initializer && DeclarationFinder::Declares(*statement.m_initializer);
+    if (statement.m_hasScope)
+    {
+        resolverContext.BeginScope();
+    }
+
+    if (statement.m_initializer)
+    {
+        Resolve(statement.m_initializer, resolverContext);
+    }
+
+    if (statement.m_counter)
+    {
+        resolverContext.MarkAssigned(*statement.m_counter);
+    }
+
+    if (statement.m_rangeEnd)
+    {
+        Resolve(*statement.m_rangeEnd, resolverContext);
+    }
+
+    if (statement.m_condition)
+    {
+        Resolve(*statement.m_condition, resolverContext);
+    }
+
+    const bool oldIsInsideCycle = resolverContext.m_isInsideCycle;
+    resolverContext.m_isInsideCycle = true;
+
+    Resolve(statement.m_body, resolverContext);
+
+    resolverContext.m_isInsideCycle = oldIsInsideCycle;
+
+    if (statement.m_increment)
+    {
+        Resolve(*statement.m_increment, resolverContext);
+    }
+    
+    resolverContext.m_breakEncountered = nullptr;
+    resolverContext.m_returnEncountered = nullptr;
+
+    if (statement.m_hasScope)
+    {
+        resolverContext.EndScope();
+    }
+}
+
 void Resolver::VisitBreakStatement(const BreakStatement& statement, IStatementVisitorContext* context) const
 {
     ResolverContext& resolverContext = GetResolverContext(*context);
@@ -391,14 +722,14 @@ void Resolver::VisitVariableExpression(const VariableExpression& variableExpress
 {
     ResolverContext& resolverContext = GetResolverContext(*context);
     resolverContext.OwnInitializerCheck(variableExpression.m_name);
-    resolverContext.ResolveLocal(variableExpression, variableExpression.m_name);
+    resolverContext.ResolveLocal(variableExpression.m_name, variableExpression.m_resolved);
 }
 
 void Resolver::VisitAssignmentExpression(const AssignmentExpression& assignmentExpression, IExpressionVisitorContext* context) const
 {
     ResolverContext& resolverContext = GetResolverContext(*context);
     Resolve(*assignmentExpression.m_expression, resolverContext);
-    resolverContext.ResolveLocal(assignmentExpression, assignmentExpression.m_name);
+    resolverContext.ResolveLocal(assignmentExpression.m_name, assignmentExpression.m_resolved, true);
 }
 
 void Resolver::VisitLogicalExpression(const LogicalExpression& logicalExpression, IExpressionVisitorContext* context) const
@@ -414,6 +745,18 @@ void Resolver::VisitCallExpression(const CallExpression& callExpression, IExpres
     ResolverContext& resolverContext = GetResolverContext(*context);
 
     Resolve(*callExpression.m_calle, resolverContext);
+    callExpression.m_calleeVariable = dynamic_cast<const VariableExpression*>(callExpression.m_calle.get());
+    callExpression.m_calleeProperty = dynamic_cast<const GetExpression*>(callExpression.m_calle.get());
+    callExpression.m_calleeSuper = dynamic_cast<const SuperExpression*>(callExpression.m_calle.get());
+
+    // subclasses can't override a final method, so 'this' calls a final method of the enclosing class
+    const GetExpression* property = callExpression.m_calleeProperty;
+    if (property && dynamic_cast<const ThisExpression*>(property->m_owner.get()) && resolverContext.m_class)
+    {
+        const FunctionDeclarationStatement* method = FindInstanceMethod(*resolverContext.m_class, property->m_name.Symbol());
+        property->m_finalMethod = method && method->m_type == FunctionDeclarationStatement::FunctionDeclarationType::MemberFunction
+            && (method->m_final || resolverContext.m_class->m_final) && !DeclaresField(*resolverContext.m_class, property->m_name.Symbol());
+    }
 
     for (const IExpressionPtr& argument : callExpression.m_arguments)
     {
@@ -426,6 +769,14 @@ void Resolver::VisitGetExpression(const GetExpression& getExpression, IExpressio
     ResolverContext& resolverContext = GetResolverContext(*context);
 
     Resolve(*getExpression.m_owner, resolverContext);
+
+    const uint32_t name = getExpression.m_name.Symbol();
+    if (dynamic_cast<const ThisExpression*>(getExpression.m_owner.get()) && HasKnownLayout(resolverContext.m_class)
+        && !DeclaresField(*resolverContext.m_class, name) && !DeclaresInstanceMethod(*resolverContext.m_class, name))
+    {
+        resolverContext.m_hasErrors = true;
+        Gekko::ReportError(getExpression.m_name, "Undefined property '" + std::string(getExpression.m_name.m_lexeme) + "' of record class '" + std::string(resolverContext.m_class->m_name.m_lexeme) + "'.");
+    }
 }
 
 void Resolver::VisitSetExpression(const SetExpression& setExpression, IExpressionVisitorContext* context) const
@@ -434,6 +785,12 @@ void Resolver::VisitSetExpression(const SetExpression& setExpression, IExpressio
 
     Resolve(setExpression.m_owner, resolverContext);
     Resolve(*setExpression.m_value, resolverContext);
+
+    if (dynamic_cast<const ThisExpression*>(&setExpression.m_owner) && HasKnownLayout(resolverContext.m_class) && !DeclaresField(*resolverContext.m_class, setExpression.m_name.Symbol()))
+    {
+        resolverContext.m_hasErrors = true;
+        Gekko::ReportError(setExpression.m_name, "Undefined field '" + std::string(setExpression.m_name.m_lexeme) + "' of record class '" + std::string(resolverContext.m_class->m_name.m_lexeme) + "'.");
+    }
 }
 
 void Resolver::VisitLambdaExpression(const LambdaExpression& lambdaExpression, IExpressionVisitorContext* context) const
@@ -455,7 +812,7 @@ void Resolver::VisitThisExpression(const ThisExpression& thisExpression, IExpres
 
     if (resolverContext.m_classType == ClassType::Class || resolverContext.m_classType == ClassType::Subclass)
     {
-        resolverContext.ResolveLocal(thisExpression, thisExpression.m_keyword);
+        resolverContext.ResolveLocal(thisExpression.m_keyword, thisExpression.m_resolved);
     }
     else
     {
@@ -480,6 +837,6 @@ void Resolver::VisitSuperExpression(const SuperExpression& superExpression, IExp
     }
     else
     {
-        resolverContext.ResolveLocal(superExpression, superExpression.m_keyword);
+        resolverContext.ResolveLocal(superExpression.m_keyword, superExpression.m_resolved);
     }
 }
\ No newline at end of file
@@ -14,17 +14,20 @@ using IExpressiontPtr = std::unique_ptr<const IExpression>;
 
 struct ResolverContext;
 struct Token;
+struct FunctionDeclarationStatement;
 
 class Resolver : IExpressionVisitor, IStatementVisitor
 {
 public:
+    // names are resolved in place, see ResolvedName
     struct Result
     {
         bool m_hasErrors = false;
-        std::map<const IExpression*, size_t> m_locals; // resolved local names with distances to their declaration scope 
     };
 
     Result Resolve(const std::vector<IStatementPtr>& statements) const;
+    // resolves a body left by the parser for the first call, after it was parsed into the declaration
+    Result ResolveDeferredBody(const FunctionDeclarationStatement& declaration) const;
 private:
 
     void Resolve(const IStatementPtr& statement, ResolverContext& context) const;
@@ -43,6 +46,7 @@ private:
     virtual void VisitBlockStatement(const BlockStatement& statement, IStatementVisitorContext* context) const override;
     virtual void VisitIfStatement(const IfStatement& statement, IStatementVisitorContext* context) const override;
     virtual void VisitWhileStatement(const WhileStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitForStatement(const ForStatement& statement, IStatementVisitorContext* context) const override;
     virtual void VisitBreakStatement(const BreakStatement& statement, IStatementVisitorContext* context) const override;
     virtual void VisitReturnStatement(const ReturnStatement& statement, IStatementVisitorContext* context) const override;
 
@@ -0,0 +1,166 @@
+#include "runtime.h"
+#include "class.h"
+#include "function.h"
+#include "scanner.h"
+#include "typeinferrer.h"
+#include "escapeanalyzer.h"
+#include "statements.h"
+#include "token.h"
+#include <sstream>
+
+Runtime::Runtime(std::ostream& outputStream)
+    : m_environment(Environment::CreateGlobalEnvironment(outputStream))
+    , m_interpreter(m_environment, m_functionsRegistry)
+    , m_outputStream(outputStream)
+{}
+
+Runtime::~Runtime() = default;
+
+int Runtime::Execute(void (*programm)(), std::ostream& errorsLog)
+{
+    try
+    {
+        programm();
+    }
+    catch (const Interpreter::InterpreterError& ie)
+    {
+        errorsLog << "[line " << ie.m_operator.m_line << "]: " << ie.m_message << "\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+// the programm is processed as 'gekko compile' did, so the statements are the ones the transpiler saw
+void Runtime::Load(std::string source)
+{
+    m_source = std::move(source);
+    m_units = Frontend().Process({ m_source }, std::cerr);
+    if (!m_units.front().m_resolution.m_hasErrors)
+    {
+        TypeInferrer().Infer(m_units.front().m_program);
+        EscapeAnalyzer().Analyze(m_units.front().m_program);
+    }
+}
+
+void Runtime::Run(size_t statement)
+{
+    m_interpreter.Execute(*m_units.front().m_program[statement], m_environment, m_functionsRegistry);
+}
+
+void Runtime::Import(Global& global, std::string_view name)
+{
+    global.m_symbol = SymbolTable::Intern(name);
+    global.m_value = m_environment->FindLocal(global.m_symbol);
+}
+
+void Runtime::Define(Global& global, Value value)
+{
+    if (!global.m_value)
+    {
+        m_environment->Define(global.m_symbol, value);
+        global.m_value = m_environment->FindLocal(global.m_symbol);
+        return;
+    }
+
+    *global.m_value = std::move(value);
+}
+
+const Value& Runtime::Get(Global& global, const Token& name)
+{
+    CheckDefined(global, name);
+    return *global.m_value;
+}
+
+Value Runtime::Assign(Global& global, Value value, const Token& name)
+{
+    CheckDefined(global, name);
+    *global.m_value = value;
+    return value;
+}
+
+// the interpreter may have defined the global since the last lookup
+void Runtime::CheckDefined(Global& global, const Token& name)
+{
+    if (!global.m_value)
+    {
+        global.m_value = m_environment->FindLocal(global.m_symbol);
+    }
+
+    if (!global.m_value)
+    {
+        throw Interpreter::InterpreterError(name, "Undefined variable '" + std::string(name.m_lexeme) + "'.");
+    }
+}
+
+double Runtime::Number(const Token& op, const Value& value)
+{
+    return Interpreter::GetNumberOperand(op, value);
+}
+
+void Runtime::Print(const Value& value)
+{
+    m_outputStream << value.ToString() << std::endl;
+}
+
+Value Runtime::Unary(const Token& op, const Value& operand)
+{
+    return Interpreter::ApplyUnaryOperator(op, operand);
+}
+
+Value Runtime::Binary(const Token& op, const Operands& operands)
+{
+    const double* lhs = operands.m_left.GetNumber();
+    const double* rhs = operands.m_right.GetNumber();
+    if (lhs && rhs)
+    {
+        switch (op.m_type)
+        {
+        case Token::Type::Star:         return Value(*lhs * *rhs);
+        case Token::Type::Minus:        return Value(*lhs - *rhs);
+        case Token::Type::Plus:         return Value(*lhs + *rhs);
+        case Token::Type::Less:         return Value(*lhs < *rhs);
+        case Token::Type::LessEqual:    return Value(*lhs <= *rhs);
+        case Token::Type::Greater:      return Value(*lhs > *rhs);
+        case Token::Type::GreaterEqual: return Value(*lhs >= *rhs);
+        default: break;
+        }
+    }
+
+    return Interpreter::ApplyBinaryOperator(op, operands.m_left, operands.m_right, m_functionsRegistry);
+}
+
+Value Runtime::Call(const Token& token, const Invocation& invocation)
+{
+    // classes are declared by statements run by the interpreter, the constructor is called as the interpreter does
+    if (const std::shared_ptr<const Class>* classDefinition = invocation.m_callee.GetClass())
+    {
+        std::shared_ptr<ClassInstance> instance = (*classDefinition)->CreateInstance();
+        if (const Function* constructor = (*classDefinition)->GetConstructor())
+        {
+            if (static_cast<size_t>(constructor->Arity()) != invocation.m_arguments.size())
+            {
+                throw Interpreter::InterpreterError(token, "Class constructor doesn't match the passed arguments count");
+            }
+
+            constructor->CallMethod(m_interpreter, instance, m_functionsRegistry, invocation.m_arguments);
+        }
+
+        return Value(instance);
+    }
+
+    const ICallable* const* callable = invocation.m_callee.GetCallable();
+    if (!callable)
+    {
+        throw Interpreter::InterpreterError(token, "Can only call functions and classes.");
+    }
+
+    if (static_cast<size_t>((*callable)->Arity()) != invocation.m_arguments.size())
+    {
+        std::stringstream message;
+        message << "Expected " << (*callable)->Arity() << " arguments, but got " << invocation.m_arguments.size() << '.';
+        throw Interpreter::InterpreterError(token, message.str());
+    }
+
+    return (*callable)->Call(m_interpreter, m_environment, m_functionsRegistry, invocation.m_arguments);
+}
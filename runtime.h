@@ -0,0 +1,106 @@
+#pragma once
+
+#include "interpreter.h"
+#include "callable.h"
+#include "frontend.h"
+#include "value.h"
+#include <array>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct Token;
+
+// support library of the C++ programms produced by Transpiler, linked into the compiled executables.
+// values, operators and errors behave as in Interpreter, natives are the ones the interpreter registers.
+class Runtime
+{
+public:
+    // global variable of the interpreter's global environment, so statements run by the interpreter share it.
+    // undefined until its declaration is executed, the storage is looked up until then
+    struct Global
+    {
+        uint32_t m_symbol = 0;
+        Value* m_value = nullptr;
+    };
+
+    // braced initialization evaluates the operands left to right
+    struct Operands
+    {
+        Value m_left;
+        Value m_right;
+    };
+
+    struct Invocation
+    {
+        Value m_callee;
+        std::vector<Value> m_arguments;
+    };
+
+    template<size_t N>
+    using Arguments = std::array<Value, N>;
+
+    // top-level function translated to a C++ function, the body is a thunk unpacking the arguments
+    class CompiledFunction : public ICallable
+    {
+    public:
+        using Body = Value(*)(const std::vector<Value>& arguments);
+
+        CompiledFunction(std::string_view name, int arity, Body body)
+            : m_name(name)
+            , m_arity(arity)
+            , m_body(body)
+        {}
+
+        virtual Value Call(const Interpreter& interpreter, EnvironmentPtr globals, FunctionsRegistry& functionsRegistry, const std::vector<Value>& arguments) const override
+        {
+            return m_body(arguments);
+        }
+
+        virtual int Arity() const override { return m_arity; }
+        virtual std::string ToString() const override { return "<fn " + std::string(m_name) + ">"; }
+
+    private:
+        std::string_view m_name;
+        int m_arity;
+        Body m_body;
+    };
+
+    explicit Runtime(std::ostream& outputStream = std::cout);
+    ~Runtime();
+
+    Runtime(const Runtime&) = delete;
+    Runtime& operator=(const Runtime&) = delete;
+
+    // runs the translated programm, runtime errors are reported as the interpreter does
+    int Execute(void (*programm)(), std::ostream& errorsLog);
+    // prepares the source of the programm for Run, required when Transpiler couldn't translate some statements
+    void Load(std::string source);
+    // runs a top-level statement of the loaded programm with the interpreter
+    void Run(size_t statement);
+
+    // binds the global to the variable of the same name, natives are defined already
+    void Import(Global& global, std::string_view name);
+
+    void Define(Global& global, Value value);
+    const Value& Get(Global& global, const Token& name);
+    Value Assign(Global& global, Value value, const Token& name);
+    void CheckDefined(Global& global, const Token& name);
+
+    // bounds of range loops
+    static double Number(const Token& op, const Value& value);
+
+    void Print(const Value& value);
+    static Value Unary(const Token& op, const Value& operand);
+    Value Binary(const Token& op, const Operands& operands);
+    Value Call(const Token& token, const Invocation& invocation);
+
+private:
+    std::string m_source; // declared first to outlive everything created from it
+    std::vector<Frontend::Unit> m_units;
+    EnvironmentPtr m_environment;
+    FunctionsRegistry m_functionsRegistry;
+    Interpreter m_interpreter;
+    std::ostream& m_outputStream;
+};
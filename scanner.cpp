@@ -1,22 +1,242 @@
 #include "scanner.h"
+#include <array>
+#include <algorithm>
+#include <bit>
 #include <charconv>
+#include <cstdint>
+#include <cstring>
 #include "gekko.h"
 
-Scanner::Scanner(std::string_view source)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCANNER_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define SCANNER_USE_AVX2
+#include <immintrin.h>
+#endif
+
+enum CharacterClass : uint8_t
+{
+    DigitCharacter = 1 << 0,
+    AlphaCharacter = 1 << 1,
+    WhitespaceCharacter = 1 << 2
+};
+
+static constexpr std::array<uint8_t, 256> CharacterClasses = []()
+{
+    std::array<uint8_t, 256> classes{};
+    for (int c = '0'; c <= '9'; ++c) classes[c] |= DigitCharacter;
+    for (int c = 'a'; c <= 'z'; ++c) classes[c] |= AlphaCharacter;
+    for (int c = 'A'; c <= 'Z'; ++c) classes[c] |= AlphaCharacter;
+    classes['_'] |= AlphaCharacter;
+    classes[' '] |= WhitespaceCharacter;
+    classes['\t'] |= WhitespaceCharacter;
+    classes['\r'] |= WhitespaceCharacter;
+    classes['\n'] |= WhitespaceCharacter;
+    return classes;
+}();
+
+static bool HasClass(char c, uint8_t characterClass)
+{
+    return (CharacterClasses[static_cast<unsigned char>(c)] & characterClass) != 0;
+}
+
+struct Keyword
+{
+    std::string_view m_name;
+    Token::Type m_type;
+};
+
+static constexpr Keyword Keywords[] = 
+{
+    {"return", Token::Type::Return},
+    {"nil", Token::Type::Nil},
+    {"false", Token::Type::False},
+    {"true", Token::Type::True},
+    {"and", Token::Type::And},
+    {"or", Token::Type::Or},
+    {"if", Token::Type::If},
+    {"else", Token::Type::Else},
+    {"while", Token::Type::While},
+    {"for", Token::Type::For},
+    {"break", Token::Type::Break},
+    {"fun", Token::Type::Fun},
+    {"var", Token::Type::Var},
+    {"class", Token::Type::Class},
+    {"final", Token::Type::Final},
+    {"this", Token::Type::This},
+    {"super", Token::Type::Super},
+    {"print", Token::Type::Print},
+};
+
+// keywords are hashed by their length and first and last characters,
+// the seed is searched at compile time so that no two keywords collide
+static constexpr size_t KeywordTableSize = 64;
+
+static constexpr size_t KeywordHash(std::string_view word, size_t seed)
+{
+    return (static_cast<unsigned char>(word.front()) + static_cast<unsigned char>(word.back()) * seed + word.size()) % KeywordTableSize;
+}
+
+static constexpr size_t FindKeywordSeed()
+{
+    for (size_t seed = 1; seed < KeywordTableSize; ++seed)
+    {
+        std::array<bool, KeywordTableSize> used{};
+        bool collides = false;
+        for (const Keyword& keyword : Keywords)
+        {
+            const size_t hash = KeywordHash(keyword.m_name, seed);
+            collides = collides || used[hash];
+            used[hash] = true;
+        }
+
+        if (!collides)
+        {
+            return seed;
+        }
+    }
+    return 0;
+}
+
+static constexpr size_t KeywordSeed = FindKeywordSeed();
+static_assert(KeywordSeed != 0, "Keywords don't have a perfect hash, change KeywordHash or KeywordTableSize.");
+
+static constexpr std::array<int8_t, KeywordTableSize> KeywordTable = []()
+{
+    std::array<int8_t, KeywordTableSize> table{};
+    table.fill(-1);
+    for (size_t i = 0; i < std::size(Keywords); ++i)
+    {
+        table[KeywordHash(Keywords[i].m_name, KeywordSeed)] = static_cast<int8_t>(i);
+    }
+    return table;
+}();
+
+static Token::Type IdentifierOrKeyword(std::string_view word)
+{
+    const int8_t index = KeywordTable[KeywordHash(word, KeywordSeed)];
+    if (index >= 0 && Keywords[index].m_name == word)
+    {
+        return Keywords[index].m_type;
+    }
+    return Token::Type::Identifier;
+}
+
+// returns position of the first character in [position, end) that can't continue an identifier
+static size_t SkipIdentifierCharacters(const char* data, size_t position, size_t end)
+{
+#if defined(SCANNER_USE_AVX2)
+    while (position + 32 <= end)
+    {
+        const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position));
+        const __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+        const __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+        const __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+        const __m256i underscore = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('_'));
+        const uint32_t mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(letter, digit), underscore)));
+        if (mask != 0)
+        {
+            return position + std::countr_zero(mask);
+        }
+        position += 32;
+    }
+#endif
+#if defined(SCANNER_USE_SSE2)
+    while (position + 16 <= end)
+    {
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+        const __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+        const __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+        const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+        const __m128i underscore = _mm_cmpeq_epi8(c, _mm_set1_epi8('_'));
+        const uint32_t mask = ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letter, digit), underscore))) & 0xFFFF;
+        if (mask != 0)
+        {
+            return position + std::countr_zero(mask);
+        }
+        position += 16;
+    }
+#endif
+    while (position < end && HasClass(data[position], AlphaCharacter | DigitCharacter))
+    {
+        ++position;
+    }
+    return position;
+}
+
+// returns position of the first non whitespace character in [position, end), newlines are added to line
+static size_t SkipWhitespaceCharacters(const char* data, size_t position, size_t end, int& line)
+{
+#if defined(SCANNER_USE_AVX2)
+    while (position + 32 <= end)
+    {
+        const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position));
+        const __m256i newline = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\n'));
+        const __m256i blank = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\t'))), _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\r')));
+        const uint32_t newlineMask = static_cast<uint32_t>(_mm256_movemask_epi8(newline));
+        const uint32_t mask = ~(static_cast<uint32_t>(_mm256_movemask_epi8(blank)) | newlineMask);
+        if (mask != 0)
+        {
+            const int count = std::countr_zero(mask);
+            line += std::popcount(newlineMask & ((1u << count) - 1));
+            return position + count;
+        }
+        line += std::popcount(newlineMask);
+        position += 32;
+    }
+#endif
+#if defined(SCANNER_USE_SSE2)
+    while (position + 16 <= end)
+    {
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+        const __m128i newline = _mm_cmpeq_epi8(c, _mm_set1_epi8('\n'));
+        const __m128i blank = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(c, _mm_set1_epi8('\t'))), _mm_cmpeq_epi8(c, _mm_set1_epi8('\r')));
+        const uint32_t newlineMask = static_cast<uint32_t>(_mm_movemask_epi8(newline));
+        const uint32_t mask = ~(static_cast<uint32_t>(_mm_movemask_epi8(blank)) | newlineMask) & 0xFFFF;
+        if (mask != 0)
+        {
+            const int count = std::countr_zero(mask);
+            line += std::popcount(newlineMask & ((1u << count) - 1));
+            return position + count;
+        }
+        line += std::popcount(newlineMask);
+        position += 16;
+    }
+#endif
+    while (position < end && HasClass(data[position], WhitespaceCharacter))
+    {
+        line += data[position] == '\n';
+        ++position;
+    }
+    return position;
+}
+
+static int CountNewlines(const char* begin, const char* end)
+{
+    return static_cast<int>(std::count(begin, end, '\n'));
+}
+
+Scanner::Scanner(std::string_view source, int line)
     : m_source(source)
+    , m_line(line)
 {
     ScanTokens();
 }
 
 void Scanner::ScanTokens()
 {
+    SkipWhitespaces();
     while (!IsAtEnd())
     {
         m_start = m_current;
-        ScanToken();    
+        ScanToken();
+        SkipWhitespaces();
     }
 
-    m_tokens.emplace_back(Token::Type::EndOfFile, "", Value(), m_line);
+    m_tokens.emplace_back(Token::Type::EndOfFile, "", m_line);
 }
 
 void Scanner::ScanToken()
@@ -29,7 +249,7 @@ void Scanner::ScanToken()
         case '{': AddToken(Token::Type::OpeningBrace); break;
         case '}': AddToken(Token::Type::ClosingBrace); break;    
         case ',': AddToken(Token::Type::Comma); break;
-        case '.': AddToken(Token::Type::Dot); break;
+        case '.': AddToken(AdvanceIfMatch('.') ? Token::Type::DotDot : Token::Type::Dot); break;
         case '-': AddToken(Token::Type::Minus); break;
         case '+': AddToken(Token::Type::Plus); break;
         case ':': AddToken(Token::Type::Colon); break;
@@ -46,44 +266,17 @@ void Scanner::ScanToken()
         {
             if (AdvanceIfMatch('/')) // // comments
             {
-                while (Peek() != '\n' && !IsAtEnd())
-                {
-                    Advance();
-                }
+                SkipLineComment();
             }
             else if (AdvanceIfMatch('*')) // /* comments
             {
-                while (!IsAtEnd())
-                {
-                    if (AdvanceIfMatch('*') && Peek() == '/')
-                    {
-                        Advance(); // consume '/'
-                        break;
-                    }
-                    else if (Peek() == '\n')
-                    {
-                        ++m_line;
-                    }
-
-                    Advance();
-                }
-                
-                if (IsAtEnd())
-                {
-                    Gekko::ReportError(m_line, "Unterminated comment block.");
-                }
+                SkipBlockComment();
             }
             else
             {
                 AddToken(Token::Type::Slash);
             }
-        }
-
-        case ' ':
-        case '\r':
-        case '\t': /*ignore whitespaces*/ break;
-
-        case '\n': ++m_line; break;
+        } break;
 
         case '"': ScanStringLiteral(); break;
 
@@ -106,36 +299,61 @@ void Scanner::ScanToken()
 }
 
 void Scanner::AddToken(Token::Type tokenType)
-{
-    AddToken(tokenType, Value());
-}
-
-void Scanner::AddToken(Token::Type tokenType, Value literalValue)
 {
     std::string_view lexeme = m_source.substr(m_start, m_current-m_start);
-    m_tokens.emplace_back(tokenType, lexeme, literalValue, m_line);
+    m_tokens.emplace_back(tokenType, lexeme, m_line);
 }
 
 void Scanner::ScanStringLiteral()
 {
-    while (!IsAtEnd() && Peek() != '"')
-    {
-        if (Peek() == '\n')
-        {
-            ++m_line;
-        }
-        Advance();
-    }
+    const char* begin = m_source.data() + m_current;
+    const char* end = m_source.data() + m_source.length();
+    const char* closing = static_cast<const char*>(std::memchr(begin, '"', end - begin));
+    m_line += CountNewlines(begin, closing ? closing : end);
 
-    if(IsAtEnd())
+    if (!closing)
     {
+        m_current = static_cast<int>(m_source.length());
         Gekko::ReportError(m_line, "Unterminated string.");
         return;
     }
     
-    Advance(); // closing "
+    m_current = static_cast<int>(closing - m_source.data()) + 1; // closing "
 
-    AddToken(Token::Type::String, Value(std::string(m_source.substr(m_start + 1, m_current - m_start - 2))));
+    AddToken(Token::Type::String);
+}
+
+void Scanner::SkipWhitespaces()
+{
+    m_current = static_cast<int>(SkipWhitespaceCharacters(m_source.data(), m_current, m_source.length(), m_line));
+}
+
+void Scanner::SkipLineComment()
+{
+    const char* begin = m_source.data() + m_current;
+    const char* newline = static_cast<const char*>(std::memchr(begin, '\n', m_source.length() - m_current));
+    m_current = newline ? static_cast<int>(newline - m_source.data()) : static_cast<int>(m_source.length());
+}
+
+void Scanner::SkipBlockComment()
+{
+    const char* begin = m_source.data() + m_current;
+    const char* end = m_source.data() + m_source.length();
+    const char* star = begin;
+    while ((star = static_cast<const char*>(std::memchr(star, '*', end - star))) != nullptr)
+    {
+        if (star + 1 < end && star[1] == '/')
+        {
+            m_line += CountNewlines(begin, star);
+            m_current = static_cast<int>(star - m_source.data()) + 2;
+            return;
+        }
+        ++star;
+    }
+
+    m_line += CountNewlines(begin, end);
+    m_current = static_cast<int>(m_source.length());
+    Gekko::ReportError(m_line, "Unterminated comment block.");
 }
 
 bool Scanner::IsAtEnd() const
@@ -148,6 +366,11 @@ char Scanner::Peek() const
     return IsAtEnd() ? '\0' : m_source[m_current];
 }
 
+char Scanner::PeekNext() const
+{
+    return static_cast<size_t>(m_current) + 1 >= m_source.length() ? '\0' : m_source[m_current + 1];
+}
+
 char Scanner::Advance()
 {
     return m_source[m_current++];
@@ -166,17 +389,17 @@ bool Scanner::AdvanceIfMatch(char match)
 
 bool Scanner::IsDigit(char c) const
 {
-    return c >= '0' && c <= '9';
+    return HasClass(c, DigitCharacter);
 }
 
 bool Scanner::IsAlpha(char c) const
 {
-    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    return HasClass(c, AlphaCharacter);
 }
 
 bool Scanner::IsAlphanNmeric(char c) const
 {
-    return IsAlpha(c) || IsDigit(c);
+    return HasClass(c, AlphaCharacter | DigitCharacter);
 }
 
 void Scanner::ScanNumberLiteral()
@@ -186,7 +409,7 @@ void Scanner::ScanNumberLiteral()
         Advance();
     }
 
-    if (Peek() == '.')
+    if (Peek() == '.' && IsDigit(PeekNext())) // '1..5' is a range, not a fraction
     {
         Advance(); // consume '.'
         
@@ -200,7 +423,7 @@ void Scanner::ScanNumberLiteral()
     double value = 0.0;
     if (std::from_chars(numberStr.data(), numberStr.data() + numberStr.size(), value).ec == std::errc{})
     {
-        AddToken(Token::Type::Number, Value(value));  
+        AddToken(Token::Type::Number);  
     }
     else
     {
@@ -210,47 +433,6 @@ void Scanner::ScanNumberLiteral()
 
 void Scanner::ScanIdentifier()
 {
-    while (IsAlphanNmeric(Peek()))
-    {
-        Advance();
-    }
-    
-    Token::Type type = Token::Type::Identifier;
-    std::string_view keyword = m_source.substr(m_start, m_current-m_start);
-    StaticData::Instance().KeywordToTokenType(keyword, type);
-
-    AddToken(type);
-}
-
-Scanner::StaticData::StaticData()
-{
-    m_keywordToTokenType.insert({"return", Token::Type::Return});
-    m_keywordToTokenType.insert({"nil", Token::Type::Nil});
-    m_keywordToTokenType.insert({"false", Token::Type::False});
-    m_keywordToTokenType.insert({"true", Token::Type::True});
-    m_keywordToTokenType.insert({"and", Token::Type::And});
-    m_keywordToTokenType.insert({"or", Token::Type::Or});
-    m_keywordToTokenType.insert({"if", Token::Type::If});
-    m_keywordToTokenType.insert({"else", Token::Type::Else});
-    m_keywordToTokenType.insert({"while", Token::Type::While});
-    m_keywordToTokenType.insert({"for", Token::Type::For});
-    m_keywordToTokenType.insert({"break", Token::Type::Break});
-    m_keywordToTokenType.insert({"fun", Token::Type::Fun});
-    m_keywordToTokenType.insert({"var", Token::Type::Var});
-    m_keywordToTokenType.insert({"class", Token::Type::Class});
-    m_keywordToTokenType.insert({"this", Token::Type::This});
-    m_keywordToTokenType.insert({"super", Token::Type::Super});
-    m_keywordToTokenType.insert({"print", Token::Type::Print});
-}
-
-bool Scanner::StaticData::KeywordToTokenType(std::string_view keyword, Token::Type& outType) const
-{
-    const auto& it = m_keywordToTokenType.find(keyword);
-    if (it == m_keywordToTokenType.cend())
-    {
-        return false; 
-    }
-
-    outType = it->second;
-    return true;
+    m_current = static_cast<int>(SkipIdentifierCharacters(m_source.data(), m_current, m_source.length()));
+    AddToken(IdentifierOrKeyword(m_source.substr(m_start, m_current-m_start)));
 }
@@ -2,7 +2,6 @@
 
 #include <string>
 #include <vector>
-#include <map>
 
 #include "token.h"
 
@@ -10,7 +9,8 @@
 class Scanner
 {
 public:
-    Scanner(std::string_view source);
+    // line is the number of the first line of source, for sources which are parts of a file
+    Scanner(std::string_view source, int line = 1);
 
     const std::vector<Token>& Tokens() const { return m_tokens; }
 
@@ -18,14 +18,17 @@ private:
     void ScanTokens();
     void ScanToken();
     void AddToken(Token::Type tokenType);
-    void AddToken(Token::Type tokenType, Value literalValue);
 
     void ScanStringLiteral();
     void ScanNumberLiteral();
     void ScanIdentifier();
+    void SkipWhitespaces();
+    void SkipLineComment();
+    void SkipBlockComment();
 
     char Advance();
     char Peek() const;
+    char PeekNext() const;
     bool AdvanceIfMatch(char match);
     bool IsAtEnd() const;
 
@@ -33,20 +36,6 @@ private:
     bool IsAlpha(char c) const;
     bool IsAlphanNmeric(char c) const;
 
-    class StaticData 
-    {
-    public:
-        static const StaticData& Instance() { static const StaticData data; return data; }
-
-        bool KeywordToTokenType(std::string_view keyword, Token::Type& outType) const;
-
-    private:
-        StaticData();
-    private:
-        std::map<std::string_view, Token::Type> m_keywordToTokenType;
-    };
-    
-
     std::string_view m_source;
     std::vector<Token> m_tokens;
 
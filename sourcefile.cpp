@@ -0,0 +1,123 @@
+#include "sourcefile.h"
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::unique_ptr<SourceFile> SourceFile::Open(const char* filename)
+{
+    std::unique_ptr<SourceFile> sourceFile(new SourceFile());
+    if (sourceFile->Map(filename) || sourceFile->Read(filename))
+    {
+        return sourceFile;
+    }
+
+    return nullptr;
+}
+
+SourceFile::~SourceFile()
+{
+    if (m_mapping)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(m_mapping);
+#else
+        munmap(m_mapping, m_size);
+#endif
+    }
+}
+
+#ifdef _WIN32
+
+bool SourceFile::Map(const char* filename)
+{
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    // the view keeps the mapping object alive, both handles can be closed right away
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+    {
+        return false;
+    }
+
+    m_mapping = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!m_mapping)
+    {
+        return false;
+    }
+
+    m_data = static_cast<const char*>(m_mapping);
+    m_size = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+#else
+
+bool SourceFile::Map(const char* filename)
+{
+    int file = open(filename, O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(file, &status) != 0 || !S_ISREG(status.st_mode) || status.st_size == 0)
+    {
+        close(file);
+        return false;
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    void* mapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    posix_madvise(mapping, static_cast<size_t>(status.st_size), POSIX_MADV_SEQUENTIAL); // scanner reads front to back
+
+    m_mapping = mapping;
+    m_data = static_cast<const char*>(mapping);
+    m_size = static_cast<size_t>(status.st_size);
+    return true;
+}
+
+#endif
+
+bool SourceFile::Read(const char* filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+    return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+// read only content of a script file.
+// regular files are memory mapped, anything that can't be mapped (pipes, empty files) is read into a buffer.
+// tokens and the AST keep string_views into the content, so the file has to outlive them.
+class SourceFile
+{
+public:
+    static std::unique_ptr<SourceFile> Open(const char* filename);
+
+    ~SourceFile();
+
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    std::string_view Content() const { return std::string_view(m_data, m_size); }
+    bool IsMapped() const { return m_mapping != nullptr; }
+
+private:
+    SourceFile() = default;
+
+    bool Map(const char* filename);
+    bool Read(const char* filename);
+
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    void* m_mapping = nullptr; // start of the mapped view, null when the content lives in m_buffer
+    std::string m_buffer;
+};
@@ -0,0 +1,530 @@
+#include "specializer.h"
+#include "statementvisitor.h"
+#include "expressionvisitor.h"
+#include "statements.h"
+#include "expressions.h"
+#include "function.h"
+#include "interpreter.h"
+#include "escapeanalyzer.h"
+#include "token.h"
+#include <unordered_map>
+
+namespace
+{
+    struct ClonerContext : IStatementVisitorContext, IExpressionVisitorContext
+    {
+        explicit ClonerContext(const Specializer::Folder& folder)
+            : m_folder(folder)
+        {}
+
+        const Specializer::Folder& m_folder;
+        std::unordered_map<const Token*, const Value*> m_constants; // parameters passed as literals
+        size_t m_foldsCount = 0;
+        bool m_failed = false;
+        IExpressionPtr m_expression;
+        IStatementPtr m_statement;
+    };
+
+    ClonerContext& GetClonerContext(IStatementVisitorContext* context)
+    {
+        return *static_cast<ClonerContext*>(context);
+    }
+
+    ClonerContext& GetClonerContext(IExpressionVisitorContext* context)
+    {
+        return *static_cast<ClonerContext*>(context);
+    }
+
+    const Value* GetLiteral(const IExpression& expression)
+    {
+        if (const LiteralExpression* literal = dynamic_cast<const LiteralExpression*>(&expression))
+        {
+            return &literal->m_value;
+        }
+        else if (const VariableExpression* variable = dynamic_cast<const VariableExpression*>(&expression))
+        {
+            return variable->m_resolved.m_constant;
+        }
+
+        return nullptr;
+    }
+
+    IStatementPtr MakeEmptyStatement()
+    {
+        std::unique_ptr<BlockStatement> block = std::make_unique<BlockStatement>(std::vector<IStatementPtr>());
+        block->m_hasScope = false;
+        return block;
+    }
+
+    // copies a resolved body, scopes are kept as they are, so resolved distances stay valid
+    struct FoldingCloner : IStatementVisitor, IExpressionVisitor
+    {
+        IExpressionPtr Clone(const IExpression& expression, ClonerContext& context) const
+        {
+            context.m_expression = nullptr;
+            if (!context.m_failed)
+            {
+                expression.Accept(*this, &context);
+                context.m_failed |= !context.m_expression;
+            }
+            return std::move(context.m_expression);
+        }
+
+        IExpressionPtr CloneOptional(const IExpressionPtr& expression, ClonerContext& context) const
+        {
+            return expression ? Clone(*expression, context) : nullptr;
+        }
+
+        IStatementPtr Clone(const IStatement& statement, ClonerContext& context) const
+        {
+            context.m_statement = nullptr;
+            if (!context.m_failed)
+            {
+                statement.Accept(*this, &context);
+                context.m_failed |= !context.m_statement;
+            }
+            return std::move(context.m_statement);
+        }
+
+        std::vector<IStatementPtr> Clone(const std::vector<IStatementPtr>& statements, ClonerContext& context) const
+        {
+            std::vector<IStatementPtr> clones;
+            clones.reserve(statements.size());
+            for (const IStatementPtr& statement : statements)
+            {
+                clones.push_back(Clone(*statement, context));
+            }
+            return clones;
+        }
+
+        // replaces an expression of literals with its value
+        static IExpressionPtr Fold(IExpressionPtr expression, ClonerContext& context)
+        {
+            Value value;
+            if (!context.m_folder(*expression, value))
+            {
+                return expression; // reported when executed
+            }
+
+            ++context.m_foldsCount;
+            return std::make_unique<LiteralExpression>(value);
+        }
+
+        virtual void VisitExpressionStatement(const ExpressionStatement& statement, IStatementVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+            if (IExpressionPtr expression = Clone(*statement.m_expression, clonerContext))
+            {
+                clonerContext.m_statement = std::make_unique<ExpressionStatement>(std::move(expression));
+            }
+        }
+
+        virtual void VisitPrintStatement(const PrintStatement& statement, IStatementVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+            if (IExpressionPtr expression = Clone(*statement.m_expression, clonerContext))
+            {
+                clonerContext.m_statement = std::make_unique<PrintStatement>(std::move(expression));
+            }
+        }
+
+        virtual void VisitVariableDeclarationStatement(const VariableDeclarationStatement& statement, IStatementVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+            IExpressionPtr initializer = CloneOptional(statement.m_initializer, clonerContext);
+            if (!clonerContext.m_failed)
+            {
+                clonerContext.m_statement = std::make_unique<VariableDeclarationStatement>(statement.m_name, std::move(initializer));
+            }
+        }
+
+        virtual void VisitFunctionDeclarationStatement(const FunctionDeclarationStatement& statement, IStatementVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+            FunctionDeclarationStatement::BodyType body = Clone(statement.m_body, clonerContext);
+            if (!clonerContext.m_failed)
+            {
+                clonerContext.m_statement = std::make_unique<FunctionDeclarationStatement>(
+                    statement.m_name, FunctionDeclarationStatement::ParametersType(statement.m_parameters), std::move(body), statement.m_type);
+            }
+        }
+
+        // classes are left as they are, the specialization fails
+
+        virtual void VisitBlockStatement(const BlockStatement& statement, IStatementVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+            std::vector<IStatementPtr> block = Clone(statement.m_block, clonerContext);
+            if (!clonerContext.m_failed)
+            {
+                std::unique_ptr<BlockStatement> clone = std::make_unique<BlockStatement>(std::move(block));
+                clone->m_hasScope = statement.m_hasScope;
+                clonerContext.m_statement = std::move(clone);
+            }
+        }
+
+        virtual void VisitIfStatement(const IfStatement& statement, IStatementVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+            IExpressionPtr condition = Clone(*statement.m_condition, clonerContext);
+            if (!condition)
+            {
+                return;
+            }
+
+            // a branch is executed in the environment of the 'if', so it can replace it
+            if (const Value* literal = GetLiteral(*condition))
+            {
+                ++clonerContext.m_foldsCount;
+                const IStatementPtr& taken = literal->IsTruthy() ? statement.m_trueBranch : statement.m_falseBranch;
+                clonerContext.m_statement = taken ? Clone(*taken, clonerContext) : MakeEmptyStatement();
+                return;
+            }
+
+            IStatementPtr trueBranch = Clone(*statement.m_trueBranch, clonerContext);
+            IStatementPtr falseBranch = statement.m_falseBranch ? Clone(*statement.m_falseBranch, clonerContext) : nullptr;
+            if (!clonerContext.m_failed)
+            {
+                clonerContext.m_statement = std::make_unique<IfStatement>(std::move(condition), std::move(trueBranch), std::move(falseBranch));
+            }
+        }
+
+        virtual void VisitWhileStatement(const WhileStatement& statement, IStatementVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+            IExpressionPtr condition = Clone(*statement.m_condition, clonerContext);
+            if (!condition)
+            {
+                return;
+            }
+
+            const Value* literal = GetLiteral(*condition);
+            if (literal && !literal->IsTruthy())
+            {
+                ++clonerContext.m_foldsCount;
+                clonerContext.m_statement = MakeEmptyStatement();
+                return;
+            }
+
+            if (IStatementPtr body = Clone(*statement.m_body, clonerContext))
+            {
+                clonerContext.m_statement = std::make_unique<WhileStatement>(std::move(condition), std::move(body));
+            }
+        }
+
+        virtual void VisitForStatement(const ForStatement& statement, IStatementVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+            IStatementPtr initializer = statement.m_initializer ? Clone(*statement.m_initializer, clonerContext) : nullptr;
+            IExpressionPtr condition = CloneOptional(statement.m_condition, clonerContext);
+            IExpressionPtr increment = CloneOptional(statement.m_increment, clonerContext);
+            IExpressionPtr rangeEnd = CloneOptional(statement.m_rangeEnd, clonerContext);
+            IStatementPtr body = Clone(*statement.m_body, clonerContext);
+            if (clonerContext.m_failed)
+            {
+                return;
+            }
+
+            // the limit of a counted loop is the right operand of its condition
+            const BinaryExpression* comparison = dynamic_cast<const BinaryExpression*>(condition.get());
+            std::unique_ptr<ForStatement> clone = std::make_unique<ForStatement>(std::move(initializer), std::move(condition), std::move(increment), std::move(body));
+            if (statement.m_rangeEnd || (statement.m_limit && comparison))
+            {
+                clone->m_counter = statement.m_counter;
+                clone->m_comparison = statement.m_comparison;
+                clone->m_limit = statement.m_limit ? comparison->m_right.get() : nullptr;
+                clone->m_rangeEnd = std::move(rangeEnd);
+                clone->m_step = statement.m_step;
+            }
+            clone->m_hasScope = statement.m_hasScope;
+            clonerContext.m_statement = std::move(clone);
+        }
+
+        virtual void VisitBreakStatement(const BreakStatement& statement, IStatementVisitorContext* context) const override
+        {
+            GetClonerContext(context).m_statement = std::make_unique<BreakStatement>(statement.m_keyword);
+        }
+
+        virtual void VisitReturnStatement(const ReturnStatement& statement, IStatementVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+            IExpressionPtr returnValue = CloneOptional(statement.m_returnValue, clonerContext);
+            if (!clonerContext.m_failed)
+            {
+                clonerContext.m_statement = std::make_unique<ReturnStatement>(std::move(returnValue), statement.m_keyword);
+            }
+        }
+
+        virtual void VisitUnaryExpression(const UnaryExpression& unaryExpression, IExpressionVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+            if (IExpressionPtr operand = Clone(*unaryExpression.m_expression, clonerContext))
+            {
+                const bool isLiteral = GetLiteral(*operand);
+                std::unique_ptr<UnaryExpression> clone = std::make_unique<UnaryExpression>(unaryExpression.m_operator, std::move(operand));
+                clone->m_operandType = unaryExpression.m_operandType;
+                clonerContext.m_expression = isLiteral ? Fold(std::move(clone), clonerContext) : std::move(clone);
+            }
+        }
+
+        virtual void VisitBinaryExpression(const BinaryExpression& binaryExpression, IExpressionVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+            IExpressionPtr left = Clone(*binaryExpression.m_left, clonerContext);
+            IExpressionPtr right = Clone(*binaryExpression.m_right, clonerContext);
+            if (clonerContext.m_failed)
+            {
+                return;
+            }
+
+            const bool isLiteral = GetLiteral(*left) && GetLiteral(*right);
+            std::unique_ptr<BinaryExpression> clone = std::make_unique<BinaryExpression>(std::move(left), binaryExpression.m_operator, std::move(right));
+            clone->m_operandsType = binaryExpression.m_operandsType;
+            clonerContext.m_expression = isLiteral ? Fold(std::move(clone), clonerContext) : std::move(clone);
+        }
+
+        virtual void VisitTernaryConditionalExpression(const TernaryConditionalExpression& ternaryConditionalExpression, IExpressionVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+            IExpressionPtr condition = Clone(*ternaryConditionalExpression.m_condition, clonerContext);
+            if (!condition)
+            {
+                return;
+            }
+
+            if (const Value* literal = GetLiteral(*condition))
+            {
+                ++clonerContext.m_foldsCount;
+                clonerContext.m_expression = Clone(literal->IsTruthy() ? *ternaryConditionalExpression.m_trueBranch : *ternaryConditionalExpression.m_falseBranch, clonerContext);
+                return;
+            }
+
+            IExpressionPtr trueBranch = Clone(*ternaryConditionalExpression.m_trueBranch, clonerContext);
+            IExpressionPtr falseBranch = Clone(*ternaryConditionalExpression.m_falseBranch, clonerContext);
+            if (!clonerContext.m_failed)
+            {
+                clonerContext.m_expression = std::make_unique<TernaryConditionalExpression>(std::move(condition), std::move(trueBranch), std::move(falseBranch));
+            }
+        }
+
+        virtual void VisitGroupingExpression(const GroupingExpression& groupingExpression, IExpressionVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+            if (IExpressionPtr expression = Clone(*groupingExpression.m_expression, clonerContext))
+            {
+                const bool isLiteral = GetLiteral(*expression);
+                clonerContext.m_expression = isLiteral ? std::move(expression) : std::make_unique<GroupingExpression>(std::move(expression));
+            }
+        }
+
+        virtual void VisitLiteralExpression(const LiteralExpression& literalExpression, IExpressionVisitorContext* context) const override
+        {
+            GetClonerContext(context).m_expression = std::make_unique<LiteralExpression>(literalExpression.m_value);
+        }
+
+        virtual void VisitVariableExpression(const VariableExpression& variableExpression, IExpressionVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+
+            // parameters assigned anywhere in the body aren't final and keep their uses
+            const ResolvedName& resolved = variableExpression.m_resolved;
+            auto constant = resolved.m_final && resolved.m_declaration ? clonerContext.m_constants.find(resolved.m_declaration) : clonerContext.m_constants.end();
+            if (constant != clonerContext.m_constants.end())
+            {
+                clonerContext.m_expression = std::make_unique<LiteralExpression>(*constant->second);
+            }
+            else if (resolved.m_constant)
+            {
+                clonerContext.m_expression = std::make_unique<LiteralExpression>(*resolved.m_constant);
+            }
+            else
+            {
+                std::unique_ptr<VariableExpression> clone = std::make_unique<VariableExpression>(variableExpression.m_name);
+                clone->m_resolved = resolved;
+                clonerContext.m_expression = std::move(clone);
+            }
+        }
+
+        virtual void VisitAssignmentExpression(const AssignmentExpression& assignmentExpression, IExpressionVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+            if (IExpressionPtr value = Clone(*assignmentExpression.m_expression, clonerContext))
+            {
+                std::unique_ptr<AssignmentExpression> clone = std::make_unique<AssignmentExpression>(assignmentExpression.m_name, std::move(value));
+                clone->m_resolved = assignmentExpression.m_resolved;
+                clonerContext.m_expression = std::move(clone);
+            }
+        }
+
+        virtual void VisitLogicalExpression(const LogicalExpression& logicalExpression, IExpressionVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+            IExpressionPtr left = Clone(*logicalExpression.m_left, clonerContext);
+            if (!left)
+            {
+                return;
+            }
+
+            // a literal left operand decides whether the right one is the result
+            if (const Value* literal = GetLiteral(*left))
+            {
+                ++clonerContext.m_foldsCount;
+                const bool isOr = logicalExpression.m_operator.m_type == Token::Type::Or;
+                clonerContext.m_expression = literal->IsTruthy() == isOr ? std::move(left) : Clone(*logicalExpression.m_right, clonerContext);
+                return;
+            }
+
+            if (IExpressionPtr right = Clone(*logicalExpression.m_right, clonerContext))
+            {
+                clonerContext.m_expression = std::make_unique<LogicalExpression>(std::move(left), logicalExpression.m_operator, std::move(right));
+            }
+        }
+
+        virtual void VisitCallExpression(const CallExpression& callExpression, IExpressionVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+            IExpressionPtr callee = Clone(*callExpression.m_calle, clonerContext);
+            std::vector<IExpressionPtr> arguments;
+            for (const IExpressionPtr& argument : callExpression.m_arguments)
+            {
+                arguments.push_back(Clone(*argument, clonerContext));
+            }
+
+            if (!clonerContext.m_failed)
+            {
+                const VariableExpression* calleeVariable = dynamic_cast<const VariableExpression*>(callee.get());
+                std::unique_ptr<CallExpression> clone = std::make_unique<CallExpression>(std::move(callee), callExpression.m_token, std::move(arguments));
+                clone->m_calleeVariable = calleeVariable;
+                clone->m_calleeProperty = dynamic_cast<const GetExpression*>(clone->m_calle.get());
+                clone->m_inlineDepth = callExpression.m_inlineDepth;
+                clonerContext.m_expression = std::move(clone);
+            }
+        }
+
+        virtual void VisitGetExpression(const GetExpression& getExpression, IExpressionVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+            if (IExpressionPtr owner = Clone(*getExpression.m_owner, clonerContext))
+            {
+                clonerContext.m_expression = std::make_unique<GetExpression>(std::move(owner), getExpression.m_name);
+            }
+        }
+
+        virtual void VisitSetExpression(const SetExpression& setExpression, IExpressionVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+            IExpressionPtr getter = Clone(*setExpression.m_getter, clonerContext);
+            IExpressionPtr value = Clone(*setExpression.m_value, clonerContext);
+            const GetExpression* clonedGetter = dynamic_cast<const GetExpression*>(getter.get());
+            if (!clonerContext.m_failed && clonedGetter)
+            {
+                const IExpression& owner = *clonedGetter->m_owner;
+                clonerContext.m_expression = std::make_unique<SetExpression>(std::move(getter), owner, setExpression.m_name, std::move(value));
+            }
+        }
+
+        virtual void VisitLambdaExpression(const LambdaExpression& lambdaExpression, IExpressionVisitorContext* context) const override
+        {
+            ClonerContext& clonerContext = GetClonerContext(context);
+            LambdaExpression::BodyType body = Clone(lambdaExpression.m_body, clonerContext);
+            if (!clonerContext.m_failed)
+            {
+                clonerContext.m_expression = std::make_unique<LambdaExpression>(LambdaExpression::ParametersType(lambdaExpression.m_parameters), std::move(body));
+            }
+        }
+
+        // 'this' and 'super' only appear in classes, which aren't cloned
+    };
+}
+
+Specializer::Specializer() = default;
+Specializer::~Specializer() = default;
+
+std::unique_ptr<const std::vector<IStatementPtr>> Specializer::Fold(const std::vector<IStatementPtr>& body)
+{
+    FunctionsRegistry functionsRegistry;
+    Folder folder = [&](const IExpression& expression, Value& value)
+    {
+        try
+        {
+            if (const UnaryExpression* unaryExpression = dynamic_cast<const UnaryExpression*>(&expression))
+            {
+                value = Interpreter::ApplyUnaryOperator(unaryExpression->m_operator, *GetLiteral(*unaryExpression->m_expression));
+                return true;
+            }
+            else if (const BinaryExpression* binaryExpression = dynamic_cast<const BinaryExpression*>(&expression))
+            {
+                value = Interpreter::ApplyBinaryOperator(binaryExpression->m_operator, *GetLiteral(*binaryExpression->m_left), *GetLiteral(*binaryExpression->m_right), functionsRegistry);
+                return true;
+            }
+        }
+        catch (const Interpreter::InterpreterError&)
+        {
+        }
+        return false;
+    };
+
+    ClonerContext context(folder);
+    std::vector<IStatementPtr> clone = FoldingCloner().Clone(body, context);
+    if (context.m_failed || context.m_foldsCount == 0)
+    {
+        return nullptr;
+    }
+
+    // the copy loses what the analyses wrote to the original
+    EscapeAnalyzer().AnalyzeBody(clone);
+    return std::make_unique<const std::vector<IStatementPtr>>(std::move(clone));
+}
+
+const Function* Specializer::Specialize(const CallExpression& callExpression, const Function& callee, EnvironmentPtr globals, FunctionsRegistry& functionsRegistry, const Folder& folder)
+{
+    const FunctionDeclarationStatement& declaration = callee.GetDeclaration();
+    if (declaration.m_type != FunctionDeclarationStatement::FunctionDeclarationType::FreeFunction || callee.GetClosure() != globals)
+    {
+        return nullptr;
+    }
+
+    ClonerContext context(folder);
+    std::string key;
+    for (size_t i = 0; i < callExpression.m_arguments.size(); ++i)
+    {
+        const Value* literal = GetLiteral(*callExpression.m_arguments[i]);
+        if (literal && literal->AppendKey(key))
+        {
+            context.m_constants.emplace(&declaration.m_parameters[i].get(), literal);
+        }
+        else
+        {
+            key += '_';
+        }
+    }
+
+    if (context.m_constants.empty())
+    {
+        return nullptr;
+    }
+
+    std::unordered_map<std::string, Specialization>& specializations = m_specializations[&callee];
+    auto it = specializations.find(key);
+    if (it != specializations.end())
+    {
+        return it->second.m_function;
+    }
+    else if (specializations.size() >= MaxSpecializationsPerFunction)
+    {
+        return nullptr;
+    }
+
+    // nothing is kept when no condition or expression depends on the literals
+    Specialization& specialization = specializations[key];
+    FunctionDeclarationStatement::BodyType body = FoldingCloner().Clone(declaration.m_body, context);
+    if (!context.m_failed && context.m_foldsCount > 0)
+    {
+        specialization.m_declaration = std::make_unique<FunctionDeclarationStatement>(
+            declaration.m_name, FunctionDeclarationStatement::ParametersType(declaration.m_parameters), std::move(body), declaration.m_type);
+        specialization.m_function = functionsRegistry.Register<Function>(*specialization.m_declaration, globals);
+        EscapeAnalyzer().AnalyzeBody(specialization.m_declaration->m_body);
+    }
+
+    return specialization.m_function;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "value.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Function;
+struct CallExpression;
+struct IExpression;
+struct FunctionDeclarationStatement;
+struct IStatement;
+using IStatementPtr = std::unique_ptr<const IStatement>;
+struct FunctionsRegistry;
+struct Environment;
+using EnvironmentPtr = std::shared_ptr<Environment>;
+
+// clones bodies of top-level functions called with literal arguments.
+// final parameters are replaced with the literals and the clone is constant folded,
+// conditions on them are decided once and the branches not taken are dropped.
+// specializations are shared by all call sites passing the same literals at the same positions.
+class Specializer
+{
+public:
+    static constexpr size_t MaxSpecializationsPerFunction = 8;
+
+    // evaluates an expression of literals, returns false when it fails at runtime
+    using Folder = std::function<bool(const IExpression& expression, Value& result)>;
+
+    Specializer();
+    ~Specializer();
+
+    // returns nullptr when the call site passes no literals or nothing in the body depends on them
+    const Function* Specialize(const CallExpression& callExpression, const Function& callee, EnvironmentPtr globals, FunctionsRegistry& functionsRegistry, const Folder& folder);
+
+    // folds the operators on literals and the constant conditions of a body, returns nullptr when nothing is folded.
+    // it only reads what the front end set on the body and doesn't evaluate anything but operators, so it can run on another thread
+    static std::unique_ptr<const std::vector<IStatementPtr>> Fold(const std::vector<IStatementPtr>& body);
+
+private:
+    struct Specialization
+    {
+        std::unique_ptr<const FunctionDeclarationStatement> m_declaration;
+        const Function* m_function = nullptr;
+    };
+
+    std::unordered_map<const Function*, std::unordered_map<std::string, Specialization>> m_specializations;
+};
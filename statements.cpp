@@ -1,6 +1,8 @@
 #include "statements.h"
 #include "expressions.h"
 #include "statementvisitor.h"
+#include "trace.h"
+#include "escapeanalyzer.h"
 
 ExpressionStatement::ExpressionStatement(IExpressionPtr expression)
     : m_expression(std::move(expression))
@@ -25,6 +27,8 @@ VariableDeclarationStatement::VariableDeclarationStatement(const Token& name, IE
     , m_initializer(std::move(initializer))
 {}
 
+VariableDeclarationStatement::~VariableDeclarationStatement() = default;
+
 void VariableDeclarationStatement::Accept(const IStatementVisitor& visitor, IStatementVisitorContext* context) const
 {
     visitor.VisitVariableDeclarationStatement(*this, context);
@@ -43,9 +47,10 @@ void FunctionDeclarationStatement::Accept(const IStatementVisitor& visitor, ISta
     visitor.VisitFunctionDeclarationStatement(*this, context);
 }
 
-ClassDeclarationStatement::ClassDeclarationStatement(const Token& name, std::unique_ptr<VariableExpression>&& superClass, std::vector<std::unique_ptr<FunctionDeclarationStatement>>&& methods)
+ClassDeclarationStatement::ClassDeclarationStatement(const Token& name, std::unique_ptr<VariableExpression>&& superClass, std::vector<std::unique_ptr<FunctionDeclarationStatement>>&& methods, FieldsType&& fields)
     : m_name(name)
     , m_methods(std::move(methods))
+    , m_fields(std::move(fields))
     , m_superClass(std::move(superClass))
 {}
 
@@ -79,11 +84,25 @@ WhileStatement::WhileStatement(IExpressionPtr condition, IStatementPtr body)
     , m_body(std::move(body))
 {}
 
+WhileStatement::~WhileStatement() = default;
+
 void WhileStatement::Accept(const IStatementVisitor& visitor, IStatementVisitorContext* context) const
 {
     visitor.VisitWhileStatement(*this, context);    
 }
 
+ForStatement::ForStatement(IStatementPtr initializer, IExpressionPtr condition, IExpressionPtr increment, IStatementPtr body)
+    : m_initializer(std::move(initializer))
+    , m_condition(std::move(condition))
+    , m_increment(std::move(increment))
+    , m_body(std::move(body))
+{}
+
+void ForStatement::Accept(const IStatementVisitor& visitor, IStatementVisitorContext* context) const
+{
+    visitor.VisitForStatement(*this, context);    
+}
+
 BreakStatement::BreakStatement(const Token& keyword)
     : m_keyword(keyword)
 {}
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <vector>
+#include "tiering.h"
 
 struct Token;
 
@@ -19,6 +21,9 @@ using IStatementPtr = std::unique_ptr<const IStatement>;
 struct IExpression;
 using IExpressionPtr = std::unique_ptr<const IExpression>;
 struct VariableExpression;
+struct ClassDeclarationStatement;
+class Trace;
+struct ScalarReplacement;
 
 struct ExpressionStatement : IStatement
 {
@@ -42,11 +47,14 @@ struct PrintStatement : IStatement
 struct VariableDeclarationStatement : IStatement
 {
     VariableDeclarationStatement(const Token& name, IExpressionPtr initializer);
+    ~VariableDeclarationStatement();
 
     virtual void Accept(const IStatementVisitor& visitor, IStatementVisitorContext* context) const override;
 
     const Token& m_name;
     IExpressionPtr m_initializer;
+
+    mutable std::unique_ptr<const ScalarReplacement> m_scalarReplacement; // set by EscapeAnalyzer
 };
 
 struct FunctionDeclarationStatement : IStatement
@@ -62,6 +70,14 @@ struct FunctionDeclarationStatement : IStatement
         MemberGetter
     };
 
+    // tokens of a body the parser skipped, it is parsed and resolved on the first call
+    struct DeferredBody
+    {
+        const std::vector<Token>& m_tokens;
+        int m_begin; // first token after '{'
+        const ClassDeclarationStatement* m_owner = nullptr; // set for methods
+    };
+
     FunctionDeclarationStatement(const Token& name, ParametersType&& parameters, BodyType&& body, FunctionDeclarationType type);
 
     virtual void Accept(const IStatementVisitor& visitor, IStatementVisitorContext* context) const override;
@@ -69,18 +85,25 @@ struct FunctionDeclarationStatement : IStatement
 
     const Token& m_name;
     ParametersType m_parameters;
-    BodyType m_body;
+    mutable BodyType m_body; // empty while the body is deferred
     FunctionDeclarationType m_type;
+    bool m_final = false; // a final method can't be overridden
+    mutable std::unique_ptr<DeferredBody> m_deferredBody;
+    mutable Tiering m_tiering;
 };
 
 struct ClassDeclarationStatement : IStatement
 {
-    ClassDeclarationStatement(const Token& name, std::unique_ptr<VariableExpression>&& superClass, std::vector<std::unique_ptr<FunctionDeclarationStatement>>&& methods);
+    using FieldsType = std::vector<std::reference_wrapper<const Token>>;
+
+    ClassDeclarationStatement(const Token& name, std::unique_ptr<VariableExpression>&& superClass, std::vector<std::unique_ptr<FunctionDeclarationStatement>>&& methods, FieldsType&& fields);
 
     virtual void Accept(const IStatementVisitor& visitor, IStatementVisitorContext* context) const override;
 
     const Token& m_name;
     std::vector<std::unique_ptr<FunctionDeclarationStatement>> m_methods;
+    FieldsType m_fields; // declared by 'var name;', a class declaring fields is a record class
+    bool m_final = false; // a final class can't be inherited from
     std::unique_ptr<VariableExpression> m_superClass;
 };
 
@@ -90,6 +113,7 @@ struct BlockStatement : IStatement
     virtual void Accept(const IStatementVisitor& visitor, IStatementVisitorContext* context) const override;
 
     std::vector<IStatementPtr> m_block;
+    mutable bool m_hasScope = true; // cleared by Resolver when the block declares nothing
 };
 
 struct IfStatement : IStatement
@@ -105,10 +129,38 @@ struct IfStatement : IStatement
 struct WhileStatement : IStatement
 {
     WhileStatement(IExpressionPtr condition, IStatementPtr body);
+    ~WhileStatement();
     virtual void Accept(const IStatementVisitor& visitor, IStatementVisitorContext* context) const override;
 
     IExpressionPtr m_condition;
     IStatementPtr m_body;
+
+    mutable std::unique_ptr<const Trace> m_trace; // recorded once the loop is hot
+    mutable uint32_t m_iterations = 0; // interpreted ones, counted until the trace is recorded
+    mutable bool m_untraceable = false;
+};
+
+// for loop keeps its own node so the loop variable lives in one environment for the whole loop.
+// 'for (var i = start; i < limit; i = i + step)' and 'for (var i = start..end)' are counted loops,
+// their counter is updated in place instead of evaluating the increment expression.
+struct ForStatement : IStatement
+{
+    ForStatement(IStatementPtr initializer, IExpressionPtr condition, IExpressionPtr increment, IStatementPtr body);
+    virtual void Accept(const IStatementVisitor& visitor, IStatementVisitorContext* context) const override;
+
+    IStatementPtr m_initializer;
+    IExpressionPtr m_condition;
+    IExpressionPtr m_increment;
+    IStatementPtr m_body;
+
+    // set for counted loops only
+    const Token* m_counter = nullptr;
+    const Token* m_comparison = nullptr; // '<', '<=', '>', '>=' of the condition or '..' of a range
+    const IExpression* m_limit = nullptr; // right hand side of the condition
+    IExpressionPtr m_rangeEnd; // exclusive, evaluated once before the first iteration
+    double m_step = 1.0;
+
+    mutable bool m_hasScope = true; // cleared by Resolver when the initializer declares nothing
 };
 
 struct BreakStatement : IStatement
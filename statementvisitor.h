@@ -13,6 +13,7 @@ struct ClassDeclarationStatement;
 struct BlockStatement;
 struct IfStatement;
 struct WhileStatement;
+struct ForStatement;
 struct BreakStatement;
 struct ReturnStatement;
 
@@ -28,6 +29,7 @@ struct IStatementVisitor
     virtual void VisitBlockStatement(const BlockStatement& statement, IStatementVisitorContext* context) const {}
     virtual void VisitIfStatement(const IfStatement& statement, IStatementVisitorContext* context) const {}
     virtual void VisitWhileStatement(const WhileStatement& statement, IStatementVisitorContext* context) const {}
+    virtual void VisitForStatement(const ForStatement& statement, IStatementVisitorContext* context) const {}
     virtual void VisitBreakStatement(const BreakStatement& statement, IStatementVisitorContext* context) const {}
     virtual void VisitReturnStatement(const ReturnStatement& statement, IStatementVisitorContext* context) const {}
 };
@@ -0,0 +1,144 @@
+#include "symboltable.h"
+#include <assert.h>
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // open addressing with linear probing over hashes computed once per symbol
+    class Symbols
+    {
+    public:
+        Symbols()
+        {
+            Insert("", Hash(""));
+            Insert("this", Hash("this"));
+            Insert("super", Hash("super"));
+        }
+
+        uint32_t Intern(std::string_view name)
+        {
+            const size_t hash = Hash(name);
+            {
+                std::shared_lock lock(m_mutex);
+                const uint32_t symbol = Find(name, hash);
+                if (symbol != Empty)
+                {
+                    return symbol;
+                }
+            }
+
+            std::unique_lock lock(m_mutex);
+            const uint32_t symbol = Find(name, hash); // could be added by another thread meanwhile
+            return symbol != Empty ? symbol : Insert(name, hash);
+        }
+
+        std::string_view Name(uint32_t symbol)
+        {
+            std::shared_lock lock(m_mutex);
+            return m_entries[symbol].m_name;
+        }
+
+        size_t Size()
+        {
+            std::shared_lock lock(m_mutex);
+            return m_entries.size();
+        }
+
+    private:
+        static constexpr uint32_t Empty = ~0u;
+
+        struct Entry
+        {
+            std::string m_name;
+            size_t m_hash;
+        };
+
+        static size_t Hash(std::string_view name)
+        {
+            return std::hash<std::string_view>()(name);
+        }
+
+        uint32_t Find(std::string_view name, size_t hash) const
+        {
+            if (m_slots.empty())
+            {
+                return Empty;
+            }
+
+            const size_t mask = m_slots.size() - 1;
+            for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+            {
+                const uint32_t symbol = m_slots[slot];
+                if (symbol == Empty || (m_entries[symbol].m_hash == hash && m_entries[symbol].m_name == name))
+                {
+                    return symbol;
+                }
+            }
+        }
+
+        uint32_t Insert(std::string_view name, size_t hash)
+        {
+            assert(m_entries.size() < SymbolTable::MaxSymbols);
+            if ((m_entries.size() + 1) * 2 > m_slots.size())
+            {
+                Grow();
+            }
+
+            const uint32_t symbol = static_cast<uint32_t>(m_entries.size());
+            m_entries.push_back({ std::string(name), hash });
+            Place(symbol);
+            return symbol;
+        }
+
+        void Grow()
+        {
+            m_slots.assign(std::max<size_t>(256, m_slots.size() * 2), Empty);
+            for (uint32_t symbol = 0; symbol < m_entries.size(); ++symbol)
+            {
+                Place(symbol);
+            }
+        }
+
+        void Place(uint32_t symbol)
+        {
+            const size_t mask = m_slots.size() - 1;
+            size_t slot = m_entries[symbol].m_hash & mask;
+            while (m_slots[slot] != Empty)
+            {
+                slot = (slot + 1) & mask;
+            }
+            m_slots[slot] = symbol;
+        }
+
+        std::shared_mutex m_mutex;
+        std::deque<Entry> m_entries; // a deque doesn't move names, so views returned by Name stay valid
+        std::vector<uint32_t> m_slots;
+    };
+
+    Symbols& GetSymbols()
+    {
+        static Symbols symbols;
+        return symbols;
+    }
+}
+
+uint32_t SymbolTable::Intern(std::string_view name)
+{
+    return GetSymbols().Intern(name);
+}
+
+std::string_view SymbolTable::Name(uint32_t symbol)
+{
+    return GetSymbols().Name(symbol);
+}
+
+size_t SymbolTable::Size()
+{
+    return GetSymbols().Size();
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// identifiers interned to small dense ids, shared by all threads for the lifetime of the process.
+// the scanner interns every name, so environments, classes and the resolver compare and hash integers
+// instead of strings and don't keep copies of the names.
+class SymbolTable
+{
+public:
+    static constexpr uint32_t None = 0; // id of tokens which aren't names
+    static constexpr uint32_t This = 1;
+    static constexpr uint32_t Super = 2;
+    static constexpr uint32_t MaxSymbols = 1u << 24; // ids are stored in 24 bits of a token
+
+    static uint32_t Intern(std::string_view name);
+    static std::string_view Name(uint32_t symbol);
+    static size_t Size();
+};
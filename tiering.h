@@ -0,0 +1,20 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct IStatement;
+using IStatementPtr = std::unique_ptr<const IStatement>;
+
+// calls of a function or lambda body and its optimized copy, compiled on the worker thread of CompilationQueue
+struct Tiering
+{
+    using BodyType = std::vector<IStatementPtr>;
+
+    uint32_t m_callsCount = 0; // the counters are only used by the interpreter thread
+    bool m_queued = false;
+    std::unique_ptr<const BodyType> m_optimizedBody; // written by the worker before it is published
+    std::atomic<const BodyType*> m_optimized = nullptr;
+};
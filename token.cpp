@@ -1,4 +1,5 @@
 #include "token.h"
+#include <charconv>
 
 std::string_view TokenTypeToStringView(Token::Type tokenType)
 {
@@ -10,6 +11,7 @@ std::string_view TokenTypeToStringView(Token::Type tokenType)
         case Token::Type::ClosingBrace:         { static std::string str("}"); return str; }
         case Token::Type::Comma:                { static std::string str(","); return str; }
         case Token::Type::Dot:                  { static std::string str("."); return str; }
+        case Token::Type::DotDot:               { static std::string str(".."); return str; }
         case Token::Type::Minus:                { static std::string str("-"); return str; }
         case Token::Type::Plus:                 { static std::string str("+"); return str; }
         case Token::Type::Colon:                { static std::string str(":"); return str; }
@@ -47,6 +49,7 @@ std::string_view TokenTypeToStringView(Token::Type tokenType)
         case Token::Type::Fun:                  { static std::string str("fun"); return str; }
         case Token::Type::Var:                  { static std::string str("var"); return str; }
         case Token::Type::Class:                { static std::string str("class"); return str; }
+        case Token::Type::Final:                { static std::string str("final"); return str; }
         case Token::Type::This:                 { static std::string str("this"); return str; }
         case Token::Type::Super:                { static std::string str("super"); return str; }
         case Token::Type::Print:                { static std::string str("print"); return str; }
@@ -58,16 +61,32 @@ std::string_view TokenTypeToStringView(Token::Type tokenType)
     return str;
 }
 
+Value Token::LiteralValue() const
+{
+    if (m_type == Type::Number)
+    {
+        double value = 0.0;
+        std::from_chars(m_lexeme.data(), m_lexeme.data() + m_lexeme.size(), value); // validated by Scanner
+        return Value(value);
+    }
+    else if (m_type == Type::String)
+    {
+        return Value(std::string(m_lexeme.substr(1, m_lexeme.size() - 2))); // strip quotes
+    }
+
+    return Value();
+}
+
 std::ostream& operator<<(std::ostream& os, const Token& token)
 {
     os << TokenTypeToStringView(token.m_type) << " " << token.m_lexeme;
     if (token.m_type == Token::Type::Number)
     {
-        os << " " << *token.m_literalvalue.GetNumber();
+        os << " " << *token.LiteralValue().GetNumber();
     }
     else if (token.m_type == Token::Type::String)
     {
-        os << " " << *token.m_literalvalue.GetString();
+        os << " " << *token.LiteralValue().GetString();
     }
 
     return os;
@@ -1,11 +1,13 @@
 #pragma once
 
+#include <cstdint>
 #include <ostream>
 #include "value.h"
+#include "symboltable.h"
 
 struct Token
 {
-    enum class Type
+    enum class Type : uint8_t
     {
         OpeningParenthesis,         // '('
         ClosingParenthesis,         // ')'
@@ -13,6 +15,7 @@ struct Token
         ClosingBrace,               // '}'
         Comma,                      // ','
         Dot,                        // '.'
+        DotDot,                     // '..'
         Minus,                      // '-'
         Plus,                       // '+'
         Colon,                      // ':'
@@ -50,6 +53,7 @@ struct Token
         Fun,
         Var,
         Class,
+        Final,
         This,
         Super,
         Print,
@@ -57,19 +61,35 @@ struct Token
         EndOfFile
     };
 
-    Token(Type type, std::string_view lexeme, Value literalValue, int line)
-        : m_type(type)
-        , m_lexeme(lexeme)
-        , m_literalvalue(literalValue)
+    Token(Type type, std::string_view lexeme, int line)
+        : m_lexeme(lexeme)
         , m_line(line)
-    {}
+        , m_type(type)
+    {
+        if (type == Type::Identifier || type == Type::This || type == Type::Super)
+        {
+            const uint32_t symbol = SymbolTable::Intern(lexeme);
+            m_symbol[0] = static_cast<uint8_t>(symbol);
+            m_symbol[1] = static_cast<uint8_t>(symbol >> 8);
+            m_symbol[2] = static_cast<uint8_t>(symbol >> 16);
+        }
+    }
+
+    // value of a number or string literal, parsed from the lexeme on demand
+    Value LiteralValue() const;
+
+    // SymbolTable id of identifiers, 'this' and 'super', SymbolTable::None for other tokens
+    uint32_t Symbol() const { return m_symbol[0] | (m_symbol[1] << 8) | (m_symbol[2] << 16); }
 
-    Type m_type;
     std::string_view m_lexeme;
-    Value m_literalvalue;
     int m_line;
+    Type m_type;
+    uint8_t m_symbol[3] = {}; // fits into the padding after the type
 };
 
+// tokens don't own literal values, all the scanner keeps per token is the lexeme, line, type and symbol
+static_assert(sizeof(Token) <= 24);
+
 std::string_view TokenTypeToStringView(Token::Type tokenType);
 
 std::ostream& operator<<(std::ostream& os, const Token& token);
@@ -0,0 +1,585 @@
+#include "trace.h"
+#include "statementvisitor.h"
+#include "expressionvisitor.h"
+#include "statements.h"
+#include "expressions.h"
+#include "interpreter.h"
+#include "token.h"
+#include <unordered_map>
+
+namespace
+{
+    Environment* GetOwner(Environment& environment, uint32_t distance)
+    {
+        if (distance == ResolvedName::Global)
+        {
+            return environment.GetGlobalEnvironment().get();
+        }
+
+        Environment* owner = &environment;
+        for (uint32_t i = 0; i < distance && owner; ++i)
+        {
+            owner = owner->GetOuter().get();
+        }
+        return owner;
+    }
+}
+
+struct Trace::Recorder : IStatementVisitor, IExpressionVisitor
+{
+    struct Operand
+    {
+        uint32_t m_register;
+        Type m_type;
+        bool m_constant;
+    };
+
+    struct Context : IStatementVisitorContext, IExpressionVisitorContext
+    {
+        Context(Trace& trace, Environment& environment)
+            : m_trace(trace)
+            , m_environment(environment)
+        {}
+
+        Trace& m_trace;
+        Environment& m_environment;
+        std::vector<double> m_values; // observed by the recorded iteration
+        std::vector<Type> m_types;
+        std::unordered_map<const Token*, uint32_t> m_bodyLocals; // registers by declaration
+        uint32_t m_scopeOffset = 0; // 1 when the body has its own environment
+        size_t m_statement = 0;
+        bool m_inBranch = false;
+        bool m_handled = false;
+        bool m_broken = false; // a 'break' was recorded, the rest of the body isn't reached
+        Operand m_operand = {};
+    };
+
+    bool Record(const IExpression& expression, Context& context, Operand& operand) const
+    {
+        context.m_handled = false;
+        expression.Accept(*this, &context);
+        operand = context.m_operand;
+        return context.m_handled;
+    }
+
+    bool Record(const IStatement& statement, Context& context) const
+    {
+        context.m_handled = false;
+        statement.Accept(*this, &context);
+        return context.m_handled;
+    }
+
+    static Context& GetContext(IStatementVisitorContext* context)
+    {
+        return *static_cast<Context*>(context);
+    }
+
+    static Context& GetContext(IExpressionVisitorContext* context)
+    {
+        return *static_cast<Context*>(context);
+    }
+
+    static Operand NewRegister(Context& context, Type type, double value, bool constant)
+    {
+        const uint32_t index = static_cast<uint32_t>(context.m_values.size());
+        context.m_values.push_back(value);
+        context.m_types.push_back(type);
+        context.m_trace.m_registers.push_back(constant ? value : 0.0);
+        return Operand{ index, type, constant };
+    }
+
+    // runs the instruction on the observed values, operations on constants are folded to a constant
+    static bool Emit(Context& context, Instruction instruction, bool fold)
+    {
+        if (!Step(instruction, context.m_values.data()))
+        {
+            return false;
+        }
+
+        if (fold)
+        {
+            context.m_trace.m_registers[instruction.m_destination] = context.m_values[instruction.m_destination];
+        }
+        else
+        {
+            context.m_trace.m_instructions.push_back(instruction);
+        }
+        return true;
+    }
+
+    static bool Compute(Context& context, Operation operation, Type type, const Operand& left, const Operand& right)
+    {
+        const bool fold = left.m_constant && right.m_constant;
+        const Operand result = NewRegister(context, type, 0.0, fold);
+        if (!Emit(context, Instruction{ operation, result.m_register, left.m_register, right.m_register, static_cast<uint32_t>(context.m_statement) }, fold))
+        {
+            return false;
+        }
+
+        context.m_operand = result;
+        return true;
+    }
+
+    static bool ToType(const Value& value, Type& type, double& number)
+    {
+        if (const double* valueNumber = value.GetNumber())
+        {
+            type = Type::Number;
+            number = *valueNumber;
+            return true;
+        }
+        else if (const bool* boolean = value.GetBoolean())
+        {
+            type = Type::Boolean;
+            number = *boolean;
+            return true;
+        }
+        return false;
+    }
+
+    // register holding the variable, slots are loaded once per trace entry
+    static bool FindVariable(Context& context, const Token& name, const ResolvedName& resolved, Operand& operand, Slot** slot)
+    {
+        if (resolved.m_distance == ResolvedName::Unresolved || resolved.m_distance == ResolvedName::Inlined)
+        {
+            return false;
+        }
+
+        if (resolved.m_distance != ResolvedName::Global && resolved.m_distance < context.m_scopeOffset)
+        {
+            auto local = context.m_bodyLocals.find(resolved.m_declaration);
+            if (local == context.m_bodyLocals.end())
+            {
+                return false;
+            }
+            operand = Operand{ local->second, context.m_types[local->second], false };
+            return true;
+        }
+
+        const uint32_t distance = resolved.m_distance == ResolvedName::Global ? ResolvedName::Global : resolved.m_distance - context.m_scopeOffset;
+        for (Slot& existing : context.m_trace.m_slots)
+        {
+            if (existing.m_distance == distance && existing.m_symbol == name.Symbol())
+            {
+                operand = Operand{ existing.m_register, existing.m_type, false };
+                *slot = &existing;
+                return true;
+            }
+        }
+
+        Environment* owner = GetOwner(context.m_environment, distance);
+        const Value* value = owner ? owner->FindLocal(name.Symbol()) : nullptr;
+        Type type;
+        double number;
+        if (!value || !ToType(*value, type, number))
+        {
+            return false;
+        }
+
+        operand = NewRegister(context, type, number, false);
+        context.m_trace.m_slots.push_back(Slot{ distance, name.Symbol(), operand.m_register, type });
+        *slot = &context.m_trace.m_slots.back();
+        return true;
+    }
+
+    virtual void VisitExpressionStatement(const ExpressionStatement& statement, IStatementVisitorContext* context) const override
+    {
+        Context& recorderContext = GetContext(context);
+        const AssignmentExpression* assignment = dynamic_cast<const AssignmentExpression*>(statement.m_expression.get());
+        Operand value;
+        if (!assignment || !Record(*assignment->m_expression, recorderContext, value))
+        {
+            return;
+        }
+
+        Operand target;
+        Slot* slot = nullptr;
+        if (!FindVariable(recorderContext, assignment->m_name, assignment->m_resolved, target, &slot) || target.m_type != value.m_type)
+        {
+            return;
+        }
+
+        if (slot)
+        {
+            slot->m_written = true;
+        }
+        recorderContext.m_handled = Emit(recorderContext, Instruction{ Operation::Move, target.m_register, value.m_register }, false);
+    }
+
+    virtual void VisitVariableDeclarationStatement(const VariableDeclarationStatement& statement, IStatementVisitorContext* context) const override
+    {
+        Context& recorderContext = GetContext(context);
+        Operand value;
+        if (recorderContext.m_inBranch || recorderContext.m_scopeOffset == 0 || !statement.m_initializer || !Record(*statement.m_initializer, recorderContext, value))
+        {
+            return;
+        }
+
+        const Operand local = NewRegister(recorderContext, value.m_type, 0.0, false);
+        recorderContext.m_bodyLocals[&statement.m_name] = local.m_register;
+        recorderContext.m_trace.m_locals.push_back(Local{ statement.m_name.Symbol(), local.m_register, local.m_type, recorderContext.m_statement });
+        recorderContext.m_handled = Emit(recorderContext, Instruction{ Operation::Move, local.m_register, value.m_register }, false);
+    }
+
+    // the recorded branch is guarded, branches are statements without declarations and side exits
+    virtual void VisitIfStatement(const IfStatement& statement, IStatementVisitorContext* context) const override
+    {
+        Context& recorderContext = GetContext(context);
+        Operand condition;
+        if (recorderContext.m_inBranch || !Record(*statement.m_condition, recorderContext, condition) || condition.m_type != Type::Boolean)
+        {
+            return;
+        }
+
+        const bool taken = recorderContext.m_values[condition.m_register] != 0.0;
+        if (!condition.m_constant)
+        {
+            Emit(recorderContext, Instruction{ taken ? Operation::GuardTrue : Operation::GuardFalse, 0, condition.m_register, 0, static_cast<uint32_t>(recorderContext.m_statement) }, false);
+        }
+
+        const IStatement* branch = taken ? statement.m_trueBranch.get() : statement.m_falseBranch.get();
+        if (!branch)
+        {
+            recorderContext.m_handled = true;
+            return;
+        }
+
+        std::vector<const IStatement*> statements = { branch };
+        if (const BlockStatement* block = dynamic_cast<const BlockStatement*>(branch))
+        {
+            if (block->m_hasScope)
+            {
+                return;
+            }
+
+            statements.clear();
+            for (const IStatementPtr& blockStatement : block->m_block)
+            {
+                statements.push_back(blockStatement.get());
+            }
+        }
+
+        recorderContext.m_inBranch = true;
+        for (const IStatement* branchStatement : statements)
+        {
+            if (!Record(*branchStatement, recorderContext))
+            {
+                return;
+            }
+            else if (recorderContext.m_broken)
+            {
+                break;
+            }
+        }
+        recorderContext.m_inBranch = false;
+        recorderContext.m_handled = true;
+    }
+
+    virtual void VisitBreakStatement(const BreakStatement& statement, IStatementVisitorContext* context) const override
+    {
+        Context& recorderContext = GetContext(context);
+        recorderContext.m_trace.m_instructions.push_back(Instruction{ Operation::Break });
+        recorderContext.m_broken = true;
+        recorderContext.m_handled = true;
+    }
+
+    virtual void VisitUnaryExpression(const UnaryExpression& unaryExpression, IExpressionVisitorContext* context) const override
+    {
+        Context& recorderContext = GetContext(context);
+        Operand operand;
+        if (!Record(*unaryExpression.m_expression, recorderContext, operand))
+        {
+            return;
+        }
+
+        recorderContext.m_handled = false;
+        switch (unaryExpression.m_operator.m_type)
+        {
+        case Token::Type::Minus:
+        {
+            if (operand.m_type == Type::Number)
+            {
+                recorderContext.m_handled = Compute(recorderContext, Operation::Negate, Type::Number, operand, operand);
+            }
+        } break;
+        case Token::Type::Plus:
+        {
+            recorderContext.m_operand = operand;
+            recorderContext.m_handled = operand.m_type == Type::Number;
+        } break;
+        case Token::Type::Bang:
+        {
+            if (operand.m_type == Type::Boolean)
+            {
+                recorderContext.m_handled = Compute(recorderContext, Operation::Not, Type::Boolean, operand, operand);
+            }
+        } break;
+        default: break;
+        }
+    }
+
+    virtual void VisitBinaryExpression(const BinaryExpression& binaryExpression, IExpressionVisitorContext* context) const override
+    {
+        Context& recorderContext = GetContext(context);
+        Operand left;
+        Operand right;
+        if (!Record(*binaryExpression.m_left, recorderContext, left) || !Record(*binaryExpression.m_right, recorderContext, right) || left.m_type != right.m_type)
+        {
+            recorderContext.m_handled = false;
+            return;
+        }
+
+        const bool numbers = left.m_type == Type::Number;
+        recorderContext.m_handled = false;
+        switch (binaryExpression.m_operator.m_type)
+        {
+        case Token::Type::Plus:         if (numbers) recorderContext.m_handled = Compute(recorderContext, Operation::Add, Type::Number, left, right); break;
+        case Token::Type::Minus:        if (numbers) recorderContext.m_handled = Compute(recorderContext, Operation::Subtract, Type::Number, left, right); break;
+        case Token::Type::Star:         if (numbers) recorderContext.m_handled = Compute(recorderContext, Operation::Multiply, Type::Number, left, right); break;
+        case Token::Type::Slash:
+        {
+            // a side exit can't follow the writes of a branch
+            if (numbers && (!recorderContext.m_inBranch || right.m_constant))
+            {
+                recorderContext.m_handled = Compute(recorderContext, Operation::Divide, Type::Number, left, right);
+            }
+        } break;
+        case Token::Type::Less:         if (numbers) recorderContext.m_handled = Compute(recorderContext, Operation::Less, Type::Boolean, left, right); break;
+        case Token::Type::LessEqual:    if (numbers) recorderContext.m_handled = Compute(recorderContext, Operation::LessEqual, Type::Boolean, left, right); break;
+        case Token::Type::Greater:      if (numbers) recorderContext.m_handled = Compute(recorderContext, Operation::Greater, Type::Boolean, left, right); break;
+        case Token::Type::GreaterEqual: if (numbers) recorderContext.m_handled = Compute(recorderContext, Operation::GreaterEqual, Type::Boolean, left, right); break;
+        case Token::Type::EqualEqual:   recorderContext.m_handled = Compute(recorderContext, Operation::Equal, Type::Boolean, left, right); break;
+        case Token::Type::BangEqual:    recorderContext.m_handled = Compute(recorderContext, Operation::NotEqual, Type::Boolean, left, right); break;
+        default: break;
+        }
+    }
+
+    virtual void VisitTernaryConditionalExpression(const TernaryConditionalExpression& ternaryConditionalExpression, IExpressionVisitorContext* context) const override
+    {
+        Context& recorderContext = GetContext(context);
+        Operand condition;
+        Operand trueBranch;
+        Operand falseBranch;
+        if (!Record(*ternaryConditionalExpression.m_condition, recorderContext, condition) || condition.m_type != Type::Boolean
+            || !Record(*ternaryConditionalExpression.m_trueBranch, recorderContext, trueBranch)
+            || !Record(*ternaryConditionalExpression.m_falseBranch, recorderContext, falseBranch) || trueBranch.m_type != falseBranch.m_type)
+        {
+            recorderContext.m_handled = false;
+            return;
+        }
+
+        if (condition.m_constant)
+        {
+            recorderContext.m_operand = recorderContext.m_values[condition.m_register] != 0.0 ? trueBranch : falseBranch;
+            recorderContext.m_handled = true;
+            return;
+        }
+
+        const Operand result = NewRegister(recorderContext, trueBranch.m_type, 0.0, false);
+        recorderContext.m_handled = Emit(recorderContext, Instruction{ Operation::Select, result.m_register, trueBranch.m_register, falseBranch.m_register, condition.m_register }, false);
+        recorderContext.m_operand = result;
+    }
+
+    virtual void VisitGroupingExpression(const GroupingExpression& groupingExpression, IExpressionVisitorContext* context) const override
+    {
+        Context& recorderContext = GetContext(context);
+        Record(*groupingExpression.m_expression, recorderContext, recorderContext.m_operand);
+    }
+
+    virtual void VisitLiteralExpression(const LiteralExpression& literalExpression, IExpressionVisitorContext* context) const override
+    {
+        Context& recorderContext = GetContext(context);
+        Type type;
+        double number;
+        if (ToType(literalExpression.m_value, type, number))
+        {
+            recorderContext.m_operand = NewRegister(recorderContext, type, number, true);
+            recorderContext.m_handled = true;
+        }
+    }
+
+    virtual void VisitVariableExpression(const VariableExpression& variableExpression, IExpressionVisitorContext* context) const override
+    {
+        Context& recorderContext = GetContext(context);
+        Type type;
+        double number;
+        if (variableExpression.m_resolved.m_constant && ToType(*variableExpression.m_resolved.m_constant, type, number))
+        {
+            recorderContext.m_operand = NewRegister(recorderContext, type, number, true);
+            recorderContext.m_handled = true;
+            return;
+        }
+
+        Slot* slot = nullptr;
+        recorderContext.m_handled = FindVariable(recorderContext, variableExpression.m_name, variableExpression.m_resolved, recorderContext.m_operand, &slot);
+    }
+
+    virtual void VisitLogicalExpression(const LogicalExpression& logicalExpression, IExpressionVisitorContext* context) const override
+    {
+        Context& recorderContext = GetContext(context);
+        Operand left;
+        Operand right;
+        if (!Record(*logicalExpression.m_left, recorderContext, left) || !Record(*logicalExpression.m_right, recorderContext, right)
+            || left.m_type != Type::Boolean || right.m_type != Type::Boolean)
+        {
+            recorderContext.m_handled = false;
+            return;
+        }
+
+        const Operation operation = logicalExpression.m_operator.m_type == Token::Type::Or ? Operation::Or : Operation::And;
+        recorderContext.m_handled = Compute(recorderContext, operation, Type::Boolean, left, right);
+    }
+};
+
+std::unique_ptr<const Trace> Trace::Record(const WhileStatement& loop, Environment& environment)
+{
+    std::unique_ptr<Trace> trace(new Trace());
+    Recorder recorder;
+    Recorder::Context context(*trace, environment);
+
+    Recorder::Operand condition;
+    if (!recorder.Record(*loop.m_condition, context, condition) || condition.m_type != Type::Boolean
+        || !Recorder::Emit(context, Instruction{ Operation::LoopCondition, 0, condition.m_register }, false))
+    {
+        return nullptr;
+    }
+
+    std::vector<const IStatement*> body = { loop.m_body.get() };
+    if (const BlockStatement* block = dynamic_cast<const BlockStatement*>(loop.m_body.get()))
+    {
+        context.m_scopeOffset = block->m_hasScope ? 1 : 0;
+        body.clear();
+        for (const IStatementPtr& statement : block->m_block)
+        {
+            body.push_back(statement.get());
+        }
+    }
+
+    for (size_t i = 0; i < body.size() && !context.m_broken; ++i)
+    {
+        context.m_statement = i;
+        if (!recorder.Record(*body[i], context))
+        {
+            return nullptr;
+        }
+    }
+
+    return trace;
+}
+
+Trace::Exit Trace::Execute(Environment& environment) const
+{
+    // the type guards of the variables are hoisted out of the loop
+    std::vector<Value*> slots(m_slots.size());
+    std::vector<double> registers = m_registers;
+    for (size_t i = 0; i < m_slots.size(); ++i)
+    {
+        const Slot& slot = m_slots[i];
+        Environment* owner = GetOwner(environment, slot.m_distance);
+        slots[i] = owner ? owner->FindLocal(slot.m_symbol) : nullptr;
+        const double* number = slots[i] ? slots[i]->GetNumber() : nullptr;
+        const bool* boolean = slots[i] ? slots[i]->GetBoolean() : nullptr;
+        if (slot.m_type == Type::Number ? !number : !boolean)
+        {
+            ++m_sideExits;
+            return Exit{ ExitReason::EntryGuard };
+        }
+        registers[slot.m_register] = number ? *number : *boolean;
+    }
+
+    Exit exit = Run(registers);
+
+    for (size_t i = 0; i < m_slots.size(); ++i)
+    {
+        if (m_slots[i].m_written)
+        {
+            *slots[i] = ToValue(registers[m_slots[i].m_register], m_slots[i].m_type);
+        }
+    }
+
+    if (exit.m_reason == ExitReason::SideExit)
+    {
+        ++m_sideExits;
+        for (const Local& local : m_locals)
+        {
+            if (local.m_statement < exit.m_statement)
+            {
+                exit.m_locals.emplace_back(local.m_symbol, ToValue(registers[local.m_register], local.m_type));
+            }
+        }
+    }
+    return exit;
+}
+
+bool Trace::IsProfitable() const
+{
+    return m_sideExits <= MaxSideExits || m_sideExits * 16 <= m_iterations;
+}
+
+Trace::Exit Trace::Run(std::vector<double>& registers) const
+{
+    double* values = registers.data();
+    const Instruction* begin = m_instructions.data();
+    const Instruction* end = begin + m_instructions.size();
+    for (const Instruction* instruction = begin; ; ++instruction)
+    {
+        if (instruction == end)
+        {
+            instruction = begin;
+            ++m_iterations;
+        }
+
+        if (!Step(*instruction, values))
+        {
+            switch (instruction->m_operation)
+            {
+            case Operation::LoopCondition:  return Exit{ ExitReason::LoopEnd };
+            case Operation::Break:          return Exit{ ExitReason::Break };
+            default:                        return Exit{ ExitReason::SideExit, instruction->m_extra };
+            }
+        }
+    }
+}
+
+bool Trace::Step(const Instruction& instruction, double* registers)
+{
+    double& destination = registers[instruction.m_destination];
+    const double left = registers[instruction.m_left];
+    const double right = registers[instruction.m_right];
+    switch (instruction.m_operation)
+    {
+    case Operation::Move:           destination = left; return true;
+    case Operation::Negate:         destination = -left; return true;
+    case Operation::Not:            destination = left == 0.0; return true;
+    case Operation::Add:            destination = left + right; return true;
+    case Operation::Subtract:       destination = left - right; return true;
+    case Operation::Multiply:       destination = left * right; return true;
+    case Operation::Divide:
+    {
+        if (right == 0.0)
+        {
+            return false;
+        }
+        destination = left / right;
+    } return true;
+    case Operation::Less:           destination = left < right; return true;
+    case Operation::LessEqual:      destination = left <= right; return true;
+    case Operation::Greater:        destination = left > right; return true;
+    case Operation::GreaterEqual:   destination = left >= right; return true;
+    case Operation::Equal:          destination = left == right; return true;
+    case Operation::NotEqual:       destination = left != right; return true;
+    case Operation::And:            destination = left != 0.0 && right != 0.0; return true;
+    case Operation::Or:             destination = left != 0.0 || right != 0.0; return true;
+    case Operation::Select:         destination = registers[instruction.m_extra] != 0.0 ? left : right; return true;
+    case Operation::LoopCondition:  return left != 0.0;
+    case Operation::GuardTrue:      return left != 0.0;
+    case Operation::GuardFalse:     return left == 0.0;
+    case Operation::Break:          return false;
+    }
+    return false;
+}
+
+Value Trace::ToValue(double value, Type type)
+{
+    return type == Type::Number ? Value(value) : Value(value != 0.0);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "value.h"
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+struct Environment;
+struct WhileStatement;
+
+// linear code of an iteration of a hot 'while' loop, recorded from the iteration about to run.
+// loops computing numbers and booleans without calls, prints or nested loops are traced: the variables are
+// loaded into registers after their types are checked once on entry, the recorded branch of each top-level 'if'
+// is guarded, literal subexpressions are folded and the registers are stored to the variables when the trace exits.
+// a failed guard exits before its statement, so the interpreter completes the iteration from that statement on.
+class Trace
+{
+public:
+    static constexpr uint32_t HotLoopIterations = 100;
+    static constexpr uint64_t MaxSideExits = 64; // more are tolerated only when they are rare
+
+    enum class ExitReason
+    {
+        EntryGuard, // the variables don't have the recorded types, nothing was executed
+        LoopEnd,
+        Break,
+        SideExit
+    };
+
+    struct Exit
+    {
+        ExitReason m_reason;
+        size_t m_statement = 0; // of the loop body the interpreter continues from
+        std::vector<std::pair<uint32_t, Value>> m_locals; // body locals declared before that statement, by symbol
+    };
+
+    // returns nullptr when the loop can't be traced
+    static std::unique_ptr<const Trace> Record(const WhileStatement& loop, Environment& environment);
+
+    Exit Execute(Environment& environment) const;
+    bool IsProfitable() const;
+
+private:
+    enum class Operation : uint8_t
+    {
+        Move,
+        Negate,
+        Not,
+        Add,
+        Subtract,
+        Multiply,
+        Divide, // exits before its statement on division by zero
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        Equal,
+        NotEqual,
+        And,
+        Or,
+        Select, // m_extra holds the condition
+        LoopCondition,
+        GuardTrue,
+        GuardFalse,
+        Break
+    };
+
+    enum class Type : uint8_t
+    {
+        Number,
+        Boolean
+    };
+
+    // registers hold numbers and booleans as doubles
+    struct Instruction
+    {
+        Operation m_operation;
+        uint32_t m_destination = 0;
+        uint32_t m_left = 0;
+        uint32_t m_right = 0;
+        uint32_t m_extra = 0; // statement of the side exit or the condition of a select
+    };
+
+    // variable of the environment of the loop or of its ancestors
+    struct Slot
+    {
+        uint32_t m_distance;
+        uint32_t m_symbol;
+        uint32_t m_register;
+        Type m_type;
+        bool m_written = false;
+    };
+
+    struct Local
+    {
+        uint32_t m_symbol;
+        uint32_t m_register;
+        Type m_type;
+        size_t m_statement; // of its declaration
+    };
+
+    struct Recorder;
+
+    Exit Run(std::vector<double>& registers) const;
+    // executes the instruction, returns false when the trace exits at it
+    static bool Step(const Instruction& instruction, double* registers);
+    static Value ToValue(double value, Type type);
+
+    std::vector<Instruction> m_instructions;
+    std::vector<double> m_registers; // constants are set, variables are loaded on entry
+    std::vector<Slot> m_slots;
+    std::vector<Local> m_locals;
+    mutable uint64_t m_iterations = 0;
+    mutable uint64_t m_sideExits = 0;
+};
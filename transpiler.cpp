@@ -0,0 +1,597 @@
+#include "transpiler.h"
+#include "statementvisitor.h"
+#include "expressionvisitor.h"
+#include "statements.h"
+#include "expressions.h"
+#include "token.h"
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+
+namespace
+{
+    std::string MakeStringLiteral(std::string_view text)
+    {
+        std::ostringstream literal;
+        literal << '"';
+        for (const char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                literal << '\\' << c;
+            }
+            else if (c >= ' ' && c <= '~')
+            {
+                literal << c;
+            }
+            else
+            {
+                literal << '\\' << std::oct << std::setw(3) << std::setfill('0') << static_cast<unsigned>(static_cast<unsigned char>(c)) << std::dec;
+            }
+        }
+        literal << '"';
+        return literal.str();
+    }
+
+    struct TopLevelFunction
+    {
+        std::string m_name; // of the C++ function
+        size_t m_arity;
+    };
+
+    struct TranspilerContext : IStatementVisitorContext, IExpressionVisitorContext
+    {
+        std::string m_expression; // C++ expression of the last visited expression
+        std::ostringstream* m_code = nullptr; // body of the C++ function being written
+        int m_indent = 1;
+        int m_depth = 0; // number of enclosing blocks and functions
+        bool m_unsupported = false;
+
+        std::vector<std::string> m_tokens; // initializers of the tokens runtime errors are reported at
+        std::vector<std::string> m_constants;
+        std::map<std::string_view, std::string> m_globals; // by name, sorted to keep the output stable
+        std::unordered_map<const Token*, std::string> m_locals; // by declaration
+        std::unordered_map<const FunctionDeclarationStatement*, TopLevelFunction> m_functions;
+        std::unordered_map<std::string_view, const FunctionDeclarationStatement*> m_declaredOnce; // top-level functions called directly
+        std::ostringstream m_declarations;
+        std::ostringstream m_definitions;
+    };
+
+    TranspilerContext& GetTranspilerContext(IStatementVisitorContext* context)
+    {
+        return *static_cast<TranspilerContext*>(context);
+    }
+
+    TranspilerContext& GetTranspilerContext(IExpressionVisitorContext* context)
+    {
+        return *static_cast<TranspilerContext*>(context);
+    }
+
+    struct CodeGenerator : IStatementVisitor, IExpressionVisitor
+    {
+        std::string Generate(const IExpression& expression, TranspilerContext& context) const
+        {
+            context.m_expression.clear();
+            expression.Accept(*this, &context);
+            return std::move(context.m_expression);
+        }
+
+        void Generate(const IStatement& statement, TranspilerContext& context) const
+        {
+            statement.Accept(*this, &context);
+        }
+
+        // statements are always braced, so C++ scopes follow the scopes of the programm
+        void GenerateBlock(const std::vector<IStatementPtr>& statements, TranspilerContext& context) const
+        {
+            Line(context) << "{\n";
+            ++context.m_indent;
+            ++context.m_depth;
+            for (const IStatementPtr& statement : statements)
+            {
+                Generate(*statement, context);
+            }
+            --context.m_depth;
+            --context.m_indent;
+            Line(context) << "}\n";
+        }
+
+        void GenerateBlock(const IStatement& statement, TranspilerContext& context) const
+        {
+            if (const BlockStatement* block = dynamic_cast<const BlockStatement*>(&statement))
+            {
+                GenerateBlock(block->m_block, context);
+                return;
+            }
+
+            Line(context) << "{\n";
+            ++context.m_indent;
+            ++context.m_depth;
+            Generate(statement, context);
+            --context.m_depth;
+            --context.m_indent;
+            Line(context) << "}\n";
+        }
+
+        void GenerateFunction(const FunctionDeclarationStatement& declaration, const TopLevelFunction& function, TranspilerContext& context) const
+        {
+            const size_t arity = declaration.m_parameters.size();
+            context.m_declarations << "    Value " << function.m_name << "(Runtime::Arguments<" << arity << ">&& arguments);\n";
+            context.m_declarations << "    const Runtime::CompiledFunction " << function.m_name << "_callable(" << MakeStringLiteral(declaration.m_name.m_lexeme) << ", " << arity
+                << ", [](const std::vector<Value>& arguments) { return " << function.m_name << "({";
+            for (size_t i = 0; i < arity; ++i)
+            {
+                context.m_declarations << (i > 0 ? ", " : " ") << "arguments[" << i << "]";
+            }
+            context.m_declarations << (arity > 0 ? " " : "") << "}); });\n";
+
+            std::ostringstream body;
+            std::ostringstream* code = context.m_code;
+            context.m_code = &body;
+            body << "    Value " << function.m_name << "(Runtime::Arguments<" << arity << ">&& arguments)\n    {\n";
+            context.m_indent = 2;
+            ++context.m_depth;
+            for (size_t i = 0; i < arity; ++i)
+            {
+                Line(context) << "Value " << Local(declaration.m_parameters[i].get(), context) << " = std::move(arguments[" << i << "]);\n";
+            }
+            for (const IStatementPtr& statement : declaration.m_body)
+            {
+                Generate(*statement, context);
+            }
+            Line(context) << "return Value();\n";
+            body << "    }\n\n";
+            --context.m_depth;
+            context.m_indent = 1;
+            context.m_code = code;
+
+            context.m_definitions << body.str();
+        }
+
+        static std::ostream& Line(TranspilerContext& context)
+        {
+            return *context.m_code << std::string(context.m_indent * 4, ' ');
+        }
+
+        // every declaration gets its own C++ variable, so a shadowing declaration can't refer to itself by the shadowed name
+        static const std::string& Local(const Token& declaration, TranspilerContext& context)
+        {
+            std::string& local = context.m_locals[&declaration];
+            if (local.empty())
+            {
+                local = "v_" + std::string(declaration.m_lexeme) + "_" + std::to_string(context.m_locals.size() - 1);
+            }
+            return local;
+        }
+
+        static const std::string& Local(const Token& name, const ResolvedName& resolved, TranspilerContext& context)
+        {
+            return Local(resolved.m_declaration ? *resolved.m_declaration : name, context);
+        }
+
+        static std::string& Global(const Token& name, TranspilerContext& context)
+        {
+            std::string& global = context.m_globals[name.m_lexeme];
+            if (global.empty())
+            {
+                global = "g_" + std::string(name.m_lexeme);
+            }
+            return global;
+        }
+
+        static std::string TokenReference(const Token& token, TranspilerContext& context)
+        {
+            std::ostringstream initializer;
+            initializer << "Token(static_cast<Token::Type>(" << static_cast<int>(token.m_type) << "), " << MakeStringLiteral(token.m_lexeme) << ", " << token.m_line << ")";
+            context.m_tokens.push_back(initializer.str());
+            return "tokens[" + std::to_string(context.m_tokens.size() - 1) + "]";
+        }
+
+        static std::string ConstantReference(const Value& value, TranspilerContext& context)
+        {
+            std::ostringstream initializer;
+            if (const double* number = value.GetNumber())
+            {
+                initializer << "Value(" << std::hexfloat << *number << ")";
+            }
+            else if (const std::string* string = value.GetString())
+            {
+                initializer << "Value(std::string(" << MakeStringLiteral(*string) << ", " << string->size() << "))";
+            }
+            else if (const bool* boolean = value.GetBoolean())
+            {
+                initializer << "Value(" << (*boolean ? "true" : "false") << ")";
+            }
+            else
+            {
+                initializer << "Value()";
+            }
+            context.m_constants.push_back(initializer.str());
+            return "constants[" + std::to_string(context.m_constants.size() - 1) + "]";
+        }
+
+        static bool IsGlobal(const ResolvedName& resolved)
+        {
+            return resolved.m_distance == ResolvedName::Global;
+        }
+
+        virtual void VisitExpressionStatement(const ExpressionStatement& statement, IStatementVisitorContext* context) const override
+        {
+            TranspilerContext& transpilerContext = GetTranspilerContext(context);
+            const std::string expression = Generate(*statement.m_expression, transpilerContext);
+            Line(transpilerContext) << expression << ";\n";
+        }
+
+        virtual void VisitPrintStatement(const PrintStatement& statement, IStatementVisitorContext* context) const override
+        {
+            TranspilerContext& transpilerContext = GetTranspilerContext(context);
+            const std::string expression = Generate(*statement.m_expression, transpilerContext);
+            Line(transpilerContext) << "runtime->Print(" << expression << ");\n";
+        }
+
+        virtual void VisitVariableDeclarationStatement(const VariableDeclarationStatement& statement, IStatementVisitorContext* context) const override
+        {
+            TranspilerContext& transpilerContext = GetTranspilerContext(context);
+            const std::string initializer = statement.m_initializer ? Generate(*statement.m_initializer, transpilerContext) : "Value()";
+            if (transpilerContext.m_depth == 0)
+            {
+                Line(transpilerContext) << "runtime->Define(" << Global(statement.m_name, transpilerContext) << ", " << initializer << ");\n";
+            }
+            else
+            {
+                Line(transpilerContext) << "Value " << Local(statement.m_name, transpilerContext) << " = " << initializer << ";\n";
+            }
+        }
+
+        virtual void VisitFunctionDeclarationStatement(const FunctionDeclarationStatement& statement, IStatementVisitorContext* context) const override
+        {
+            TranspilerContext& transpilerContext = GetTranspilerContext(context);
+            auto function = transpilerContext.m_functions.find(&statement);
+            if (transpilerContext.m_depth > 0 || function == transpilerContext.m_functions.end())
+            {
+                transpilerContext.m_unsupported = true; // closures need environments
+                return;
+            }
+
+            GenerateFunction(statement, function->second, transpilerContext);
+            Line(transpilerContext) << "runtime->Define(" << Global(statement.m_name, transpilerContext) << ", Value(&" << function->second.m_name << "_callable));\n";
+        }
+
+        virtual void VisitClassDeclarationStatement(const ClassDeclarationStatement& statement, IStatementVisitorContext* context) const override
+        {
+            GetTranspilerContext(context).m_unsupported = true;
+        }
+
+        virtual void VisitBlockStatement(const BlockStatement& statement, IStatementVisitorContext* context) const override
+        {
+            GenerateBlock(statement.m_block, GetTranspilerContext(context));
+        }
+
+        virtual void VisitIfStatement(const IfStatement& statement, IStatementVisitorContext* context) const override
+        {
+            TranspilerContext& transpilerContext = GetTranspilerContext(context);
+            const std::string condition = Generate(*statement.m_condition, transpilerContext);
+            Line(transpilerContext) << "if ((" << condition << ").IsTruthy())\n";
+            GenerateBlock(*statement.m_trueBranch, transpilerContext);
+            if (statement.m_falseBranch)
+            {
+                Line(transpilerContext) << "else\n";
+                GenerateBlock(*statement.m_falseBranch, transpilerContext);
+            }
+        }
+
+        virtual void VisitWhileStatement(const WhileStatement& statement, IStatementVisitorContext* context) const override
+        {
+            TranspilerContext& transpilerContext = GetTranspilerContext(context);
+            const std::string condition = Generate(*statement.m_condition, transpilerContext);
+            Line(transpilerContext) << "while ((" << condition << ").IsTruthy())\n";
+            GenerateBlock(*statement.m_body, transpilerContext);
+        }
+
+        // the increment follows the body, 'break' leaves the C++ loop as there is no 'continue'
+        virtual void VisitForStatement(const ForStatement& statement, IStatementVisitorContext* context) const override
+        {
+            TranspilerContext& transpilerContext = GetTranspilerContext(context);
+            Line(transpilerContext) << "{\n";
+            ++transpilerContext.m_indent;
+            ++transpilerContext.m_depth;
+            if (statement.m_initializer)
+            {
+                Generate(*statement.m_initializer, transpilerContext);
+            }
+
+            // the end of a range is evaluated once, the counter is advanced while it holds a number
+            std::string condition;
+            std::string increment;
+            if (statement.m_rangeEnd)
+            {
+                const std::string comparison = TokenReference(*statement.m_comparison, transpilerContext);
+                const std::string counter = Local(*statement.m_counter, transpilerContext);
+                const std::string rangeEnd = Generate(*statement.m_rangeEnd, transpilerContext);
+                Line(transpilerContext) << "const double rangeEnd = Runtime::Number(" << comparison << ", " << rangeEnd << ");\n";
+                condition = "Value(Runtime::Number(" + comparison + ", " + counter + ") < rangeEnd)";
+
+                std::ostringstream step;
+                step << std::hexfloat << statement.m_step;
+                increment = "if (const double* counter = " + counter + ".GetNumber()) " + counter + " = Value(*counter + " + step.str() + ")";
+            }
+            else
+            {
+                condition = statement.m_condition ? Generate(*statement.m_condition, transpilerContext) : "";
+                increment = statement.m_increment ? Generate(*statement.m_increment, transpilerContext) : "";
+            }
+
+            Line(transpilerContext) << "while (true)\n";
+            Line(transpilerContext) << "{\n";
+            ++transpilerContext.m_indent;
+            if (!condition.empty())
+            {
+                Line(transpilerContext) << "if (!(" << condition << ").IsTruthy())\n";
+                Line(transpilerContext) << "{\n";
+                Line(transpilerContext) << "    break;\n";
+                Line(transpilerContext) << "}\n";
+            }
+            GenerateBlock(*statement.m_body, transpilerContext);
+            if (!increment.empty())
+            {
+                Line(transpilerContext) << increment << ";\n";
+            }
+            --transpilerContext.m_indent;
+            Line(transpilerContext) << "}\n";
+            --transpilerContext.m_depth;
+            --transpilerContext.m_indent;
+            Line(transpilerContext) << "}\n";
+        }
+
+        virtual void VisitBreakStatement(const BreakStatement& statement, IStatementVisitorContext* context) const override
+        {
+            Line(GetTranspilerContext(context)) << "break;\n";
+        }
+
+        virtual void VisitReturnStatement(const ReturnStatement& statement, IStatementVisitorContext* context) const override
+        {
+            TranspilerContext& transpilerContext = GetTranspilerContext(context);
+            const std::string returnValue = statement.m_returnValue ? Generate(*statement.m_returnValue, transpilerContext) : "Value()";
+            Line(transpilerContext) << "return " << returnValue << ";\n";
+        }
+
+        virtual void VisitUnaryExpression(const UnaryExpression& unaryExpression, IExpressionVisitorContext* context) const override
+        {
+            TranspilerContext& transpilerContext = GetTranspilerContext(context);
+            const std::string op = TokenReference(unaryExpression.m_operator, transpilerContext);
+            const std::string operand = Generate(*unaryExpression.m_expression, transpilerContext);
+            transpilerContext.m_expression = "Runtime::Unary(" + op + ", " + operand + ")";
+        }
+
+        virtual void VisitBinaryExpression(const BinaryExpression& binaryExpression, IExpressionVisitorContext* context) const override
+        {
+            TranspilerContext& transpilerContext = GetTranspilerContext(context);
+            const std::string op = TokenReference(binaryExpression.m_operator, transpilerContext);
+            const std::string left = Generate(*binaryExpression.m_left, transpilerContext);
+            const std::string right = Generate(*binaryExpression.m_right, transpilerContext);
+            transpilerContext.m_expression = "runtime->Binary(" + op + ", { " + left + ", " + right + " })";
+        }
+
+        virtual void VisitTernaryConditionalExpression(const TernaryConditionalExpression& ternaryConditionalExpression, IExpressionVisitorContext* context) const override
+        {
+            TranspilerContext& transpilerContext = GetTranspilerContext(context);
+            const std::string condition = Generate(*ternaryConditionalExpression.m_condition, transpilerContext);
+            const std::string trueBranch = Generate(*ternaryConditionalExpression.m_trueBranch, transpilerContext);
+            const std::string falseBranch = Generate(*ternaryConditionalExpression.m_falseBranch, transpilerContext);
+            transpilerContext.m_expression = "((" + condition + ").IsTruthy() ? Value(" + trueBranch + ") : Value(" + falseBranch + "))";
+        }
+
+        virtual void VisitGroupingExpression(const GroupingExpression& groupingExpression, IExpressionVisitorContext* context) const override
+        {
+            TranspilerContext& transpilerContext = GetTranspilerContext(context);
+            transpilerContext.m_expression = "(" + Generate(*groupingExpression.m_expression, transpilerContext) + ")";
+        }
+
+        virtual void VisitLiteralExpression(const LiteralExpression& literalExpression, IExpressionVisitorContext* context) const override
+        {
+            TranspilerContext& transpilerContext = GetTranspilerContext(context);
+            transpilerContext.m_expression = ConstantReference(literalExpression.m_value, transpilerContext);
+        }
+
+        virtual void VisitVariableExpression(const VariableExpression& variableExpression, IExpressionVisitorContext* context) const override
+        {
+            TranspilerContext& transpilerContext = GetTranspilerContext(context);
+            if (IsGlobal(variableExpression.m_resolved))
+            {
+                const std::string& global = Global(variableExpression.m_name, transpilerContext);
+                transpilerContext.m_expression = "runtime->Get(" + global + ", " + TokenReference(variableExpression.m_name, transpilerContext) + ")";
+            }
+            else
+            {
+                transpilerContext.m_expression = Local(variableExpression.m_name, variableExpression.m_resolved, transpilerContext);
+            }
+        }
+
+        virtual void VisitAssignmentExpression(const AssignmentExpression& assignmentExpression, IExpressionVisitorContext* context) const override
+        {
+            TranspilerContext& transpilerContext = GetTranspilerContext(context);
+            const std::string value = Generate(*assignmentExpression.m_expression, transpilerContext);
+            if (IsGlobal(assignmentExpression.m_resolved))
+            {
+                const std::string& global = Global(assignmentExpression.m_name, transpilerContext);
+                transpilerContext.m_expression = "runtime->Assign(" + global + ", " + value + ", " + TokenReference(assignmentExpression.m_name, transpilerContext) + ")";
+            }
+            else
+            {
+                transpilerContext.m_expression = "(" + Local(assignmentExpression.m_name, assignmentExpression.m_resolved, transpilerContext) + " = " + value + ")";
+            }
+        }
+
+        virtual void VisitLogicalExpression(const LogicalExpression& logicalExpression, IExpressionVisitorContext* context) const override
+        {
+            TranspilerContext& transpilerContext = GetTranspilerContext(context);
+            const std::string left = Generate(*logicalExpression.m_left, transpilerContext);
+            const std::string right = Generate(*logicalExpression.m_right, transpilerContext);
+            const char* shortCircuit = logicalExpression.m_operator.m_type == Token::Type::Or ? "left.IsTruthy()" : "!left.IsTruthy()";
+            transpilerContext.m_expression = "[&]() -> Value { Value left = " + left + "; return " + shortCircuit + " ? left : Value(" + right + "); }()";
+        }
+
+        virtual void VisitCallExpression(const CallExpression& callExpression, IExpressionVisitorContext* context) const override
+        {
+            TranspilerContext& transpilerContext = GetTranspilerContext(context);
+
+            // a top-level function declared once is the only value its name can have once defined
+            const VariableExpression* callee = dynamic_cast<const VariableExpression*>(callExpression.m_calle.get());
+            const FunctionDeclarationStatement* direct = nullptr;
+            if (callee && IsGlobal(callee->m_resolved) && callee->m_resolved.m_final)
+            {
+                auto declaration = transpilerContext.m_declaredOnce.find(callee->m_name.m_lexeme);
+                if (declaration != transpilerContext.m_declaredOnce.end() && declaration->second->m_parameters.size() == callExpression.m_arguments.size())
+                {
+                    direct = declaration->second;
+                }
+            }
+
+            std::string arguments;
+            for (const IExpressionPtr& argument : callExpression.m_arguments)
+            {
+                const std::string value = Generate(*argument, transpilerContext);
+                arguments += (arguments.empty() ? " " : ", ") + value;
+            }
+            arguments += arguments.empty() ? "" : " ";
+
+            if (direct)
+            {
+                const std::string& global = Global(callee->m_name, transpilerContext);
+                const std::string name = TokenReference(callee->m_name, transpilerContext);
+                transpilerContext.m_expression = "(runtime->CheckDefined(" + global + ", " + name + "), " + transpilerContext.m_functions.at(direct).m_name + "({" + arguments + "}))";
+            }
+            else
+            {
+                const std::string token = TokenReference(callExpression.m_token, transpilerContext);
+                const std::string calleeValue = Generate(*callExpression.m_calle, transpilerContext);
+                transpilerContext.m_expression = "runtime->Call(" + token + ", { " + calleeValue + ", {" + arguments + "} })";
+            }
+        }
+
+        virtual void VisitGetExpression(const GetExpression& getExpression, IExpressionVisitorContext* context) const override
+        {
+            GetTranspilerContext(context).m_unsupported = true;
+        }
+
+        virtual void VisitSetExpression(const SetExpression& setExpression, IExpressionVisitorContext* context) const override
+        {
+            GetTranspilerContext(context).m_unsupported = true;
+        }
+
+        virtual void VisitLambdaExpression(const LambdaExpression& lambdaExpression, IExpressionVisitorContext* context) const override
+        {
+            GetTranspilerContext(context).m_unsupported = true;
+        }
+
+        virtual void VisitThisExpression(const ThisExpression& thisExpression, IExpressionVisitorContext* context) const override
+        {
+            GetTranspilerContext(context).m_unsupported = true;
+        }
+
+        virtual void VisitSuperExpression(const SuperExpression& superExpression, IExpressionVisitorContext* context) const override
+        {
+            GetTranspilerContext(context).m_unsupported = true;
+        }
+    };
+}
+
+Transpiler::Result Transpiler::Transpile(const std::vector<IStatementPtr>& programm, std::string_view source) const
+{
+    TranspilerContext context;
+
+    // names of the C++ functions are known before the calls to them are generated,
+    // functions using what isn't translated are declared by the interpreter
+    std::unordered_map<std::string_view, size_t> declarationsCount;
+    for (const IStatementPtr& statement : programm)
+    {
+        if (const FunctionDeclarationStatement* declaration = dynamic_cast<const FunctionDeclarationStatement*>(statement.get()))
+        {
+            ++declarationsCount[declaration->m_name.m_lexeme];
+
+            bool translated = !declaration->m_deferredBody;
+            if (translated)
+            {
+                TranspilerContext trial;
+                CodeGenerator().GenerateFunction(*declaration, TopLevelFunction{ "f", declaration->m_parameters.size() }, trial);
+                translated = !trial.m_unsupported;
+            }
+
+            if (translated)
+            {
+                const std::string name = "f_" + std::string(declaration->m_name.m_lexeme) + "_" + std::to_string(context.m_functions.size());
+                context.m_functions.emplace(declaration, TopLevelFunction{ name, declaration->m_parameters.size() });
+                context.m_declaredOnce[declaration->m_name.m_lexeme] = declaration;
+            }
+        }
+    }
+    std::erase_if(context.m_declaredOnce, [&](const auto& declaration) { return declarationsCount[declaration.first] > 1; });
+
+    // statements that can't be translated are run by the interpreter, they share the globals with the translated ones
+    std::ostringstream run;
+    bool interpreted = false;
+    for (size_t i = 0; i < programm.size(); ++i)
+    {
+        const size_t tokensCount = context.m_tokens.size();
+        const size_t constantsCount = context.m_constants.size();
+        std::ostringstream statement;
+        context.m_code = &statement;
+        context.m_unsupported = false;
+        CodeGenerator().Generate(*programm[i], context);
+        if (context.m_unsupported)
+        {
+            context.m_tokens.resize(tokensCount);
+            context.m_constants.resize(constantsCount);
+            context.m_code = &run;
+            CodeGenerator::Line(context) << "runtime->Run(" << i << ");\n";
+            interpreted = true;
+        }
+        else
+        {
+            run << statement.str();
+        }
+    }
+
+    std::ostringstream code;
+    code << "// generated by 'gekko compile'\n";
+    code << "#include \"runtime.h\"\n";
+    code << "#include \"token.h\"\n\n";
+    code << "namespace\n{\n";
+    code << "    Runtime* runtime = nullptr;\n\n";
+    code << "    const Token tokens[] =\n    {\n";
+    for (const std::string& token : context.m_tokens)
+    {
+        code << "        " << token << ",\n";
+    }
+    code << "    };\n\n";
+    code << "    const Value constants[] =\n    {\n";
+    for (const std::string& constant : context.m_constants)
+    {
+        code << "        " << constant << ",\n";
+    }
+    code << "    };\n\n";
+    for (const auto& [name, global] : context.m_globals)
+    {
+        code << "    Runtime::Global " << global << ";\n";
+    }
+    code << "\n" << context.m_declarations.str() << "\n";
+    code << context.m_definitions.str();
+    code << "    void Run()\n    {\n" << run.str() << "    }\n";
+    code << "}\n\n";
+    code << "int main()\n{\n";
+    code << "    Runtime compiledRuntime;\n";
+    code << "    runtime = &compiledRuntime;\n";
+    for (const auto& [name, global] : context.m_globals)
+    {
+        code << "    compiledRuntime.Import(" << global << ", " << MakeStringLiteral(name) << ");\n";
+    }
+    if (interpreted)
+    {
+        code << "    compiledRuntime.Load(std::string(" << MakeStringLiteral(source) << ", " << source.size() << "));\n";
+    }
+    code << "    return compiledRuntime.Execute(Run, std::cerr);\n";
+    code << "}\n";
+
+    return Result{ code.str(), !interpreted };
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct IStatement;
+using IStatementPtr = std::unique_ptr<const IStatement>;
+
+// translates a resolved programm to C++ built against Runtime, see 'gekko compile'.
+// top-level functions become C++ functions, locals become C++ variables and direct calls are made to
+// functions declared once. classes, properties, lambdas and nested functions need environments, so top-level
+// statements using them are run by the interpreter from the source embedded into the executable.
+class Transpiler
+{
+public:
+    struct Result
+    {
+        std::string m_code;
+        bool m_translated = false; // false when some statements are run by the interpreter
+    };
+
+    Result Transpile(const std::vector<IStatementPtr>& programm, std::string_view source) const;
+};
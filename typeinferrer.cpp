@@ -0,0 +1,363 @@
+#include "typeinferrer.h"
+#include "statements.h"
+#include "expressions.h"
+#include "token.h"
+#include <map>
+#include <set>
+
+struct TypeInferrerContext : IStatementVisitorContext, IExpressionVisitorContext
+{
+    ExpressionType GetVariableType(const ResolvedName& name) const
+    {
+        if (!name.m_declaration || m_initializing.contains(name.m_declaration))
+        {
+            return ExpressionType::Unknown;
+        }
+
+        auto typeIt = m_variableTypes.find(name.m_declaration);
+        return typeIt != m_variableTypes.end() ? typeIt->second : ExpressionType::Unknown;
+    }
+
+    void AssignVariableType(const Token& declaration, ExpressionType type)
+    {
+        auto it = m_variableTypes.find(&declaration);
+        if (it == m_variableTypes.end())
+        {
+            m_variableTypes[&declaration] = type;
+            m_changed = true;
+        }
+        else if (it->second != type && it->second != ExpressionType::Unknown)
+        {
+            it->second = ExpressionType::Unknown;
+            m_changed = true;
+        }
+    }
+
+    void AssignVariableType(const ResolvedName& name, ExpressionType type)
+    {
+        if (name.m_declaration)
+        {
+            // only variables declared with 'var' are typed, parameters and other bindings stay unknown
+            AssignVariableType(*name.m_declaration, m_variableTypes.contains(name.m_declaration) ? type : ExpressionType::Unknown);
+        }
+    }
+
+    std::map<const Token*, ExpressionType> m_variableTypes;
+    std::set<const Token*> m_initializing; // variables read in their own initializer refer to an outer declaration
+    ExpressionType m_result = ExpressionType::Unknown;
+    bool m_changed = false;
+    bool m_annotate = false;
+};
+
+static TypeInferrerContext& GetTypeInferrerContext(IStatementVisitorContext& context)
+{
+    return static_cast<TypeInferrerContext&>(context);
+}
+
+static TypeInferrerContext& GetTypeInferrerContext(IExpressionVisitorContext& context)
+{
+    return static_cast<TypeInferrerContext&>(context);
+}
+
+static ExpressionType Join(ExpressionType lhs, ExpressionType rhs)
+{
+    return lhs == rhs ? lhs : ExpressionType::Unknown;
+}
+
+void TypeInferrer::Infer(const std::vector<IStatementPtr>& statements) const
+{
+    TypeInferrerContext context;
+
+    // variable types can only get less precise, so this converges after a few passes
+    do
+    {
+        context.m_changed = false;
+        Infer(statements, context);
+    } while (context.m_changed);
+
+    context.m_annotate = true;
+    Infer(statements, context);
+}
+
+void TypeInferrer::Infer(const std::vector<IStatementPtr>& statements, TypeInferrerContext& context) const
+{
+    for (const IStatementPtr& statement : statements)
+    {
+        statement->Accept(*this, &context);
+    }
+}
+
+ExpressionType TypeInferrer::Infer(const IExpression& expression, TypeInferrerContext& context) const
+{
+    context.m_result = ExpressionType::Unknown;
+    expression.Accept(*this, &context);
+    return context.m_result;
+}
+
+void TypeInferrer::VisitExpressionStatement(const ExpressionStatement& statement, IStatementVisitorContext* context) const
+{
+    Infer(*statement.m_expression, GetTypeInferrerContext(*context));
+}
+
+void TypeInferrer::VisitPrintStatement(const PrintStatement& statement, IStatementVisitorContext* context) const
+{
+    Infer(*statement.m_expression, GetTypeInferrerContext(*context));
+}
+
+void TypeInferrer::VisitVariableDeclarationStatement(const VariableDeclarationStatement& statement, IStatementVisitorContext* context) const
+{
+    TypeInferrerContext& inferrerContext = GetTypeInferrerContext(*context);
+
+    ExpressionType type = ExpressionType::Unknown; // uninitialized variables hold nil
+    if (statement.m_initializer)
+    {
+        inferrerContext.m_initializing.insert(&statement.m_name);
+        type = Infer(*statement.m_initializer, inferrerContext);
+        inferrerContext.m_initializing.erase(&statement.m_name);
+    }
+
+    inferrerContext.AssignVariableType(statement.m_name, type);
+}
+
+void TypeInferrer::VisitFunctionDeclarationStatement(const FunctionDeclarationStatement& statement, IStatementVisitorContext* context) const
+{
+    Infer(statement.m_body, GetTypeInferrerContext(*context));
+}
+
+void TypeInferrer::VisitClassDeclarationStatement(const ClassDeclarationStatement& statement, IStatementVisitorContext* context) const
+{
+    for (const std::unique_ptr<FunctionDeclarationStatement>& methodDeclaration : statement.m_methods)
+    {
+        VisitFunctionDeclarationStatement(*methodDeclaration, context);
+    }
+}
+
+void TypeInferrer::VisitBlockStatement(const BlockStatement& statement, IStatementVisitorContext* context) const
+{
+    Infer(statement.m_block, GetTypeInferrerContext(*context));
+}
+
+void TypeInferrer::VisitIfStatement(const IfStatement& statement, IStatementVisitorContext* context) const
+{
+    TypeInferrerContext& inferrerContext = GetTypeInferrerContext(*context);
+
+    Infer(*statement.m_condition, inferrerContext);
+    statement.m_trueBranch->Accept(*this, context);
+    if (statement.m_falseBranch)
+    {
+        statement.m_falseBranch->Accept(*this, context);
+    }
+}
+
+void TypeInferrer::VisitWhileStatement(const WhileStatement& statement, IStatementVisitorContext* context) const
+{
+    Infer(*statement.m_condition, GetTypeInferrerContext(*context));
+    statement.m_body->Accept(*this, context);
+}
+
+void TypeInferrer::VisitForStatement(const ForStatement& statement, IStatementVisitorContext* context) const
+{
+    TypeInferrerContext& inferrerContext = GetTypeInferrerContext(*context);
+
+    if (statement.m_initializer)
+    {
+        statement.m_initializer->Accept(*this, context);
+    }
+
+    if (statement.m_rangeEnd)
+    {
+        Infer(*statement.m_rangeEnd, inferrerContext);
+        inferrerContext.AssignVariableType(*statement.m_counter, ExpressionType::Number); // implicit 'i = i + 1'
+    }
+
+    if (statement.m_condition)
+    {
+        Infer(*statement.m_condition, inferrerContext);
+    }
+
+    statement.m_body->Accept(*this, context);
+
+    if (statement.m_increment)
+    {
+        Infer(*statement.m_increment, inferrerContext);
+    }
+}
+
+void TypeInferrer::VisitReturnStatement(const ReturnStatement& statement, IStatementVisitorContext* context) const
+{
+    if (statement.m_returnValue)
+    {
+        Infer(*statement.m_returnValue, GetTypeInferrerContext(*context));
+    }
+}
+
+void TypeInferrer::VisitUnaryExpression(const UnaryExpression& unaryExpression, IExpressionVisitorContext* context) const
+{
+    TypeInferrerContext& inferrerContext = GetTypeInferrerContext(*context);
+
+    const ExpressionType operandType = Infer(*unaryExpression.m_expression, inferrerContext);
+    switch (unaryExpression.m_operator.m_type)
+    {
+    case Token::Type::Minus:
+    case Token::Type::Plus:
+    {
+        if (inferrerContext.m_annotate)
+        {
+            unaryExpression.m_operandType = operandType == ExpressionType::Number ? ExpressionType::Number : ExpressionType::Unknown;
+        }
+        inferrerContext.m_result = ExpressionType::Number;
+    } break;
+    case Token::Type::Bang: inferrerContext.m_result = ExpressionType::Boolean; break;
+    default: inferrerContext.m_result = ExpressionType::Unknown; break;
+    }
+}
+
+void TypeInferrer::VisitBinaryExpression(const BinaryExpression& binaryExpression, IExpressionVisitorContext* context) const
+{
+    TypeInferrerContext& inferrerContext = GetTypeInferrerContext(*context);
+
+    const ExpressionType leftType = Infer(*binaryExpression.m_left, inferrerContext);
+    const ExpressionType rightType = Infer(*binaryExpression.m_right, inferrerContext);
+    const ExpressionType operandsType = Join(leftType, rightType);
+
+    ExpressionType resultType = ExpressionType::Unknown;
+    ExpressionType specialization = ExpressionType::Unknown;
+    switch (binaryExpression.m_operator.m_type)
+    {
+    case Token::Type::EqualEqual:
+    case Token::Type::BangEqual:
+    {
+        resultType = ExpressionType::Boolean;
+        specialization = operandsType;
+    } break;
+    case Token::Type::Minus:
+    case Token::Type::Slash:
+    case Token::Type::Star:
+    {
+        resultType = ExpressionType::Number;
+        specialization = operandsType == ExpressionType::Number ? operandsType : ExpressionType::Unknown;
+    } break;
+    case Token::Type::Less:
+    case Token::Type::LessEqual:
+    case Token::Type::Greater:
+    case Token::Type::GreaterEqual:
+    {
+        resultType = ExpressionType::Boolean;
+        specialization = operandsType == ExpressionType::Number ? operandsType : ExpressionType::Unknown;
+    } break;
+    case Token::Type::Plus:
+    {
+        // the left operand decides between concatenation and addition, the right one has to match or it's an error
+        resultType = leftType == ExpressionType::String || leftType == ExpressionType::Number ? leftType : ExpressionType::Unknown;
+        specialization = operandsType == ExpressionType::Number || operandsType == ExpressionType::String ? operandsType : ExpressionType::Unknown;
+    } break;
+    default: break;
+    }
+
+    if (inferrerContext.m_annotate)
+    {
+        binaryExpression.m_operandsType = specialization;
+    }
+
+    inferrerContext.m_result = resultType;
+}
+
+void TypeInferrer::VisitTernaryConditionalExpression(const TernaryConditionalExpression& ternaryConditionalExpression, IExpressionVisitorContext* context) const
+{
+    TypeInferrerContext& inferrerContext = GetTypeInferrerContext(*context);
+
+    Infer(*ternaryConditionalExpression.m_condition, inferrerContext);
+    const ExpressionType trueType = Infer(*ternaryConditionalExpression.m_trueBranch, inferrerContext);
+    const ExpressionType falseType = Infer(*ternaryConditionalExpression.m_falseBranch, inferrerContext);
+    inferrerContext.m_result = Join(trueType, falseType);
+}
+
+void TypeInferrer::VisitGroupingExpression(const GroupingExpression& groupingExpression, IExpressionVisitorContext* context) const
+{
+    TypeInferrerContext& inferrerContext = GetTypeInferrerContext(*context);
+    inferrerContext.m_result = Infer(*groupingExpression.m_expression, inferrerContext);
+}
+
+void TypeInferrer::VisitLiteralExpression(const LiteralExpression& literalExpression, IExpressionVisitorContext* context) const
+{
+    TypeInferrerContext& inferrerContext = GetTypeInferrerContext(*context);
+
+    if (literalExpression.m_value.GetNumber())
+    {
+        inferrerContext.m_result = ExpressionType::Number;
+    }
+    else if (literalExpression.m_value.GetBoolean())
+    {
+        inferrerContext.m_result = ExpressionType::Boolean;
+    }
+    else if (literalExpression.m_value.GetString())
+    {
+        inferrerContext.m_result = ExpressionType::String;
+    }
+    else
+    {
+        inferrerContext.m_result = ExpressionType::Unknown;
+    }
+}
+
+void TypeInferrer::VisitVariableExpression(const VariableExpression& variableExpression, IExpressionVisitorContext* context) const
+{
+    TypeInferrerContext& inferrerContext = GetTypeInferrerContext(*context);
+    inferrerContext.m_result = inferrerContext.GetVariableType(variableExpression.m_resolved);
+}
+
+void TypeInferrer::VisitAssignmentExpression(const AssignmentExpression& assignmentExpression, IExpressionVisitorContext* context) const
+{
+    TypeInferrerContext& inferrerContext = GetTypeInferrerContext(*context);
+
+    const ExpressionType type = Infer(*assignmentExpression.m_expression, inferrerContext);
+    inferrerContext.AssignVariableType(assignmentExpression.m_resolved, type);
+    inferrerContext.m_result = type;
+}
+
+void TypeInferrer::VisitLogicalExpression(const LogicalExpression& logicalExpression, IExpressionVisitorContext* context) const
+{
+    TypeInferrerContext& inferrerContext = GetTypeInferrerContext(*context);
+
+    const ExpressionType leftType = Infer(*logicalExpression.m_left, inferrerContext);
+    const ExpressionType rightType = Infer(*logicalExpression.m_right, inferrerContext);
+    inferrerContext.m_result = Join(leftType, rightType);
+}
+
+void TypeInferrer::VisitCallExpression(const CallExpression& callExpression, IExpressionVisitorContext* context) const
+{
+    TypeInferrerContext& inferrerContext = GetTypeInferrerContext(*context);
+
+    Infer(*callExpression.m_calle, inferrerContext);
+    for (const IExpressionPtr& argument : callExpression.m_arguments)
+    {
+        Infer(*argument, inferrerContext);
+    }
+
+    inferrerContext.m_result = ExpressionType::Unknown;
+}
+
+void TypeInferrer::VisitGetExpression(const GetExpression& getExpression, IExpressionVisitorContext* context) const
+{
+    TypeInferrerContext& inferrerContext = GetTypeInferrerContext(*context);
+
+    Infer(*getExpression.m_owner, inferrerContext);
+    inferrerContext.m_result = ExpressionType::Unknown;
+}
+
+void TypeInferrer::VisitSetExpression(const SetExpression& setExpression, IExpressionVisitorContext* context) const
+{
+    TypeInferrerContext& inferrerContext = GetTypeInferrerContext(*context);
+
+    Infer(setExpression.m_owner, inferrerContext);
+    Infer(*setExpression.m_value, inferrerContext);
+    inferrerContext.m_result = ExpressionType::Unknown;
+}
+
+void TypeInferrer::VisitLambdaExpression(const LambdaExpression& lambdaExpression, IExpressionVisitorContext* context) const
+{
+    TypeInferrerContext& inferrerContext = GetTypeInferrerContext(*context);
+
+    Infer(lambdaExpression.m_body, inferrerContext);
+    inferrerContext.m_result = ExpressionType::Unknown;
+}
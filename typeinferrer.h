@@ -0,0 +1,51 @@
+#pragma once
+
+#include "statementvisitor.h"
+#include "expressionvisitor.h"
+#include "expressions.h"
+#include <vector>
+#include <memory>
+
+struct IStatement;
+using IStatementPtr = std::unique_ptr<const IStatement>;
+
+struct TypeInferrerContext;
+
+// walks a resolved programm and proves static types of expressions where possible.
+// binary and unary expressions whose operands are proven to be numbers, booleans or strings
+// are annotated so the interpreter can skip dynamic type checks for them.
+// local variables are typed by all values ever assigned to them, everything else stays Unknown.
+class TypeInferrer : IExpressionVisitor, IStatementVisitor
+{
+public:
+    // expects statements resolved by Resolver
+    void Infer(const std::vector<IStatementPtr>& statements) const;
+
+private:
+    void Infer(const std::vector<IStatementPtr>& statements, TypeInferrerContext& context) const;
+    ExpressionType Infer(const IExpression& expression, TypeInferrerContext& context) const;
+
+    virtual void VisitExpressionStatement(const ExpressionStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitPrintStatement(const PrintStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitVariableDeclarationStatement(const VariableDeclarationStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitFunctionDeclarationStatement(const FunctionDeclarationStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitClassDeclarationStatement(const ClassDeclarationStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitBlockStatement(const BlockStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitIfStatement(const IfStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitWhileStatement(const WhileStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitForStatement(const ForStatement& statement, IStatementVisitorContext* context) const override;
+    virtual void VisitReturnStatement(const ReturnStatement& statement, IStatementVisitorContext* context) const override;
+
+    virtual void VisitUnaryExpression(const UnaryExpression& unaryExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitBinaryExpression(const BinaryExpression& binaryExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitTernaryConditionalExpression(const TernaryConditionalExpression& ternaryConditionalExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitGroupingExpression(const GroupingExpression& groupingExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitLiteralExpression(const LiteralExpression& literalExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitVariableExpression(const VariableExpression& variableExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitAssignmentExpression(const AssignmentExpression& assignmentExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitLogicalExpression(const LogicalExpression& logicalExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitCallExpression(const CallExpression& callExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitGetExpression(const GetExpression& getExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitSetExpression(const SetExpression& setExpression, IExpressionVisitorContext* context) const override;
+    virtual void VisitLambdaExpression(const LambdaExpression& lambdaExpression, IExpressionVisitorContext* context) const override;
+};
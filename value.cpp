@@ -1,6 +1,7 @@
 #include "value.h"
 #include "callable.h"
 #include "class.h"
+#include <cstdint>
 
 Value::Value()
 {}
@@ -116,4 +117,34 @@ bool Value::HasValue() const
 bool Value::IsNil() const
 {
     return !HasValue();
-}
\ No newline at end of file
+}
+
+bool Value::AppendKey(std::string& key) const
+{
+    if (const double* number = GetNumber())
+    {
+        key += 'n';
+        key.append(reinterpret_cast<const char*>(number), sizeof(double));
+    }
+    else if (const std::string* string = GetString())
+    {
+        const uint32_t size = static_cast<uint32_t>(string->size());
+        key += 's';
+        key.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        key += *string;
+    }
+    else if (const bool* boolean = GetBoolean())
+    {
+        key += *boolean ? 't' : 'f';
+    }
+    else if (IsNil())
+    {
+        key += '0';
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
@@ -31,6 +31,8 @@ public:
     bool IsNil() const;
 
     std::string ToString() const;
+    // appends a binary encoding of a number, string, boolean or nil, other values can't be a part of a key
+    bool AppendKey(std::string& key) const;
 private:
     std::any m_value;
 };